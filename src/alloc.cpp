@@ -0,0 +1,113 @@
+#include "alloc.h"
+
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace life
+{
+	static std::atomic<uint64_t> s_AllocationCount{ 0 };
+	static std::atomic<uint64_t> s_AllocationBytes{ 0 };
+
+	static void* countedAllocate(size_t size);
+	static void* countedAlignedAllocate(size_t size, size_t alignment);
+	static void alignedFree(void* ptr);
+
+	// relaxed counters are enough, readers only want totals between two frames
+	static void* countedAllocate(size_t size)
+	{
+		s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		s_AllocationBytes.fetch_add(size, std::memory_order_relaxed);
+		return malloc(size ? size : 1);
+	}
+
+	// alignments beyond what malloc guarantees, windows frees these with its own function
+	static void* countedAlignedAllocate(size_t size, size_t alignment)
+	{
+		s_AllocationCount.fetch_add(1, std::memory_order_relaxed);
+		s_AllocationBytes.fetch_add(size, std::memory_order_relaxed);
+#ifdef _WIN32
+		return _aligned_malloc(size ? size : 1, alignment);
+#else
+		void* ptr;
+		return posix_memalign(&ptr, alignment, size ? size : 1) == 0 ? ptr : nullptr;
+#endif
+	}
+
+	static void alignedFree(void* ptr)
+	{
+#ifdef _WIN32
+		_aligned_free(ptr);
+#else
+		free(ptr);
+#endif
+	}
+
+	void allocationStats(LifeAllocationStats* stats)
+	{
+		stats->count = s_AllocationCount.load(std::memory_order_relaxed);
+		stats->bytes = s_AllocationBytes.load(std::memory_order_relaxed);
+	}
+
+	void* countedMalloc(size_t size, void*)
+	{
+		return countedAllocate(size);
+	}
+
+	void countedFree(void* ptr, void*)
+	{
+		free(ptr);
+	}
+}
+
+void* operator new(size_t size)
+{
+	void* ptr = life::countedMalloc(size, nullptr);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size)
+{
+	void* ptr = life::countedMalloc(size, nullptr);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return life::countedMalloc(size, nullptr); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return life::countedMalloc(size, nullptr); }
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* ptr = life::countedAlignedAllocate(size, (size_t)alignment);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* ptr = life::countedAlignedAllocate(size, (size_t)alignment);
+	if (!ptr) throw std::bad_alloc();
+	return ptr;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return life::countedAlignedAllocate(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept { return life::countedAlignedAllocate(size, (size_t)alignment); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { life::alignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { life::alignedFree(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { life::alignedFree(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { life::alignedFree(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { life::alignedFree(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { life::alignedFree(ptr); }
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// counts every global operator new in the program, linking alloc.cpp replaces them, plus
+// allocations of libraries routed through countedMalloc and countedFree
+struct LifeAllocationStats
+{
+	uint64_t count; // allocations since the program started
+	uint64_t bytes;
+};
+
+namespace life
+{
+	void  allocationStats(LifeAllocationStats* stats);
+
+	// malloc and free that are counted, shaped to fit ImGui::SetAllocatorFunctions
+	void* countedMalloc(size_t size, void* user);
+	void  countedFree(void* ptr, void* user);
+}
@@ -0,0 +1,347 @@
+#include "arena.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/mman.h>
+#define LIFE_SLAB_MMAP_SUPPORTED
+#endif
+
+#define ARENA_SLAB_BYTES (256u << 10)
+#define ARENA_CACHE_LINE 64
+#define ARENA_BATCH 32       // tiles a cache takes from or gives back to the arena at once
+#define ARENA_CACHE_LIMIT 64 // tiles a cache holds before giving a batch back
+#define ARENA_SPARE_SLABS 1  // empty slabs kept for the next burst of allocations
+
+// the header takes the first tile slots of its slab, a tile finds its slab by masking its address
+struct ArenaSlab
+{
+	ArenaSlab* prev;
+	ArenaSlab* next;
+	ArenaSlab* older;    // every slab held, full ones included
+	ArenaSlab* newer;
+	void* head;          // free tiles of this slab
+	uint32_t freeCount;
+	uint32_t capacity;
+	bool listed;         // in the arena's list of slabs with free tiles
+	bool draining;       // hands out no tiles until it is empty
+};
+
+struct LifeTileArena
+{
+	std::mutex lock;
+	uint32_t tileBytes, slabBytes;
+	uint32_t firstTile; // byte offset of the first tile in a slab
+
+	// slabs with free tiles, partly used ones first so empty slabs stay empty and can be released
+	ArenaSlab* first;
+	ArenaSlab* last;
+	ArenaSlab* newest;
+	uint64_t slabs, emptySlabs;
+	uint64_t capacity, freeTiles, peakTiles;
+	uint64_t allocations, releases;
+};
+
+namespace life
+{
+	static ArenaSlab* slabOf(const LifeTileArena* arena, void* tile);
+	static void unlinkSlab(LifeTileArena* arena, ArenaSlab* slab);
+	static void linkSlab(LifeTileArena* arena, ArenaSlab* slab, bool front);
+	static void* mapSlab(uint32_t slabBytes);
+	static void unmapSlab(void* memory, uint32_t slabBytes);
+	static ArenaSlab* createSlab(LifeTileArena* arena);
+	static void* takeTile(LifeTileArena* arena);
+	static void returnTile(LifeTileArena* arena, void* tile);
+
+	static ArenaSlab* slabOf(const LifeTileArena* arena, void* tile)
+	{
+		return (ArenaSlab*)((uintptr_t)tile & ~(uintptr_t)(arena->slabBytes - 1));
+	}
+
+	static void unlinkSlab(LifeTileArena* arena, ArenaSlab* slab)
+	{
+		(slab->prev ? slab->prev->next : arena->first) = slab->next;
+		(slab->next ? slab->next->prev : arena->last) = slab->prev;
+		slab->prev = slab->next = nullptr;
+		slab->listed = false;
+	}
+
+	static void linkSlab(LifeTileArena* arena, ArenaSlab* slab, bool front)
+	{
+		slab->prev = front ? nullptr : arena->last;
+		slab->next = front ? arena->first : nullptr;
+		(slab->prev ? slab->prev->next : arena->first) = slab;
+		(slab->next ? slab->next->prev : arena->last) = slab;
+		slab->listed = true;
+	}
+
+	// slabs are mapped directly where possible, the heap would keep a released slab's pages
+	// resident for later allocations instead of handing them back
+	static void* mapSlab(uint32_t slabBytes)
+	{
+#ifdef LIFE_SLAB_MMAP_SUPPORTED
+		// twice the size is mapped and trimmed to an aligned slab
+		void* mapped = mmap(nullptr, (size_t)slabBytes * 2, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (mapped == MAP_FAILED) return nullptr;
+
+		uintptr_t start = (uintptr_t)mapped, aligned = (start + slabBytes - 1) & ~(uintptr_t)(slabBytes - 1);
+		if (aligned > start) munmap(mapped, aligned - start);
+		munmap((void*)(aligned + slabBytes), start + slabBytes - aligned);
+		return (void*)aligned;
+#else
+		return ::operator new(slabBytes, std::align_val_t(slabBytes), std::nothrow);
+#endif
+	}
+
+	static void unmapSlab(void* memory, uint32_t slabBytes)
+	{
+#ifdef LIFE_SLAB_MMAP_SUPPORTED
+		munmap(memory, slabBytes);
+#else
+		::operator delete(memory, std::align_val_t(slabBytes));
+#endif
+	}
+
+	static ArenaSlab* createSlab(LifeTileArena* arena)
+	{
+		void* memory = mapSlab(arena->slabBytes);
+		if (!memory) return nullptr;
+
+		ArenaSlab* slab = (ArenaSlab*)memory;
+		slab->prev = slab->next = nullptr;
+		slab->older = arena->newest;
+		slab->newer = nullptr;
+		if (arena->newest) arena->newest->newer = slab;
+		arena->newest = slab;
+		slab->capacity = (arena->slabBytes - arena->firstTile) / arena->tileBytes;
+		slab->freeCount = slab->capacity;
+		slab->listed = false;
+		slab->draining = false;
+
+		// linked back to front so tiles are handed out in address order
+		slab->head = nullptr;
+		for (uint32_t i = slab->capacity; i-- > 0;)
+		{
+			void* tile = (uint8_t*)memory + arena->firstTile + (size_t)i * arena->tileBytes;
+			*(void**)tile = slab->head;
+			slab->head = tile;
+		}
+
+		arena->slabs++;
+		arena->allocations++;
+		arena->capacity += slab->capacity;
+		arena->freeTiles += slab->capacity;
+		return slab;
+	}
+
+	// both run with the arena's lock held
+	static void* takeTile(LifeTileArena* arena)
+	{
+		ArenaSlab* slab = arena->first;
+		if (!slab)
+		{
+			if (!(slab = createSlab(arena))) return nullptr;
+			linkSlab(arena, slab, true);
+		}
+		else if (slab->freeCount == slab->capacity)
+			arena->emptySlabs--;
+
+		void* tile = slab->head;
+		slab->head = *(void**)tile;
+		slab->freeCount--;
+		if (slab->freeCount == 0)
+			unlinkSlab(arena, slab);
+
+		arena->freeTiles--;
+		arena->peakTiles = std::max(arena->peakTiles, arena->capacity - arena->freeTiles);
+		return tile;
+	}
+
+	static void returnTile(LifeTileArena* arena, void* tile)
+	{
+		ArenaSlab* slab = slabOf(arena, tile);
+		*(void**)tile = slab->head;
+		slab->head = tile;
+		slab->freeCount++;
+		arena->freeTiles++;
+
+		if (!slab->listed && !slab->draining)
+			linkSlab(arena, slab, true);
+		if (slab->freeCount < slab->capacity)
+			return;
+
+		// a slab left without live tiles goes to the back, or back to the system beyond the spares
+		if (slab->listed) unlinkSlab(arena, slab);
+		slab->draining = false;
+		if (arena->emptySlabs < ARENA_SPARE_SLABS)
+		{
+			linkSlab(arena, slab, false);
+			arena->emptySlabs++;
+			return;
+		}
+
+		if (slab->older) slab->older->newer = slab->newer;
+		(slab->newer ? slab->newer->older : arena->newest) = slab->older;
+		arena->slabs--;
+		arena->releases++;
+		arena->capacity -= slab->capacity;
+		arena->freeTiles -= slab->capacity;
+		unmapSlab(slab, arena->slabBytes);
+	}
+
+	LifeResult createTileArena(LifeTileArena** arena, const LifeArenaCreateInfo* createInfo)
+	{
+		uint32_t slabBytes = createInfo->slabBytes ? createInfo->slabBytes : ARENA_SLAB_BYTES;
+		uint32_t tileBytes = (std::max<uint32_t>(createInfo->tileBytes, sizeof(void*)) + ARENA_CACHE_LINE - 1) / ARENA_CACHE_LINE * ARENA_CACHE_LINE;
+		uint32_t firstTile = (sizeof(ArenaSlab) + ARENA_CACHE_LINE - 1) / ARENA_CACHE_LINE * ARENA_CACHE_LINE;
+		if ((slabBytes & (slabBytes - 1)) != 0 || firstTile + tileBytes > slabBytes)
+		{
+			printf("arena: %u byte tiles do not fit %u byte slabs\n", createInfo->tileBytes, slabBytes);
+			return Life_Result_Failed;
+		}
+
+		LifeTileArena* result = new LifeTileArena();
+		result->tileBytes = tileBytes;
+		result->slabBytes = slabBytes;
+		result->firstTile = firstTile;
+		*arena = result;
+		return Life_Result_Success;
+	}
+
+	void destroyTileArena(LifeTileArena* arena)
+	{
+		while (arena->newest)
+		{
+			ArenaSlab* slab = arena->newest;
+			arena->newest = slab->older;
+			unmapSlab(slab, arena->slabBytes);
+		}
+		delete arena;
+	}
+
+	void* allocateTile(LifeTileArena* arena)
+	{
+		std::lock_guard<std::mutex> guard(arena->lock);
+		return takeTile(arena);
+	}
+
+	void freeTile(LifeTileArena* arena, void* tile)
+	{
+		std::lock_guard<std::mutex> guard(arena->lock);
+		returnTile(arena, tile);
+	}
+
+	void beginTileCache(LifeTileArena* arena, LifeTileCache* cache)
+	{
+		cache->arena = arena;
+		cache->head = nullptr;
+		cache->count = 0;
+	}
+
+	void* cacheAllocate(LifeTileCache* cache)
+	{
+		if (!cache->head)
+		{
+			std::lock_guard<std::mutex> guard(cache->arena->lock);
+			for (uint32_t i = 0; i < ARENA_BATCH; i++)
+			{
+				void* tile = takeTile(cache->arena);
+				if (!tile) break;
+				*(void**)tile = cache->head;
+				cache->head = tile;
+				cache->count++;
+			}
+			if (!cache->head) return nullptr;
+		}
+
+		void* tile = cache->head;
+		cache->head = *(void**)tile;
+		cache->count--;
+		return tile;
+	}
+
+	void cacheFree(LifeTileCache* cache, void* tile)
+	{
+		*(void**)tile = cache->head;
+		cache->head = tile;
+		cache->count++;
+		if (cache->count < ARENA_CACHE_LIMIT)
+			return;
+
+		std::lock_guard<std::mutex> guard(cache->arena->lock);
+		for (uint32_t i = 0; i < ARENA_BATCH; i++)
+		{
+			void* give = cache->head;
+			cache->head = *(void**)give;
+			returnTile(cache->arena, give);
+		}
+		cache->count -= ARENA_BATCH;
+	}
+
+	void flushTileCache(LifeTileCache* cache)
+	{
+		if (!cache->head) return;
+
+		std::lock_guard<std::mutex> guard(cache->arena->lock);
+		while (cache->head)
+		{
+			void* give = cache->head;
+			cache->head = *(void**)give;
+			returnTile(cache->arena, give);
+		}
+		cache->count = 0;
+	}
+
+	uint64_t drainSlabs(LifeTileArena* arena)
+	{
+		std::lock_guard<std::mutex> guard(arena->lock);
+		uint64_t live = arena->capacity - arena->freeTiles;
+		if (live * 2 >= arena->capacity || arena->slabs <= ARENA_SPARE_SLABS + 1)
+			return 0;
+
+		std::vector<ArenaSlab*> used;
+		for (ArenaSlab* slab = arena->newest; slab; slab = slab->older)
+		{
+			if (slab->freeCount < slab->capacity && !slab->draining)
+				used.push_back(slab);
+		}
+		std::sort(used.begin(), used.end(), [](const ArenaSlab* a, const ArenaSlab* b) { return a->freeCount > b->freeCount; });
+
+		// the least used slabs are drained for as long as the rest have room for their tiles
+		uint64_t moving = 0, room = arena->freeTiles;
+		for (ArenaSlab* slab : used)
+		{
+			uint32_t tiles = slab->capacity - slab->freeCount;
+			if (moving + tiles > room - slab->freeCount)
+				break;
+
+			moving += tiles;
+			room -= slab->freeCount;
+			if (slab->listed) unlinkSlab(arena, slab);
+			slab->draining = true;
+		}
+		return moving;
+	}
+
+	bool tileDraining(LifeTileArena* arena, void* tile)
+	{
+		return slabOf(arena, tile)->draining;
+	}
+
+	void arenaStats(LifeTileArena* arena, LifeArenaStats* stats)
+	{
+		std::lock_guard<std::mutex> guard(arena->lock);
+		stats->liveTiles = arena->capacity - arena->freeTiles;
+		stats->freeTiles = arena->freeTiles;
+		stats->peakTiles = arena->peakTiles;
+		stats->slabs = arena->slabs;
+		stats->bytes = arena->slabs * arena->slabBytes;
+		stats->allocations = arena->allocations;
+		stats->releases = arena->releases;
+	}
+}
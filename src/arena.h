@@ -0,0 +1,59 @@
+#pragma once
+
+#include "life.h"
+
+// fixed size tiles carved out of large aligned slabs, a slab is returned to the system once
+// none of its tiles are in use, so the memory held follows the live tile count
+struct LifeTileArena;
+
+struct LifeArenaCreateInfo
+{
+	uint32_t tileBytes; // rounded up to a cache line
+	uint32_t slabBytes; // a power of two, slabs are aligned to their size, 0 uses 256 KB
+};
+
+struct LifeArenaStats
+{
+	uint64_t liveTiles; // handed out, including tiles parked in worker caches
+	uint64_t freeTiles; // in slabs still held, ready to be handed out
+	uint64_t peakTiles; // most live tiles at any time
+	uint64_t slabs;
+	uint64_t bytes;     // held from the system
+	uint64_t allocations, releases; // slabs taken from and returned to the system so far
+};
+
+// a worker's private free list, tiles move between it and the arena in batches so the arena's
+// lock is taken once per batch rather than once per tile, one cache must only be used by one
+// thread at a time and is flushed before the worker finishes
+struct LifeTileCache
+{
+	LifeTileArena* arena;
+	void* head;     // free tiles linked through their first word
+	uint32_t count;
+};
+
+namespace life
+{
+	LifeResult createTileArena(LifeTileArena** arena, const LifeArenaCreateInfo* createInfo);
+	// frees every slab, tiles still in use or in caches become invalid
+	void       destroyTileArena(LifeTileArena* arena);
+
+	// tiles come back with whatever their last user left in them
+	void*      allocateTile(LifeTileArena* arena);
+	void       freeTile(LifeTileArena* arena, void* tile);
+
+	void       beginTileCache(LifeTileArena* arena, LifeTileCache* cache);
+	void*      cacheAllocate(LifeTileCache* cache);
+	void       cacheFree(LifeTileCache* cache, void* tile);
+	// returns every tile of the cache to the arena
+	void       flushTileCache(LifeTileCache* cache);
+
+	// once fewer than half the tiles held are live, marks the least used slabs draining and returns
+	// how many live tiles they hold, no tile is handed out from a draining slab, so copying its
+	// tiles elsewhere and freeing them lets the arena give it back to the system
+	uint64_t   drainSlabs(LifeTileArena* arena);
+	// only meaningful while no other thread frees tiles
+	bool       tileDraining(LifeTileArena* arena, void* tile);
+
+	void       arenaStats(LifeTileArena* arena, LifeArenaStats* stats);
+}
@@ -0,0 +1,700 @@
+#include "life.h"
+#include "pattern.h"
+#include "ensemble.h"
+#include "distributed.h"
+#include "placement.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#define BENCH_RUSAGE_SUPPORTED
+#endif
+
+#if defined(__linux__)
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define BENCH_PERF_SUPPORTED
+#endif
+
+// cgol-bench steps the canonical workloads on every engine and thread count and prints the
+// results as JSON so runs can be compared across commits
+namespace bench
+{
+	enum BenchEngine
+	{
+		Bench_Engine_Packed,      // life::step, 64 cells per word
+		Bench_Engine_Ensemble,    // bit-sliced, 64 universes of the workload's size per word
+		Bench_Engine_Distributed, // one worker process per thread exchanging halo rows
+		Bench_Engine_Blocked,     // life::stepBlocked, several generations per pass over memory
+	};
+
+	struct BenchWorkload
+	{
+		std::string name;
+		const char* pattern;  // RLE placed in the middle, a random soup when null
+		uint32_t size;
+		float density;
+		uint64_t generations;
+		LifeTopology topology;
+	};
+
+	enum BenchCounter
+	{
+		Bench_Counter_Cycles,
+		Bench_Counter_Instructions,
+		Bench_Counter_L1Misses,     // L1 data cache read misses
+		Bench_Counter_LLCMisses,    // last level cache misses
+		Bench_Counter_BranchMisses,
+		Bench_Counter_TLBMisses,    // data TLB read misses
+
+		Bench_Counter_Count,
+	};
+
+	// one counter per event rather than a group, so a machine without some of them still
+	// reports the rest, every counter inherits into the step threads and worker processes
+	struct BenchCounters
+	{
+		int fds[Bench_Counter_Count]; // -1 when the counter could not be opened
+	};
+
+	struct BenchResult
+	{
+		double seconds;
+		uint64_t cellUpdates;
+		uint64_t peakMemory; // bytes, 0 when the platform cannot tell
+		uint64_t population;
+		uint64_t hash;
+		uint32_t blockDepth;   // generations per pass over memory, 0 for engines that do not block
+		double trafficBytes;   // modelled memory read and written per generation, 0 when not modelled
+		LifePlacementReport placement; // of the stepped grid, nodeCount is 0 for engines without one
+		int64_t counts[Bench_Counter_Count]; // -1 when not counted
+	};
+
+	static const char* s_Engines[] = { "packed", "ensemble", "distributed", "blocked" };
+	static const char* s_CounterNames[Bench_Counter_Count] = { "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses", "dtlb_misses" };
+
+	// R-pentomino settles after 1103 generations, its gliders stay clear of a 1024 plane's border
+	static const char* s_RPentomino = "x = 3, y = 3\nb2o$2o$bo!\n";
+	static const char* s_GosperGun =
+		"x = 36, y = 9\n"
+		"24bo$22bobo$12b2o6b2o12b2o$11bo3bo4b2o12b2o$2o8bo5bo3b2o$2o8bo3bob2o4bobo$10bo5bo7bo$11bo3bo$12b2o!\n";
+
+	static const char* s_Usage =
+		"usage: cgol-bench [options]\n"
+		"\n"
+		"  --workloads <list>    any of r-pentomino,gosper-gun,soup (default all)\n"
+		"  --engines <list>      any of packed,ensemble,distributed,blocked (default all)\n"
+		"  --threads <list>      thread counts to run (default 1, 2, 4, ... up to every hardware thread)\n"
+		"  --sizes <list>        soup universe sizes (default 256,1024,4096,16384,32768)\n"
+		"  --densities <list>    soup densities in percent (default 10,20,30,40,50)\n"
+		"  --work <n>            cell updates each soup aims for, sets its generations (default 4294967296)\n"
+		"  --depths <list>       generations per pass of the blocked engine, 0 tunes it (default 0)\n"
+		"  --counters            count cycles, instructions, cache, branch and TLB misses with perf_event_open\n"
+		"  --numa                pin the packed and blocked engines' threads, place each thread's rows on its\n"
+		"                        node by first touch and back the grids with huge pages\n"
+		"  --label <text>        stored in the results, a commit hash for example\n"
+		"  --output <file>       write the JSON here instead of stdout\n";
+
+	static const char* optionValue(int argc, char** argv, const char* name);
+	static std::vector<std::string> splitList(const char* list);
+	static bool listed(const std::vector<std::string>& list, const char* name);
+	static std::string jsonEscape(const char* text);
+	static void resetPeakMemory();
+	static uint64_t peakMemory();
+	static bool openCounters(BenchCounters* counters);
+	static void closeCounters(BenchCounters* counters);
+	static void startCounters(const BenchCounters* counters);
+	static void stopCounters(const BenchCounters* counters, BenchResult* result);
+	static void writeCounters(FILE* output, const BenchResult* result);
+	static void fillWorkload(const BenchWorkload* workload, uint32_t threadCount, LifeGrid* grid);
+	static void prepareGrids(LifeGrid* grid, LifeGrid* next, uint32_t threadCount, bool numa);
+	static BenchResult runPacked(const BenchWorkload* workload, uint32_t threadCount, bool numa, const BenchCounters* counters);
+	static BenchResult runEnsemble(const BenchWorkload* workload, uint32_t threadCount, const BenchCounters* counters);
+	static BenchResult runDistributed(const BenchWorkload* workload, uint32_t threadCount, const BenchCounters* counters, bool* ran);
+	static BenchResult runBlocked(const BenchWorkload* workload, uint32_t threadCount, uint32_t depth, bool numa, const BenchCounters* counters);
+
+	static const char* optionValue(int argc, char** argv, const char* name)
+	{
+		for (int i = 1; i < argc - 1; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+				return argv[i + 1];
+		}
+		return nullptr;
+	}
+
+	static std::vector<std::string> splitList(const char* list)
+	{
+		std::vector<std::string> items;
+		for (const char* c = list; *c;)
+		{
+			size_t length = strcspn(c, ",");
+			if (length > 0) items.emplace_back(c, length);
+			c += length + (c[length] == ',' ? 1 : 0);
+		}
+		return items;
+	}
+
+	static bool listed(const std::vector<std::string>& list, const char* name)
+	{
+		return list.empty() || std::find(list.begin(), list.end(), name) != list.end();
+	}
+
+	// quotes, backslashes and control characters of user text escaped for a JSON string
+	static std::string jsonEscape(const char* text)
+	{
+		std::string escaped;
+		for (const char* c = text; *c; c++)
+		{
+			char code[8];
+			if (*c == '"' || *c == '\\') { escaped += '\\'; escaped += *c; }
+			else if ((unsigned char)*c < 0x20) { snprintf(code, sizeof(code), "\\u%04x", (unsigned char)*c); escaped += code; }
+			else escaped += *c;
+		}
+		return escaped;
+	}
+
+	// linux resets the high water mark of the resident set when 5 is written to clear_refs
+	static void resetPeakMemory()
+	{
+		FILE* file = fopen("/proc/self/clear_refs", "w");
+		if (!file) return;
+		fputs("5", file);
+		fclose(file);
+	}
+
+	static uint64_t peakMemory()
+	{
+		FILE* file = fopen("/proc/self/status", "r");
+		if (file)
+		{
+			char line[256];
+			unsigned long long kilobytes = 0;
+			while (fgets(line, sizeof(line), file))
+			{
+				if (sscanf(line, "VmHWM: %llu kB", &kilobytes) == 1)
+					break;
+			}
+			fclose(file);
+			if (kilobytes > 0) return kilobytes * 1024;
+		}
+
+#ifdef BENCH_RUSAGE_SUPPORTED
+		struct rusage usage;
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+			return 0;
+#ifdef __APPLE__
+		return (uint64_t)usage.ru_maxrss;
+#else
+		return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+#else
+		return 0;
+#endif
+	}
+
+#ifdef BENCH_PERF_SUPPORTED
+	// user space only, which perf_event_paranoid up to 2 allows without privileges
+	static bool openCounters(BenchCounters* counters)
+	{
+		static const uint32_t types[Bench_Counter_Count] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+		static const uint64_t configs[Bench_Counter_Count] =
+		{
+			PERF_COUNT_HW_CPU_CYCLES,
+			PERF_COUNT_HW_INSTRUCTIONS,
+			PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+			PERF_COUNT_HW_CACHE_MISSES,
+			PERF_COUNT_HW_BRANCH_MISSES,
+			PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+		};
+
+		bool any = false;
+		for (uint32_t i = 0; i < Bench_Counter_Count; i++)
+		{
+			struct perf_event_attr attr;
+			memset(&attr, 0, sizeof(attr));
+			attr.size = sizeof(attr);
+			attr.type = types[i];
+			attr.config = configs[i];
+			attr.disabled = 1;
+			attr.inherit = 1;
+			attr.exclude_kernel = 1;
+			attr.exclude_hv = 1;
+			attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+			counters->fds[i] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+			if (counters->fds[i] < 0)
+				fprintf(stderr, "bench: %s counter unavailable, %s\n", s_CounterNames[i], strerror(errno));
+			any = any || counters->fds[i] >= 0;
+		}
+		return any;
+	}
+
+	static void closeCounters(BenchCounters* counters)
+	{
+		for (int& fd : counters->fds)
+		{
+			if (fd >= 0) close(fd);
+			fd = -1;
+		}
+	}
+
+	static void startCounters(const BenchCounters* counters)
+	{
+		if (!counters) return;
+		for (int fd : counters->fds)
+		{
+			if (fd < 0) continue;
+			ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+			ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+		}
+	}
+
+	// more events than hardware counters are time multiplexed, counts are scaled up to the
+	// whole run the way perf stat does
+	static void stopCounters(const BenchCounters* counters, BenchResult* result)
+	{
+		std::fill(result->counts, result->counts + Bench_Counter_Count, -1);
+		if (!counters) return;
+
+		for (uint32_t i = 0; i < Bench_Counter_Count; i++)
+		{
+			int fd = counters->fds[i];
+			if (fd < 0) continue;
+			ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+
+			uint64_t values[3]; // value, time enabled, time running
+			if (read(fd, values, sizeof(values)) != (ssize_t)sizeof(values) || values[2] == 0)
+				continue;
+			result->counts[i] = (int64_t)((double)values[0] * values[1] / values[2]);
+		}
+	}
+#else
+	static bool openCounters(BenchCounters* counters)
+	{
+		std::fill(counters->fds, counters->fds + Bench_Counter_Count, -1);
+		fprintf(stderr, "bench: hardware counters need linux perf_event_open\n");
+		return false;
+	}
+
+	static void closeCounters(BenchCounters* counters) {}
+	static void startCounters(const BenchCounters* counters) {}
+	static void stopCounters(const BenchCounters* counters, BenchResult* result) { std::fill(result->counts, result->counts + Bench_Counter_Count, -1); }
+#endif
+
+	// raw counts plus ipc and misses per cell update, null for anything that was not counted
+	static void writeCounters(FILE* output, const BenchResult* result)
+	{
+		const int64_t* counts = result->counts;
+		fprintf(output, ", \"counters\": {");
+		for (uint32_t i = 0; i < Bench_Counter_Count; i++)
+		{
+			if (counts[i] < 0) fprintf(output, " \"%s\": null,", s_CounterNames[i]);
+			else fprintf(output, " \"%s\": %lld,", s_CounterNames[i], (long long)counts[i]);
+		}
+
+		if (counts[Bench_Counter_Cycles] > 0 && counts[Bench_Counter_Instructions] >= 0)
+			fprintf(output, " \"ipc\": %.3f", (double)counts[Bench_Counter_Instructions] / counts[Bench_Counter_Cycles]);
+		else
+			fprintf(output, " \"ipc\": null");
+
+		static const BenchCounter perCell[] = { Bench_Counter_Cycles, Bench_Counter_Instructions, Bench_Counter_L1Misses, Bench_Counter_LLCMisses, Bench_Counter_BranchMisses, Bench_Counter_TLBMisses };
+		for (BenchCounter counter : perCell)
+		{
+			if (counts[counter] < 0) fprintf(output, ", \"%s_per_cell\": null", s_CounterNames[counter]);
+			else fprintf(output, ", \"%s_per_cell\": %.6g", s_CounterNames[counter], (double)counts[counter] / result->cellUpdates);
+		}
+		fprintf(output, " }");
+	}
+
+	// a pattern centred in the universe or a seeded soup
+	static void fillWorkload(const BenchWorkload* workload, uint32_t threadCount, LifeGrid* grid)
+	{
+		if (workload->pattern)
+		{
+			LifeGrid* pattern;
+			life::parsePattern(workload->pattern, &pattern, nullptr, nullptr);
+			life::placePattern(grid, pattern, (workload->size - pattern->width) / 2, (workload->size - pattern->height) / 2);
+			life::destroyGrid(pattern);
+		}
+		else
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = 1;
+			randomInfo.density = workload->density;
+			randomInfo.threadCount = threadCount;
+			life::fillRandom(grid, &randomInfo);
+		}
+	}
+
+	// the rows every thread steps are moved to its node once the cells are in place
+	static void prepareGrids(LifeGrid* grid, LifeGrid* next, uint32_t threadCount, bool numa)
+	{
+		life::setThreadPinning(numa);
+		if (!numa) return;
+		life::placeGrid(grid, threadCount, true);
+		life::placeGrid(next, threadCount, true);
+	}
+
+	static BenchResult runPacked(const BenchWorkload* workload, uint32_t threadCount, bool numa, const BenchCounters* counters)
+	{
+		BenchResult result{};
+		resetPeakMemory();
+
+		LifeGrid *grid, *next;
+		life::createGrid(&grid, workload->size, workload->size);
+		life::createGrid(&next, workload->size, workload->size);
+		fillWorkload(workload, threadCount, grid);
+		prepareGrids(grid, next, threadCount, numa);
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = LIFE_RULE_CONWAY;
+		stepInfo.topology = workload->topology;
+		stepInfo.threadCount = threadCount;
+
+		startCounters(counters);
+		auto startTime = std::chrono::steady_clock::now();
+		for (uint64_t generation = 0; generation < workload->generations; generation++)
+		{
+			life::step(grid, next, &stepInfo);
+			std::swap(grid, next);
+		}
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		stopCounters(counters, &result);
+
+		result.cellUpdates = (uint64_t)workload->size * workload->size * workload->generations;
+		result.peakMemory = peakMemory();
+		result.population = life::population(grid);
+		result.hash = life::hashGrid(grid);
+
+		// every generation reads the grid and writes it again
+		result.blockDepth = 1;
+		result.trafficBytes = 2.0 * grid->words.size() * sizeof(uint64_t);
+		life::gridPlacement(grid, &result.placement);
+		life::setThreadPinning(false);
+
+		life::destroyGrid(grid);
+		life::destroyGrid(next);
+		return result;
+	}
+
+	// the tuning runs before the timer starts, its depth is part of the result
+	static BenchResult runBlocked(const BenchWorkload* workload, uint32_t threadCount, uint32_t depth, bool numa, const BenchCounters* counters)
+	{
+		BenchResult result{};
+		LifeGrid *grid, *scratch;
+		life::createGrid(&grid, workload->size, workload->size);
+		life::createGrid(&scratch, workload->size, workload->size);
+		fillWorkload(workload, threadCount, grid);
+		prepareGrids(grid, scratch, threadCount, numa);
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = LIFE_RULE_CONWAY;
+		stepInfo.topology = workload->topology;
+		stepInfo.threadCount = threadCount;
+		if (depth == 0)
+			depth = life::tuneBlockDepth(grid, &stepInfo);
+		resetPeakMemory();
+
+		startCounters(counters);
+		auto startTime = std::chrono::steady_clock::now();
+		for (uint64_t generation = 0; generation < workload->generations; generation += UINT32_MAX)
+			life::stepBlocked(grid, scratch, (uint32_t)std::min<uint64_t>(workload->generations - generation, UINT32_MAX), depth, &stepInfo);
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		stopCounters(counters, &result);
+
+		result.cellUpdates = (uint64_t)workload->size * workload->size * workload->generations;
+		result.peakMemory = peakMemory();
+		result.population = life::population(grid);
+		result.hash = life::hashGrid(grid);
+
+		// a pass reads every band with its halo rows and writes the band once, for depth generations
+		uint32_t rows = life::blockRows(grid, depth), bands = (grid->height + rows - 1) / rows;
+		double rowBytes = grid->stride * sizeof(uint64_t);
+		result.blockDepth = depth;
+		result.trafficBytes = depth == 1 ? 2.0 * grid->height * rowBytes : (2.0 * grid->height + 2.0 * bands * depth) * rowBytes / depth;
+		life::gridPlacement(grid, &result.placement);
+		life::setThreadPinning(false);
+
+		life::destroyGrid(grid);
+		life::destroyGrid(scratch);
+		return result;
+	}
+
+	// 64 soups of the workload's size step together, one per bit of a word
+	static BenchResult runEnsemble(const BenchWorkload* workload, uint32_t threadCount, const BenchCounters* counters)
+	{
+		BenchResult result{};
+		resetPeakMemory();
+
+		LifeEnsembleCreateInfo createInfo{};
+		createInfo.width = workload->size;
+		createInfo.height = workload->size;
+		createInfo.universeCount = 64;
+		createInfo.maxPeriod = 1;
+
+		LifeEnsemble* ensemble;
+		if (life::createEnsemble(&ensemble, &createInfo) == Life_Result_Failed)
+			return result;
+
+		LifeGrid* grid;
+		life::createGrid(&grid, workload->size, workload->size);
+		for (uint32_t universe = 0; universe < life::ensembleUniverses(ensemble); universe++)
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = universe + 1;
+			randomInfo.density = workload->density;
+			randomInfo.threadCount = 1;
+			life::fillRandom(grid, &randomInfo);
+			life::setEnsembleUniverse(ensemble, universe, grid);
+		}
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = LIFE_RULE_CONWAY;
+		stepInfo.topology = workload->topology;
+		stepInfo.threadCount = threadCount;
+
+		startCounters(counters);
+		auto startTime = std::chrono::steady_clock::now();
+		for (uint64_t generation = 0; generation < workload->generations; generation++)
+			life::stepEnsemble(ensemble, &stepInfo);
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		stopCounters(counters, &result);
+
+		uint32_t universes = life::ensembleUniverses(ensemble);
+		std::vector<uint64_t> populations(universes);
+		life::ensemblePopulations(ensemble, populations.data());
+
+		result.cellUpdates = (uint64_t)workload->size * workload->size * workload->generations * universes;
+		result.peakMemory = peakMemory();
+		for (uint64_t population : populations)
+			result.population += population;
+
+		// the first universe is the same soup the packed engine steps
+		life::getEnsembleUniverse(ensemble, 0, grid);
+		result.hash = life::hashGrid(grid);
+
+		life::destroyGrid(grid);
+		life::destroyEnsemble(ensemble);
+		return result;
+	}
+
+	// the counters also see the workers filling their stripes and the coordinator waiting
+	static BenchResult runDistributed(const BenchWorkload* workload, uint32_t threadCount, const BenchCounters* counters, bool* ran)
+	{
+		BenchResult result{};
+
+		char name[64];
+		snprintf(name, sizeof(name), "/cgol-bench-%ld", (long)life::randomWord(std::chrono::steady_clock::now().time_since_epoch().count(), 0) & 0xFFFFFF);
+
+		LifeDistributedInfo distributedInfo{};
+		distributedInfo.width = workload->size;
+		distributedInfo.height = workload->size;
+		distributedInfo.workerCount = threadCount;
+		distributedInfo.slots = 4;
+		distributedInfo.syncInterval = (uint32_t)workload->generations;
+		distributedInfo.generations = workload->generations;
+		distributedInfo.rule = LIFE_RULE_CONWAY;
+		distributedInfo.topology = workload->topology;
+		distributedInfo.seed = 1;
+		distributedInfo.density = workload->density;
+		distributedInfo.name = name;
+
+		resetPeakMemory();
+		LifeDistributedResult distributedResult{};
+		startCounters(counters);
+		*ran = life::runDistributed(&distributedInfo, &distributedResult) == Life_Result_Success;
+		stopCounters(counters, &result);
+
+		result.seconds = distributedResult.seconds;
+		result.cellUpdates = (uint64_t)workload->size * workload->size * workload->generations;
+		result.peakMemory = peakMemory() + distributedResult.workerPeakMemory;
+		result.population = distributedResult.reduction.population;
+		result.hash = distributedResult.reduction.hash;
+		return result;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace bench;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--help") == 0)
+		{
+			printf("%s", s_Usage);
+			return 0;
+		}
+	}
+
+	const char* value;
+	std::vector<std::string> workloadNames, engineNames;
+	if ((value = optionValue(argc, argv, "--workloads"))) workloadNames = splitList(value);
+	if ((value = optionValue(argc, argv, "--engines")))   engineNames = splitList(value);
+
+	std::vector<uint32_t> threadCounts, sizes = { 256, 1024, 4096, 16384, 32768 }, densities = { 10, 20, 30, 40, 50 };
+	if ((value = optionValue(argc, argv, "--threads")))
+	{
+		for (const std::string& item : splitList(value)) threadCounts.push_back(strtoul(item.c_str(), nullptr, 10));
+	}
+	else
+	{
+		uint32_t hardware = life::hardwareThreads();
+		for (uint32_t threads = 1; threads < hardware; threads *= 2) threadCounts.push_back(threads);
+		threadCounts.push_back(hardware);
+	}
+	if ((value = optionValue(argc, argv, "--sizes")))
+	{
+		sizes.clear();
+		for (const std::string& item : splitList(value)) sizes.push_back(strtoul(item.c_str(), nullptr, 10));
+	}
+	if ((value = optionValue(argc, argv, "--densities")))
+	{
+		densities.clear();
+		for (const std::string& item : splitList(value)) densities.push_back(strtoul(item.c_str(), nullptr, 10));
+	}
+
+	double work = 4294967296.0;
+	if ((value = optionValue(argc, argv, "--work"))) work = strtod(value, nullptr);
+
+	std::vector<uint32_t> depths = { 0 };
+	if ((value = optionValue(argc, argv, "--depths")))
+	{
+		depths.clear();
+		for (const std::string& item : splitList(value)) depths.push_back(strtoul(item.c_str(), nullptr, 10));
+	}
+
+	std::vector<BenchWorkload> workloads;
+	if (listed(workloadNames, "r-pentomino"))
+		workloads.push_back({ "r-pentomino", s_RPentomino, 1024, 0.0f, 1103, Life_Topology_Plane });
+	if (listed(workloadNames, "gosper-gun"))
+		workloads.push_back({ "gosper-gun", s_GosperGun, 1024, 0.0f, 100000, Life_Topology_Plane });
+	if (listed(workloadNames, "soup"))
+	{
+		for (uint32_t size : sizes)
+		{
+			for (uint32_t density : densities)
+			{
+				// every soup does about the same work so small universes are timed long enough, only the largest
+				// are held to a few generations
+				uint64_t generations = (uint64_t)std::max(work / ((double)size * size), 4.0);
+				workloads.push_back({ "soup", nullptr, size, density * 0.01f, generations, Life_Topology_Torus });
+			}
+		}
+	}
+
+	bool numa = false;
+	for (int i = 1; i < argc; i++)
+		numa = numa || strcmp(argv[i], "--numa") == 0;
+
+	// without any counter the results are still written, just without the counters object
+	BenchCounters counterFds;
+	bool counting = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--counters") == 0)
+			counting = openCounters(&counterFds);
+	}
+	if (counting)
+		fprintf(stderr, "bench: counting user space events with perf_event_open\n");
+	const BenchCounters* counters = counting ? &counterFds : nullptr;
+
+	const char* outputPath = optionValue(argc, argv, "--output");
+	FILE* output = outputPath ? fopen(outputPath, "w") : stdout;
+	if (!output)
+	{
+		fprintf(stderr, "bench: failed to open %s\n", outputPath);
+		return 1;
+	}
+
+	const char* label = optionValue(argc, argv, "--label");
+	fprintf(output, "{\n  \"label\": \"%s\",\n  \"hardware_threads\": %u,\n  \"results\": [", jsonEscape(label ? label : "").c_str(), life::hardwareThreads());
+
+	bool first = true;
+	for (const BenchWorkload& workload : workloads)
+	{
+		for (uint32_t engine = Bench_Engine_Packed; engine <= Bench_Engine_Blocked; engine++)
+		{
+			if (!listed(engineNames, s_Engines[engine]))
+				continue;
+			// the ensemble runs soups small enough for 64 copies, the distributed engine large soups
+			if (engine == Bench_Engine_Ensemble && (workload.pattern || workload.size > 1024))
+				continue;
+			if (engine == Bench_Engine_Distributed && (workload.pattern || workload.size < 1024))
+				continue;
+			// blocking only pays once a universe no longer fits in cache
+			if (engine == Bench_Engine_Blocked && workload.size < 1024)
+				continue;
+
+			for (uint32_t run = 0; run < threadCounts.size() * (engine == Bench_Engine_Blocked ? depths.size() : 1); run++)
+			{
+				uint32_t threadCount = threadCounts[run % threadCounts.size()];
+				uint32_t depth = engine == Bench_Engine_Blocked ? depths[run / threadCounts.size()] : 0;
+				if (engine == Bench_Engine_Distributed && threadCount < 2)
+					continue;
+
+				fprintf(stderr, "bench: %s %u x %u %.0f%% on %s with %u threads\n", workload.name.c_str(), workload.size, workload.size,
+					workload.density * 100.0f, s_Engines[engine], threadCount);
+
+				bool ran = true;
+				BenchResult result;
+				if (engine == Bench_Engine_Packed)
+					result = runPacked(&workload, threadCount, numa, counters);
+				else if (engine == Bench_Engine_Ensemble)
+					result = runEnsemble(&workload, threadCount, counters);
+				else if (engine == Bench_Engine_Distributed)
+					result = runDistributed(&workload, threadCount, counters, &ran);
+				else
+					result = runBlocked(&workload, threadCount, depth, numa, counters);
+
+				if (!ran || result.seconds <= 0.0)
+				{
+					fprintf(stderr, "bench: %s on %s failed\n", workload.name.c_str(), s_Engines[engine]);
+					continue;
+				}
+
+				fprintf(output, "%s\n    { \"workload\": \"%s\", \"engine\": \"%s\", \"threads\": %u, \"width\": %u, \"height\": %u, \"density\": %.2f, "
+					"\"generations\": %llu, \"seconds\": %.6f, \"generations_per_sec\": %.3f, \"cell_updates_per_sec\": %.6g, \"ns_per_cell\": %.6f, "
+					"\"peak_rss_bytes\": %llu, \"population\": %llu, \"hash\": \"%016llx\"",
+					first ? "" : ",", jsonEscape(workload.name.c_str()).c_str(), s_Engines[engine], threadCount, workload.size, workload.size, workload.density,
+					(unsigned long long)workload.generations, result.seconds, workload.generations / result.seconds, result.cellUpdates / result.seconds,
+					result.seconds * 1e9 / result.cellUpdates, (unsigned long long)result.peakMemory, (unsigned long long)result.population,
+					(unsigned long long)result.hash);
+				if (result.blockDepth > 0)
+					fprintf(output, ", \"block_depth\": %u, \"memory_bytes_per_generation\": %.0f", result.blockDepth, result.trafficBytes);
+				if (result.placement.nodeCount > 0)
+				{
+					// sampled pages of the grid per node, pages never touched are on none
+					const LifePlacementReport* placement = &result.placement;
+					fprintf(output, ", \"numa\": %s, \"huge_page_bytes\": %llu, \"sampled_pages\": %llu, \"node_pages\": [", numa ? "true" : "false",
+						(unsigned long long)placement->hugePageBytes, (unsigned long long)placement->sampledPages);
+					for (uint32_t node = 0; node < std::min<uint32_t>(placement->nodeCount, LIFE_MAX_NODES); node++)
+						fprintf(output, "%s%llu", node ? ", " : "", (unsigned long long)placement->nodePages[node]);
+					fprintf(output, "]");
+				}
+				if (counters)
+					writeCounters(output, &result);
+				fprintf(output, " }");
+				fflush(output);
+				first = false;
+			}
+		}
+	}
+
+	fprintf(output, "\n  ]\n}\n");
+	if (outputPath) fclose(output);
+	if (counting) closeCounters(&counterFds);
+	return 0;
+}
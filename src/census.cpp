@@ -0,0 +1,230 @@
+#include "census.h"
+#include "objects.h"
+#include "pattern.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define CENSUS_HISTORY 512         // generations of state hashes kept to detect periodic ash
+#define CENSUS_MARGIN 24           // width of the border band where escaping spaceships are removed
+#define CENSUS_ESCAPE_INTERVAL 32  // generations between checks of the border band
+
+// a c/2 ship outside the band at one check is still clear of the edge at the next
+static_assert(CENSUS_MARGIN > CENSUS_ESCAPE_INTERVAL / 2 + 4, "escaping spaceships would reach the edge between checks");
+
+namespace life
+{
+	static uint32_t removeSpaceships(LifeGrid* universe, uint32_t distance, const LifeSeparateInfo* separateInfo, std::unordered_map<std::string, uint64_t>* tally, bool* unknown);
+	static uint32_t removeEscapees(LifeGrid* universe, const LifeSeparateInfo* separateInfo, std::unordered_map<std::string, uint64_t>* tally);
+
+	// tallies and erases the spaceships among the objects touching the border band, unknown
+	// tells whether any other object there failed to classify
+	static uint32_t removeSpaceships(LifeGrid* universe, uint32_t distance, const LifeSeparateInfo* separateInfo, std::unordered_map<std::string, uint64_t>* tally, bool* unknown)
+	{
+		uint32_t removed = 0;
+		std::vector<LifeObject> objects;
+		findObjects(universe, distance, &objects);
+
+		for (LifeObject& object : objects)
+		{
+			if (object.x >= CENSUS_MARGIN && object.y >= CENSUS_MARGIN &&
+				object.x + object.cells.width <= universe->width - CENSUS_MARGIN &&
+				object.y + object.cells.height <= universe->height - CENSUS_MARGIN)
+				continue;
+
+			classifyObject(&object, separateInfo);
+			if (object.type != Life_Object_Spaceship)
+			{
+				*unknown |= object.type == Life_Object_Unknown;
+				continue;
+			}
+
+			// every cell of the object is alive, so xoring it in erases just the object
+			(*tally)[object.code]++;
+			pasteRegion(universe, &object.cells, object.x, object.y, Life_Blend_Xor);
+			removed++;
+		}
+
+		return removed;
+	}
+
+	// spaceships reaching the border band are tallied and erased before they hit the edge, some
+	// phases split apart (an lwss at distance 1) so unknown pieces are retried one distance wider
+	// the way separateObjects merges them
+	static uint32_t removeEscapees(LifeGrid* universe, const LifeSeparateInfo* separateInfo, std::unordered_map<std::string, uint64_t>* tally)
+	{
+		bool unknown = false;
+		uint32_t removed = removeSpaceships(universe, separateInfo->distance, separateInfo, tally, &unknown);
+		if (unknown)
+			removed += removeSpaceships(universe, (separateInfo->distance == 0 ? 1 : separateInfo->distance) + 1, separateInfo, tally, &unknown);
+		return removed;
+	}
+
+	LifeResult runCensus(const LifeCensusInfo* censusInfo, LifeCensusResult* result)
+	{
+		if (censusInfo->soupSize == 0 || censusInfo->universeSize < censusInfo->soupSize + CENSUS_MARGIN * 4)
+		{
+			printf("census: universe size must exceed the soup size by at least %d cells\n", CENSUS_MARGIN * 4);
+			return Life_Result_Failed;
+		}
+
+		uint32_t threadCount = censusInfo->threadCount == 0 ? hardwareThreads() : censusInfo->threadCount;
+
+		std::atomic<uint64_t> nextSoup{ 0 }, soupsDone{ 0 };
+		std::mutex resultMutex;
+
+		*result = LifeCensusResult{};
+		auto startTime = std::chrono::steady_clock::now();
+
+		auto worker = [&]()
+		{
+			LifeGrid *universe, *next, *soup;
+			createGrid(&universe, censusInfo->universeSize, censusInfo->universeSize);
+			createGrid(&next, censusInfo->universeSize, censusInfo->universeSize);
+			createGrid(&soup, censusInfo->soupSize, censusInfo->soupSize);
+
+			LifeStepInfo stepInfo{};
+			stepInfo.rule = censusInfo->rule;
+			stepInfo.topology = Life_Topology_Plane;
+			stepInfo.threadCount = 1;
+
+			LifeSeparateInfo separateInfo{};
+			separateInfo.rule = censusInfo->rule;
+			separateInfo.distance = censusInfo->distance;
+			separateInfo.maxPeriod = censusInfo->maxPeriod;
+			createObjectCache(&separateInfo.cache);
+
+			std::unordered_map<std::string, uint64_t> tally;
+			std::vector<LifeObject> objects;
+
+			LifeCycleDetector* detector;
+			createCycleDetector(&detector, CENSUS_HISTORY);
+			LifeCycle cycle;
+			uint64_t hash;
+			stepInfo.hash = &hash;
+			uint64_t unstable = 0, objectCount = 0;
+
+			for (;;)
+			{
+				uint64_t soupIndex = nextSoup.fetch_add(1);
+				if (soupIndex >= censusInfo->soupCount) break;
+
+				LifeRandomInfo randomInfo{};
+				randomInfo.seed = randomWord(censusInfo->seed, soupIndex);
+				randomInfo.density = censusInfo->density;
+				randomInfo.threadCount = 1;
+				fillRandom(soup, &randomInfo);
+
+				clearGrid(universe);
+				placePattern(universe, soup, (int32_t)(universe->width - soup->width) / 2, (int32_t)(universe->height - soup->height) / 2);
+
+				bool stable = false;
+				resetCycleDetector(detector);
+				recordCycle(detector, 0, hashGrid(universe), &cycle);
+				for (uint32_t gen = 1; gen <= censusInfo->maxGenerations && !stable; gen++)
+				{
+					step(universe, next, &stepInfo);
+					std::swap(universe, next);
+
+					uint32_t escaped = gen % CENSUS_ESCAPE_INTERVAL == 0 ? removeEscapees(universe, &separateInfo, &tally) : 0;
+					if (escaped > 0)
+					{
+						objectCount += escaped;
+						hash = hashGrid(universe);
+					}
+
+					stable = recordCycle(detector, gen, hash, &cycle);
+				}
+
+				if (!stable)
+				{
+					unstable++;
+				}
+				else
+				{
+					separateObjects(universe, &separateInfo, &objects);
+					for (const LifeObject& object : objects)
+						tally[object.code]++;
+					objectCount += objects.size();
+				}
+
+				soupsDone++;
+			}
+
+			destroyGrid(universe);
+			destroyGrid(next);
+			destroyGrid(soup);
+			destroyObjectCache(separateInfo.cache);
+			destroyCycleDetector(detector);
+
+			std::lock_guard<std::mutex> lock(resultMutex);
+			result->unstable += unstable;
+			result->objects += objectCount;
+			for (const auto& entry : tally)
+				result->tally[entry.first] += entry.second;
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 0; i < threadCount; i++)
+			threads.emplace_back(worker);
+
+		auto lastReport = startTime;
+		while (soupsDone.load() < censusInfo->soupCount && censusInfo->progressInterval > 0)
+		{
+			std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+			auto now = std::chrono::steady_clock::now();
+			if (std::chrono::duration<double>(now - lastReport).count() < censusInfo->progressInterval) continue;
+			lastReport = now;
+
+			double seconds = std::chrono::duration<double>(now - startTime).count();
+			uint64_t done = soupsDone.load();
+			printf("census: %llu/%llu soups, %.1f soups/sec\n", (unsigned long long)done, (unsigned long long)censusInfo->soupCount, done / seconds);
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+
+		result->soups = censusInfo->soupCount;
+		result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		return Life_Result_Success;
+	}
+
+	LifeResult writeCensus(const char* path, const LifeCensusInfo* censusInfo, const LifeCensusResult* result)
+	{
+		FILE* file = fopen(path, "w");
+		if (!file)
+		{
+			printf("census: failed to open %s\n", path);
+			return Life_Result_Failed;
+		}
+
+		std::vector<std::pair<std::string, uint64_t>> entries(result->tally.begin(), result->tally.end());
+		std::sort(entries.begin(), entries.end(), [](const std::pair<std::string, uint64_t>& a, const std::pair<std::string, uint64_t>& b)
+		{
+			return a.second != b.second ? a.second > b.second : a.first < b.first;
+		});
+
+		char rule[32];
+		ruleString(&censusInfo->rule, rule, sizeof(rule));
+
+		fprintf(file, "# rule: %s\n", rule);
+		fprintf(file, "# seed: %llu\n", (unsigned long long)censusInfo->seed);
+		fprintf(file, "# soup: %ux%u at %.2f density\n", censusInfo->soupSize, censusInfo->soupSize, censusInfo->density);
+		fprintf(file, "# soups: %llu (%llu unstable)\n", (unsigned long long)result->soups, (unsigned long long)result->unstable);
+		fprintf(file, "# objects: %llu\n", (unsigned long long)result->objects);
+		fprintf(file, "# soups/sec: %.1f\n", result->seconds > 0.0 ? result->soups / result->seconds : 0.0);
+
+		for (const auto& entry : entries)
+			fprintf(file, "%s %llu\n", entry.first.c_str(), (unsigned long long)entry.second);
+
+		fclose(file);
+		return Life_Result_Success;
+	}
+}
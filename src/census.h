@@ -0,0 +1,36 @@
+#pragma once
+
+#include "life.h"
+
+#include <string>
+#include <unordered_map>
+
+struct LifeCensusInfo
+{
+	uint64_t seed;
+	uint64_t soupCount;
+	uint32_t soupSize;         // soups are soupSize x soupSize
+	uint32_t universeSize;     // each soup evolves in the middle of a universeSize x universeSize plane
+	uint32_t maxGenerations;   // soups still active after this many generations are counted as unstable
+	uint32_t threadCount;      // 0 uses every hardware thread
+	uint32_t progressInterval; // seconds between progress lines, 0 prints nothing
+	uint32_t distance;         // neighbourhood distance used to separate the ash into objects
+	uint32_t maxPeriod;        // longest object period the classifier looks for
+	float density;
+	LifeRule rule;
+};
+
+struct LifeCensusResult
+{
+	uint64_t soups;
+	uint64_t unstable;
+	uint64_t objects;
+	double seconds;
+	std::unordered_map<std::string, uint64_t> tally;
+};
+
+namespace life
+{
+	LifeResult runCensus(const LifeCensusInfo* censusInfo, LifeCensusResult* result);
+	LifeResult writeCensus(const char* path, const LifeCensusInfo* censusInfo, const LifeCensusResult* result);
+}
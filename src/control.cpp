@@ -0,0 +1,541 @@
+#include "control.h"
+#include "pattern.h"
+#include "trace.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define LIFE_SOCKET_SUPPORTED
+#endif
+
+#define CONTROL_READ_SIZE 65536
+#define CONTROL_MAX_LINE  4096
+
+struct ControlCommand
+{
+	uint32_t connection;
+	std::string text;
+};
+
+struct ControlConnection
+{
+	int fd;
+	uint32_t id;
+	std::string input, output;
+	uint64_t outstanding; // commands handed to the simulation and not answered yet
+	bool closing;         // the client stopped sending, close once everything is answered
+};
+
+// the network thread fills commands, the simulation swaps them out and fills replies, the
+// mutex is only held to move those vectors so neither side waits on the other's work
+struct LifeControlServer
+{
+	char path[256];
+	int listener;
+	int wake[2];
+	std::thread thread;
+	std::atomic<bool> stop;
+
+	std::mutex mutex;
+	std::condition_variable arrived;
+	std::vector<ControlCommand> commands;
+	std::vector<ControlCommand> replies;
+	std::vector<ControlCommand> executing;
+	size_t executed; // commands of executing answered so far
+	bool stepping;   // executing[executed] is a step waiting for its generations
+};
+
+namespace life
+{
+	static void splitWords(const std::string& line, std::vector<std::string>* words);
+	static std::string restOfLine(const std::string& line);
+	static bool parseRegion(const std::vector<std::string>& words, int32_t* x, int32_t* y, uint32_t* width, uint32_t* height);
+	static bool parseCount(const std::string& word, uint64_t* count);
+	// plain decimal digits only, so a negative count cannot wrap around
+	static bool parseCount(const std::string& word, uint64_t* count)
+	{
+		if (word.empty() || word.find_first_not_of("0123456789") != std::string::npos)
+			return false;
+
+		errno = 0;
+		*count = strtoull(word.c_str(), nullptr, 10);
+		return errno == 0;
+	}
+
+	static std::string executeCommand(const std::string& line, LifeControlTarget* target);
+
+	static void splitWords(const std::string& line, std::vector<std::string>* words)
+	{
+		words->clear();
+		size_t start = line.find_first_not_of(" \t\r");
+		while (start != std::string::npos)
+		{
+			size_t end = line.find_first_of(" \t\r", start);
+			words->push_back(line.substr(start, end == std::string::npos ? std::string::npos : end - start));
+			start = end == std::string::npos ? end : line.find_first_not_of(" \t\r", end);
+		}
+	}
+
+	// paths may contain spaces, everything after the command word is the argument
+	static std::string restOfLine(const std::string& line)
+	{
+		size_t start = line.find_first_not_of(" \t");
+		start = line.find_first_of(" \t", start);
+		start = start == std::string::npos ? start : line.find_first_not_of(" \t", start);
+		if (start == std::string::npos) return std::string();
+
+		size_t end = line.find_last_not_of(" \t\r");
+		return line.substr(start, end - start + 1);
+	}
+
+	// "x y" is a single cell, "x y width height" a rectangle
+	static bool parseRegion(const std::vector<std::string>& words, int32_t* x, int32_t* y, uint32_t* width, uint32_t* height)
+	{
+		if (words.size() != 3 && words.size() != 5)
+			return false;
+
+		*x = (int32_t)strtol(words[1].c_str(), nullptr, 10);
+		*y = (int32_t)strtol(words[2].c_str(), nullptr, 10);
+		*width = words.size() == 5 ? (uint32_t)strtoul(words[3].c_str(), nullptr, 10) : 1;
+		*height = words.size() == 5 ? (uint32_t)strtoul(words[4].c_str(), nullptr, 10) : 1;
+		return true;
+	}
+
+	static std::string executeCommand(const std::string& line, LifeControlTarget* target)
+	{
+		std::vector<std::string> words;
+		splitWords(line, &words);
+		if (words.empty())
+			return "error empty command";
+
+		const std::string& name = words[0];
+		char reply[256];
+
+		if (name == "generation")
+			snprintf(reply, sizeof(reply), "ok %llu", (unsigned long long)target->generation);
+		else if (name == "population")
+			snprintf(reply, sizeof(reply), "ok %llu", (unsigned long long)population(target->grid));
+		else if (name == "bbox")
+		{
+			uint32_t x, y, width, height;
+			if (boundingBox(target->grid, &x, &y, &width, &height))
+				snprintf(reply, sizeof(reply), "ok %u %u %u %u", x, y, width, height);
+			else
+				snprintf(reply, sizeof(reply), "ok empty");
+		}
+		else if (name == "step")
+		{
+			// the owner steps the generations between its own checks, the reply waits for them
+			uint64_t count = 1;
+			if (words.size() > 2 || (words.size() == 2 && !parseCount(words[1], &count)))
+				return "error expected a generation count";
+			target->steps = count;
+			snprintf(reply, sizeof(reply), "ok %llu", (unsigned long long)target->generation);
+		}
+		else if (name == "keyframe")
+		{
+			target->keyframe = true;
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "pause" || name == "resume")
+		{
+			target->paused = name == "pause";
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "rule")
+		{
+			if (words.size() != 2 || parseRule(words[1].c_str(), &target->stepInfo.rule) == Life_Result_Failed)
+				return "error invalid rule";
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "load")
+		{
+			LifeGrid* pattern;
+			std::string path = restOfLine(line);
+			if (path.empty() || loadPattern(path.c_str(), &pattern, nullptr, nullptr) == Life_Result_Failed)
+				return "error failed to load " + path;
+
+			clearGrid(target->grid);
+			placePattern(target->grid, pattern, ((int32_t)target->grid->width - (int32_t)pattern->width) / 2, ((int32_t)target->grid->height - (int32_t)pattern->height) / 2);
+			snprintf(reply, sizeof(reply), "ok %u %u", pattern->width, pattern->height);
+			destroyGrid(pattern);
+
+			target->generation = 0;
+			target->changed = true;
+		}
+		else if (name == "snapshot")
+		{
+			std::string path = restOfLine(line);
+			if (path.empty() || savePattern(path.c_str(), target->grid, &target->stepInfo.rule) == Life_Result_Failed)
+				return "error failed to write " + path;
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "set" || (name == "clear" && words.size() > 1))
+		{
+			int32_t x, y;
+			uint32_t width, height;
+			if (!parseRegion(words, &x, &y, &width, &height))
+				return "error expected x y [width height]";
+
+			fillRegion(target->grid, x, y, width, height, name == "set");
+			target->changed = true;
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "clear")
+		{
+			clearGrid(target->grid);
+			target->changed = true;
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "transform")
+		{
+			// the spare grid takes the result, a transpose has to keep the universe's size
+			LifeTransform transform;
+			if (words.size() != 2 || parseTransform(words[1].c_str(), &transform) == Life_Result_Failed)
+				return "error expected rot90, rot180, rot270, flipx, flipy, transpose or antitranspose";
+			if ((transform & 4) && target->grid->width != target->grid->height)
+				return "error only a square universe can be transposed";
+
+			transformGrid(target->grid, transform, target->next);
+			std::swap(target->grid, target->next);
+			target->changed = true;
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else if (name == "random")
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = words.size() > 1 ? strtoull(words[1].c_str(), nullptr, 10) : 1;
+			randomInfo.density = words.size() > 2 ? strtof(words[2].c_str(), nullptr) : 0.5f;
+			randomInfo.threadCount = target->stepInfo.threadCount;
+			fillRandom(target->grid, &randomInfo);
+			target->generation = 0;
+			target->changed = true;
+			snprintf(reply, sizeof(reply), "ok");
+		}
+		else
+			return "error unknown command " + name;
+
+		return reply;
+	}
+
+	uint32_t serviceControl(LifeControlServer* server, LifeControlTarget* target)
+	{
+		if (target->steps > 0)
+			return 0;
+
+		if (server->executed == server->executing.size())
+		{
+			std::unique_lock<std::mutex> lock(server->mutex, std::try_to_lock);
+			if (!lock.owns_lock() || server->commands.empty())
+				return 0;
+			server->executing.clear();
+			server->executed = 0;
+			std::swap(server->commands, server->executing);
+		}
+		LIFE_TRACE_SCOPE("control", "commands");
+
+		std::vector<ControlCommand> replies;
+		for (; server->executed < server->executing.size(); server->executed++)
+		{
+			const ControlCommand& command = server->executing[server->executed];
+
+			char stepped[32];
+			snprintf(stepped, sizeof(stepped), "ok %llu", (unsigned long long)target->generation);
+			std::string reply = server->stepping ? std::string(stepped) : executeCommand(command.text, target);
+			server->stepping = target->steps > 0;
+			if (server->stepping)
+				break;
+
+			replies.push_back({ command.connection, std::move(reply) });
+		}
+
+		uint32_t count = (uint32_t)replies.size();
+		if (count == 0)
+			return 0;
+
+		{
+			std::lock_guard<std::mutex> lock(server->mutex);
+			server->replies.insert(server->replies.end(), std::make_move_iterator(replies.begin()), std::make_move_iterator(replies.end()));
+		}
+
+#ifdef LIFE_SOCKET_SUPPORTED
+		char wake = 1;
+		if (write(server->wake[1], &wake, 1) < 0) {}
+#endif
+		return count;
+	}
+
+	void waitControl(LifeControlServer* server, uint32_t milliseconds)
+	{
+		std::unique_lock<std::mutex> lock(server->mutex);
+		server->arrived.wait_for(lock, std::chrono::milliseconds(milliseconds), [server]() { return !server->commands.empty(); });
+	}
+
+#ifdef LIFE_SOCKET_SUPPORTED
+	static void serveControl(LifeControlServer* server);
+	static bool setNonBlocking(int fd);
+	static bool clearStaleSocket(const char* path, const sockaddr_un* address);
+	static bool readConnection(ControlConnection* connection, std::vector<ControlCommand>* commands);
+	static bool writeConnection(ControlConnection* connection);
+
+	static bool setNonBlocking(int fd)
+	{
+		int flags = fcntl(fd, F_GETFL, 0);
+		return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+	}
+
+	// only a socket nothing answers on is removed, any other file at path is left alone
+	static bool clearStaleSocket(const char* path, const sockaddr_un* address)
+	{
+		struct stat info;
+		if (lstat(path, &info) != 0)
+			return errno == ENOENT;
+		if (!S_ISSOCK(info.st_mode))
+			return false;
+
+		int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (probe < 0) return false;
+		bool live = connect(probe, (const sockaddr*)address, sizeof(*address)) == 0;
+		close(probe);
+		return !live && unlink(path) == 0;
+	}
+
+	// takes everything the client sent so far and splits it into commands, false once the client hung up
+	static bool readConnection(ControlConnection* connection, std::vector<ControlCommand>* commands)
+	{
+		char buffer[CONTROL_READ_SIZE];
+		for (;;)
+		{
+			ssize_t count = read(connection->fd, buffer, sizeof(buffer));
+			if (count > 0)
+			{
+				connection->input.append(buffer, count);
+				continue;
+			}
+			if (count < 0 && errno == EINTR) continue;
+			if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			return false;
+		}
+
+		size_t start = 0, end;
+		while ((end = connection->input.find('\n', start)) != std::string::npos)
+		{
+			if (end > start)
+			{
+				commands->push_back({ connection->id, connection->input.substr(start, end - start) });
+				connection->outstanding++;
+			}
+			start = end + 1;
+		}
+		connection->input.erase(0, start);
+
+		if (connection->input.size() > CONTROL_MAX_LINE)
+		{
+			connection->output += "error line too long\n";
+			connection->input.clear();
+			return false;
+		}
+		return true;
+	}
+
+	static bool writeConnection(ControlConnection* connection)
+	{
+#ifdef MSG_NOSIGNAL
+		int flags = MSG_NOSIGNAL;
+#else
+		int flags = 0;
+#endif
+		size_t sent = 0;
+		while (sent < connection->output.size())
+		{
+			ssize_t count = send(connection->fd, connection->output.data() + sent, connection->output.size() - sent, flags);
+			if (count > 0) { sent += count; continue; }
+			if (count < 0 && errno == EINTR) continue;
+			if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+			return false;
+		}
+
+		connection->output.erase(0, sent);
+		return true;
+	}
+
+	static void serveControl(LifeControlServer* server)
+	{
+		std::vector<ControlConnection> connections;
+		std::vector<ControlCommand> commands, replies;
+		std::vector<pollfd> fds;
+		uint32_t nextId = 1;
+
+		while (!server->stop.load())
+		{
+			fds.clear();
+			fds.push_back({ server->listener, POLLIN, 0 });
+			fds.push_back({ server->wake[0], POLLIN, 0 });
+			for (const ControlConnection& connection : connections)
+				fds.push_back({ connection.fd, (short)((connection.closing ? 0 : POLLIN) | (connection.output.empty() ? 0 : POLLOUT)), 0 });
+
+			if (poll(fds.data(), fds.size(), -1) < 0 && errno != EINTR)
+				break;
+
+			// replies from the simulation go out in the order their commands came in
+			if (fds[1].revents & POLLIN)
+			{
+				char drain[256];
+				while (read(server->wake[0], drain, sizeof(drain)) > 0) {}
+
+				{
+					std::lock_guard<std::mutex> lock(server->mutex);
+					std::swap(server->replies, replies);
+				}
+
+				for (ControlCommand& reply : replies)
+				{
+					for (ControlConnection& connection : connections)
+					{
+						if (connection.id != reply.connection) continue;
+						connection.output += reply.text;
+						connection.output += '\n';
+						connection.outstanding--;
+						break;
+					}
+				}
+				replies.clear();
+			}
+
+			for (size_t i = 0; i < connections.size(); i++)
+			{
+				ControlConnection& connection = connections[i];
+				short events = fds[i + 2].revents;
+
+				if ((events & (POLLIN | POLLHUP | POLLERR)) && !connection.closing)
+					connection.closing = !readConnection(&connection, &commands);
+				if (!connection.output.empty() && !writeConnection(&connection))
+				{
+					connection.output.clear();
+					connection.closing = true;
+				}
+			}
+
+			if (!commands.empty())
+			{
+				{
+					std::lock_guard<std::mutex> lock(server->mutex);
+					server->commands.insert(server->commands.end(), std::make_move_iterator(commands.begin()), std::make_move_iterator(commands.end()));
+				}
+				server->arrived.notify_one();
+				commands.clear();
+			}
+
+			connections.erase(std::remove_if(connections.begin(), connections.end(), [](const ControlConnection& connection)
+			{
+				bool done = connection.closing && connection.outstanding == 0 && connection.output.empty();
+				if (done) close(connection.fd);
+				return done;
+			}), connections.end());
+
+			if (fds[0].revents & POLLIN)
+			{
+				int fd;
+				while ((fd = accept(server->listener, nullptr, nullptr)) >= 0)
+				{
+					if (!setNonBlocking(fd)) { close(fd); continue; }
+#ifdef SO_NOSIGPIPE
+					int one = 1;
+					setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+					connections.push_back({ fd, nextId++, std::string(), std::string(), 0, false });
+				}
+			}
+		}
+
+		for (const ControlConnection& connection : connections)
+			close(connection.fd);
+	}
+
+	LifeResult createControlServer(LifeControlServer** server, const char* path)
+	{
+		sockaddr_un address{};
+		if (strlen(path) >= sizeof(address.sun_path) || strlen(path) >= sizeof(LifeControlServer::path))
+		{
+			printf("control: socket path %s is too long\n", path);
+			return Life_Result_Failed;
+		}
+		address.sun_family = AF_UNIX;
+		strcpy(address.sun_path, path);
+
+		if (!clearStaleSocket(path, &address))
+		{
+			printf("control: %s exists\n", path);
+			return Life_Result_Failed;
+		}
+
+		int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener < 0 || bind(listener, (sockaddr*)&address, sizeof(address)) != 0 || listen(listener, 16) != 0 || !setNonBlocking(listener))
+		{
+			printf("control: failed to listen on %s\n", path);
+			if (listener >= 0) close(listener);
+			return Life_Result_Failed;
+		}
+
+		int wake[2];
+		if (pipe(wake) != 0 || !setNonBlocking(wake[0]) || !setNonBlocking(wake[1]))
+		{
+			printf("control: failed to create the wake pipe\n");
+			close(listener);
+			unlink(path);
+			return Life_Result_Failed;
+		}
+
+		LifeControlServer* result = new LifeControlServer();
+		strcpy(result->path, path);
+		result->listener = listener;
+		result->wake[0] = wake[0];
+		result->wake[1] = wake[1];
+		result->stop = false;
+		result->thread = std::thread(serveControl, result);
+
+		*server = result;
+		return Life_Result_Success;
+	}
+
+	void destroyControlServer(LifeControlServer* server)
+	{
+		server->stop = true;
+		char wake = 1;
+		if (write(server->wake[1], &wake, 1) < 0) {}
+		server->thread.join();
+
+		close(server->listener);
+		close(server->wake[0]);
+		close(server->wake[1]);
+		unlink(server->path);
+		delete server;
+	}
+#else
+	LifeResult createControlServer(LifeControlServer** server, const char* path)
+	{
+		printf("control: the control socket needs a POSIX system\n");
+		return Life_Result_Failed;
+	}
+
+	void destroyControlServer(LifeControlServer* server) {}
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "life.h"
+
+// a Unix domain socket taking one text command per line and answering each with one line in
+// order, clients may send any number of commands before reading the replies
+struct LifeControlServer;
+
+// the simulation a control server drives, commands edit it between generations
+struct LifeControlTarget
+{
+	LifeGrid* grid;
+	LifeGrid* next;
+	LifeStepInfo stepInfo;
+	uint64_t generation;
+	bool paused;
+	uint64_t steps; // generations a step command still waits for, the owner steps them one per turn
+	bool changed; // set whenever a command edits or steps the grid
+	bool keyframe; // set by the keyframe command, a streaming run writes one next
+};
+
+namespace life
+{
+	// the network is served by a thread of its own, POSIX systems only
+	LifeResult createControlServer(LifeControlServer** server, const char* path);
+	void       destroyControlServer(LifeControlServer* server);
+	// runs every command received so far and returns how many answered, never waits for the network
+	// thread, a step command holds back the commands after it until the owner counted steps down to 0
+	uint32_t   serviceControl(LifeControlServer* server, LifeControlTarget* target);
+	// sleeps until a command arrives or milliseconds pass, for simulations that are paused
+	void       waitControl(LifeControlServer* server, uint32_t milliseconds);
+}
@@ -0,0 +1,253 @@
+#include "distributed.h"
+#include "pattern.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#define LIFE_FORK_SUPPORTED
+#endif
+
+namespace life
+{
+	static bool barrierGeneration(const LifeDistributedInfo* distributedInfo, uint64_t generation);
+
+	// the coordinator and every worker meet at the same generations
+	static bool barrierGeneration(const LifeDistributedInfo* distributedInfo, uint64_t generation)
+	{
+		return generation % distributedInfo->syncInterval == 0 || generation == distributedInfo->generations;
+	}
+
+	void stripeRows(const LifeDistributedInfo* distributedInfo, uint32_t worker, uint32_t* first, uint32_t* count)
+	{
+		uint32_t rows = distributedInfo->height / distributedInfo->workerCount;
+		uint32_t extra = distributedInfo->height % distributedInfo->workerCount;
+
+		*first = worker * rows + std::min(worker, extra);
+		*count = rows + (worker < extra ? 1 : 0);
+	}
+
+	LifeResult initialRows(const LifeDistributedInfo* distributedInfo, uint32_t first, LifeGrid* grid)
+	{
+		clearGrid(grid);
+
+		if (!distributedInfo->pattern)
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = distributedInfo->seed;
+			randomInfo.density = distributedInfo->density;
+			randomInfo.threadCount = 1;
+			randomInfo.firstRow = first;
+			fillRandom(grid, &randomInfo);
+			return Life_Result_Success;
+		}
+
+		LifeGrid* pattern;
+		if (loadPattern(distributedInfo->pattern, &pattern, nullptr, nullptr) == Life_Result_Failed)
+			return Life_Result_Failed;
+
+		LifeResult result = Life_Result_Success;
+		if (pattern->width > distributedInfo->width || pattern->height > distributedInfo->height)
+		{
+			printf("distributed: %s does not fit in the universe\n", distributedInfo->pattern);
+			result = Life_Result_Failed;
+		}
+		else
+		{
+			int32_t x = (distributedInfo->width - pattern->width) / 2;
+			int32_t y = (distributedInfo->height - pattern->height) / 2;
+			placePattern(grid, pattern, x, y - (int32_t)first);
+		}
+
+		destroyGrid(pattern);
+		return result;
+	}
+
+	// the stripe is stepped with a halo row above and below it, row 0 and row count + 1
+	LifeResult runDistributedWorker(const LifeDistributedInfo* distributedInfo, uint32_t worker, LifeWorkerTransport* transport)
+	{
+		uint32_t first, count;
+		stripeRows(distributedInfo, worker, &first, &count);
+
+		LifeGrid *owned, *stripe, *next;
+		if (createGrid(&owned, distributedInfo->width, count) == Life_Result_Failed)
+			return Life_Result_Failed;
+		createGrid(&stripe, distributedInfo->width, count + 2);
+		createGrid(&next, distributedInfo->width, count + 2);
+
+		LifeResult result = initialRows(distributedInfo, first, owned);
+		uint32_t stride = stripe->stride;
+		std::copy(owned->words.begin(), owned->words.end(), stripe->words.begin() + stride);
+		destroyGrid(owned);
+
+		// halo rows are filled by the transport, only the columns of a torus wrap inside the kernel
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = distributedInfo->rule;
+		stepInfo.topology = distributedInfo->topology;
+		stepInfo.threadCount = 1;
+
+		for (uint64_t generation = 0; result == Life_Result_Success; generation++)
+		{
+			if (barrierGeneration(distributedInfo, generation))
+			{
+				LifeReduction reduction{};
+				for (uint32_t y = 1; y <= count; y++)
+				{
+					const uint64_t* row = stripe->words.data() + (size_t)y * stride;
+					for (uint32_t w = 0; w < stride; w++)
+						reduction.population += popcount64(row[w]);
+					reduction.hash ^= hashRow(row, stride, first + y - 1);
+				}
+
+				result = transport->barrier(transport->data, generation, &reduction);
+			}
+
+			if (result == Life_Result_Failed || generation == distributedInfo->generations) break;
+
+			uint64_t* words = stripe->words.data();
+			if (transport->sendRow(transport->data, Life_Halo_Up, generation, words + stride) == Life_Result_Failed ||
+				transport->sendRow(transport->data, Life_Halo_Down, generation, words + (size_t)count * stride) == Life_Result_Failed ||
+				transport->receiveRow(transport->data, Life_Halo_Up, generation, words) == Life_Result_Failed ||
+				transport->receiveRow(transport->data, Life_Halo_Down, generation, words + (size_t)(count + 1) * stride) == Life_Result_Failed)
+			{
+				result = Life_Result_Failed;
+				break;
+			}
+
+			step(stripe, next, &stepInfo);
+			std::swap(stripe, next);
+		}
+
+		destroyGrid(stripe);
+		destroyGrid(next);
+		return result;
+	}
+
+#ifdef LIFE_FORK_SUPPORTED
+	LifeResult runDistributed(const LifeDistributedInfo* distributedInfo, LifeDistributedResult* result)
+	{
+		if (distributedInfo->workerCount == 0 || distributedInfo->workerCount > distributedInfo->height ||
+			distributedInfo->width == 0 || distributedInfo->syncInterval == 0 || distributedInfo->slots == 0)
+		{
+			printf("distributed: every worker needs at least one row\n");
+			return Life_Result_Failed;
+		}
+
+		LifeTransportInfo transportInfo{};
+		transportInfo.workerCount = distributedInfo->workerCount;
+		transportInfo.stride = (distributedInfo->width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+		transportInfo.slots = distributedInfo->slots;
+		transportInfo.topology = distributedInfo->topology;
+
+		LifeCoordinatorTransport coordinator{};
+		if (createShmCoordinator(&coordinator, distributedInfo->name, &transportInfo) == Life_Result_Failed)
+			return Life_Result_Failed;
+
+		fflush(stdout);
+
+		uint32_t started = 0;
+		for (; started < distributedInfo->workerCount; started++)
+		{
+			pid_t pid = fork();
+			if (pid < 0)
+			{
+				printf("distributed: failed to start worker %u\n", started);
+				coordinator.abort(coordinator.data);
+				break;
+			}
+
+			if (pid == 0)
+			{
+				LifeWorkerTransport transport{};
+				LifeResult workerResult = createShmWorker(&transport, distributedInfo->name, started);
+				if (workerResult == Life_Result_Success)
+				{
+					workerResult = runDistributedWorker(distributedInfo, started, &transport);
+					transport.destroy(transport.data);
+				}
+				fflush(stdout);
+				_exit(workerResult == Life_Result_Success ? 0 : 1);
+			}
+		}
+
+		// a worker that exits early would leave everyone else waiting at the next barrier
+		std::atomic<bool> finished{ false };
+		uint64_t workerPeakMemory = 0;
+		std::thread watcher([&]()
+		{
+			bool aborted = false;
+			for (uint32_t i = 0; i < started; i++)
+			{
+				int status;
+				struct rusage usage;
+				if (wait4(-1, &status, 0, &usage) < 0) break;
+#ifdef __APPLE__
+				workerPeakMemory += (uint64_t)usage.ru_maxrss;
+#else
+				workerPeakMemory += (uint64_t)usage.ru_maxrss * 1024;
+#endif
+				if ((!WIFEXITED(status) || WEXITSTATUS(status) != 0) && !finished.load() && !aborted)
+				{
+					printf("distributed: a worker process failed\n");
+					coordinator.abort(coordinator.data);
+					aborted = true;
+				}
+			}
+		});
+
+		*result = LifeDistributedResult{};
+		LifeResult status = started == distributedInfo->workerCount ? Life_Result_Success : Life_Result_Failed;
+
+		auto startTime = std::chrono::steady_clock::now(), lastReport = startTime;
+		for (uint64_t generation = 0; status == Life_Result_Success;)
+		{
+			status = coordinator.gather(coordinator.data, generation, &result->reduction);
+			if (status == Life_Result_Failed) break;
+
+			result->generation = generation;
+			if (generation == 0)
+				startTime = lastReport = std::chrono::steady_clock::now();
+
+			auto now = std::chrono::steady_clock::now();
+			if (distributedInfo->progressInterval > 0 && std::chrono::duration<double>(now - lastReport).count() >= distributedInfo->progressInterval)
+			{
+				lastReport = now;
+				printf("distributed: generation %llu, population %llu\n", (unsigned long long)generation, (unsigned long long)result->reduction.population);
+			}
+
+			if (generation == distributedInfo->generations)
+				finished = true;
+			coordinator.release(coordinator.data, generation);
+
+			if (generation == distributedInfo->generations) break;
+			generation = std::min<uint64_t>(generation + distributedInfo->syncInterval, distributedInfo->generations);
+		}
+
+		result->seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		if (status == Life_Result_Failed)
+			coordinator.abort(coordinator.data);
+		watcher.join();
+		coordinator.destroy(coordinator.data);
+		result->workerPeakMemory = workerPeakMemory;
+
+		return status;
+	}
+#else
+	LifeResult runDistributed(const LifeDistributedInfo* distributedInfo, LifeDistributedResult* result)
+	{
+		printf("distributed: worker processes need a POSIX system\n");
+		return Life_Result_Failed;
+	}
+#endif
+}
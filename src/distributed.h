@@ -0,0 +1,40 @@
+#pragma once
+
+#include "life.h"
+#include "transport.h"
+
+struct LifeDistributedInfo
+{
+	uint32_t width, height;
+	uint32_t workerCount;      // the universe is split into this many stripes of whole rows
+	uint32_t slots;            // halo rows a worker can run ahead of a neighbour
+	uint32_t syncInterval;     // generations between barriers, totals are reduced at each one
+	uint32_t progressInterval; // seconds between progress lines, 0 prints nothing
+	uint64_t generations;
+	LifeRule rule;
+	LifeTopology topology;
+	const char* pattern;       // optional pattern file placed in the middle, a random fill otherwise
+	uint64_t seed;
+	float density;
+	const char* name;          // shared memory segment the processes meet in
+};
+
+struct LifeDistributedResult
+{
+	uint64_t generation;
+	LifeReduction reduction;
+	double seconds;
+	uint64_t workerPeakMemory; // sum of the workers' peak resident sets in bytes, 0 when unknown
+};
+
+namespace life
+{
+	// rows [*first, *first + *count) of the universe belong to worker
+	void       stripeRows(const LifeDistributedInfo* distributedInfo, uint32_t worker, uint32_t* first, uint32_t* count);
+	// fills rows [first, first + grid->height) of the universe exactly as a single process would
+	LifeResult initialRows(const LifeDistributedInfo* distributedInfo, uint32_t first, LifeGrid* grid);
+
+	LifeResult runDistributedWorker(const LifeDistributedInfo* distributedInfo, uint32_t worker, LifeWorkerTransport* transport);
+	// forks one worker process per stripe and coordinates them from the calling process, POSIX systems only
+	LifeResult runDistributed(const LifeDistributedInfo* distributedInfo, LifeDistributedResult* result);
+}
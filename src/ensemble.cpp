@@ -0,0 +1,382 @@
+#include "ensemble.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+struct LifeEnsemble
+{
+	uint32_t width, height;
+	uint32_t laneWords; // words per cell, 64 universes each
+	uint32_t maxPeriod;
+	uint64_t generation;
+	uint32_t settledCount;
+
+	std::vector<std::vector<uint64_t>> states; // generation g is in states[g % (maxPeriod + 1)]
+	std::vector<uint64_t> zeroRow;
+	std::vector<uint64_t> settled;             // universes with a result
+	std::vector<uint64_t> edge;                // universes that touched the border of a plane
+	std::vector<LifeSettleResult> results;
+};
+
+// masks gathered while stepping, a universe's bit is set in alive when any of its cells is
+// alive and in changes[p - 1] when it differs from generation - p
+struct EnsembleMasks
+{
+	std::vector<uint64_t> alive;
+	std::vector<uint64_t> changes;
+};
+
+namespace life
+{
+	static uint64_t* ensembleState(LifeEnsemble* ensemble, uint64_t generation);
+	static const uint64_t* ensembleState(const LifeEnsemble* ensemble, uint64_t generation);
+	template<uint32_t LaneWords>
+	static void stepEnsembleRows(LifeEnsemble* ensemble, uint32_t begin, uint32_t end, const LifeStepInfo* stepInfo, EnsembleMasks* masks);
+	static void borderMask(const LifeEnsemble* ensemble, const uint64_t* state, uint64_t* mask);
+	static void settleUniverse(LifeEnsemble* ensemble, uint32_t universe, LifeSettleState state, uint64_t generation, uint64_t period);
+	static void trackEnsemble(LifeEnsemble* ensemble, const EnsembleMasks* masks, uint32_t periods, LifeTopology topology);
+
+	static uint64_t* ensembleState(LifeEnsemble* ensemble, uint64_t generation)
+	{
+		return ensemble->states[generation % (ensemble->maxPeriod + 1)].data();
+	}
+
+	static const uint64_t* ensembleState(const LifeEnsemble* ensemble, uint64_t generation)
+	{
+		return ensemble->states[generation % (ensemble->maxPeriod + 1)].data();
+	}
+
+	// LaneWords is 0 for ensembles without an unrolled kernel, the lane loop then runs on laneWords
+	template<uint32_t LaneWords>
+	static void stepEnsembleRows(LifeEnsemble* ensemble, uint32_t begin, uint32_t end, const LifeStepInfo* stepInfo, EnsembleMasks* masks)
+	{
+		uint32_t laneWords = LaneWords != 0 ? LaneWords : ensemble->laneWords;
+		uint32_t width = ensemble->width, height = ensemble->height;
+		uint64_t generation = ensemble->generation;
+		size_t rowWords = (size_t)width * laneWords;
+		bool torus = stepInfo->topology == Life_Topology_Torus;
+		bool conway = stepInfo->rule.birth == LIFE_RULE_CONWAY.birth && stepInfo->rule.survive == LIFE_RULE_CONWAY.survive;
+
+		const uint64_t* src = ensembleState(ensemble, generation);
+		uint64_t* dst = ensembleState(ensemble, generation + 1);
+		const uint64_t* zero = ensemble->zeroRow.data();
+
+		// earlier generations compared against, generation + 1 - p for p = 2..periods
+		uint32_t periods = (uint32_t)std::min<uint64_t>(ensemble->maxPeriod, generation + 1);
+		const uint64_t* earlier[LIFE_WORD_BITS];
+		for (uint32_t p = 2; p <= periods; p++)
+			earlier[p] = ensembleState(ensemble, generation + 1 - p);
+
+		uint64_t* alive = masks->alive.data();
+		uint64_t* changes = masks->changes.data();
+
+		for (uint32_t y = begin; y < end; y++)
+		{
+			const uint64_t* rows[3];
+			rows[0] = y > 0 ? src + (y - 1) * rowWords : (torus ? src + (height - 1) * rowWords : zero);
+			rows[1] = src + y * rowWords;
+			rows[2] = y + 1 < height ? src + (y + 1) * rowWords : (torus ? src : zero);
+
+			for (uint32_t x = 0; x < width; x++)
+			{
+				// columns beyond the edge of a plane read from the zero row
+				size_t center = x * (size_t)laneWords;
+				const uint64_t *lefts[3], *centers[3], *rights[3];
+				for (uint32_t i = 0; i < 3; i++)
+				{
+					lefts[i] = x > 0 ? rows[i] + center - laneWords : (torus ? rows[i] + rowWords - laneWords : zero);
+					centers[i] = rows[i] + center;
+					rights[i] = x + 1 < width ? rows[i] + center + laneWords : (torus ? rows[i] : zero);
+				}
+
+				uint64_t* out = dst + y * rowWords + center;
+				for (uint32_t k = 0; k < laneWords; k++)
+				{
+					uint64_t l[3] = { lefts[0][k], lefts[1][k], lefts[2][k] };
+					uint64_t c[3] = { centers[0][k], centers[1][k], centers[2][k] };
+					uint64_t r[3] = { rights[0][k], rights[1][k], rights[2][k] };
+
+					uint64_t next = nextWord(l, c, r, &stepInfo->rule, conway);
+					out[k] = next;
+					alive[k] |= next;
+					changes[k] |= next ^ c[1];
+				}
+
+				for (uint32_t p = 2; p <= periods; p++)
+				{
+					uint64_t* periodChanges = changes + (size_t)(p - 1) * laneWords;
+					const uint64_t* old = earlier[p] + y * rowWords + center;
+					for (uint32_t k = 0; k < laneWords; k++)
+						periodChanges[k] |= out[k] ^ old[k];
+				}
+			}
+		}
+	}
+
+	static void borderMask(const LifeEnsemble* ensemble, const uint64_t* state, uint64_t* mask)
+	{
+		uint32_t laneWords = ensemble->laneWords;
+		size_t rowWords = (size_t)ensemble->width * laneWords;
+		const uint64_t* lastRow = state + (ensemble->height - 1) * rowWords;
+
+		for (size_t i = 0; i < rowWords; i++)
+			mask[i % laneWords] |= state[i] | lastRow[i];
+
+		for (uint32_t y = 0; y < ensemble->height; y++)
+		{
+			const uint64_t* row = state + y * rowWords;
+			for (uint32_t k = 0; k < laneWords; k++)
+				mask[k] |= row[k] | row[rowWords - laneWords + k];
+		}
+	}
+
+	static void settleUniverse(LifeEnsemble* ensemble, uint32_t universe, LifeSettleState state, uint64_t generation, uint64_t period)
+	{
+		LifeSettleResult& result = ensemble->results[universe];
+		result.state = state;
+		result.generation = generation;
+		result.period = period;
+
+		ensemble->settled[universe / LIFE_WORD_BITS] |= 1ull << (universe % LIFE_WORD_BITS);
+		ensemble->settledCount++;
+	}
+
+	static void trackEnsemble(LifeEnsemble* ensemble, const EnsembleMasks* masks, uint32_t periods, LifeTopology topology)
+	{
+		uint32_t laneWords = ensemble->laneWords;
+		uint64_t generation = ensemble->generation;
+
+		if (topology == Life_Topology_Plane)
+		{
+			std::vector<uint64_t> border(laneWords, 0);
+			borderMask(ensemble, ensembleState(ensemble, generation), border.data());
+
+			for (uint32_t k = 0; k < laneWords; k++)
+			{
+				uint64_t reached = border[k] & ~ensemble->edge[k];
+				ensemble->edge[k] |= reached;
+				for (; reached != 0; reached &= reached - 1)
+				{
+					LifeSettleResult& result = ensemble->results[k * LIFE_WORD_BITS + lowestBit64(reached)];
+					result.reachedEdge = true;
+					result.edgeGeneration = generation;
+				}
+			}
+		}
+
+		for (uint32_t k = 0; k < laneWords; k++)
+		{
+			uint64_t open = ~ensemble->settled[k];
+
+			uint64_t dead = open & ~masks->alive[k];
+			for (; dead != 0; dead &= dead - 1)
+				settleUniverse(ensemble, k * LIFE_WORD_BITS + lowestBit64(dead), Life_Settle_Dies, generation, 1);
+
+			// the shortest period wins, it repeats for the first time at this generation
+			for (uint32_t p = 1; p <= periods; p++)
+			{
+				uint64_t repeated = ~ensemble->settled[k] & ~masks->changes[(size_t)(p - 1) * laneWords + k];
+				for (; repeated != 0; repeated &= repeated - 1)
+					settleUniverse(ensemble, k * LIFE_WORD_BITS + lowestBit64(repeated), p == 1 ? Life_Settle_Still : Life_Settle_Periodic, generation - p, p);
+			}
+		}
+	}
+
+	LifeResult createEnsemble(LifeEnsemble** ensemble, const LifeEnsembleCreateInfo* createInfo)
+	{
+		if (createInfo->width == 0 || createInfo->height == 0 || createInfo->universeCount == 0 ||
+			createInfo->maxPeriod == 0 || createInfo->maxPeriod >= LIFE_WORD_BITS)
+			return Life_Result_Failed;
+
+		*ensemble = new LifeEnsemble();
+		LifeEnsemble* ensemblePtr = *ensemble;
+		ensemblePtr->width = createInfo->width;
+		ensemblePtr->height = createInfo->height;
+		ensemblePtr->laneWords = (createInfo->universeCount + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+		ensemblePtr->maxPeriod = createInfo->maxPeriod;
+		ensemblePtr->generation = 0;
+		ensemblePtr->settledCount = 0;
+
+		size_t rowWords = (size_t)ensemblePtr->width * ensemblePtr->laneWords;
+		ensemblePtr->states.resize(ensemblePtr->maxPeriod + 1);
+		for (std::vector<uint64_t>& state : ensemblePtr->states)
+			state.assign(rowWords * ensemblePtr->height, 0);
+		ensemblePtr->zeroRow.assign(rowWords, 0);
+		ensemblePtr->settled.assign(ensemblePtr->laneWords, 0);
+		ensemblePtr->edge.assign(ensemblePtr->laneWords, 0);
+		LifeSettleResult unsettled{};
+		unsettled.state = Life_Settle_Unsettled;
+		ensemblePtr->results.assign((size_t)ensemblePtr->laneWords * LIFE_WORD_BITS, unsettled);
+
+		return Life_Result_Success;
+	}
+
+	void destroyEnsemble(LifeEnsemble* ensemble)
+	{
+		delete ensemble;
+	}
+
+	uint32_t ensembleUniverses(const LifeEnsemble* ensemble)
+	{
+		return ensemble->laneWords * LIFE_WORD_BITS;
+	}
+
+	void setEnsembleUniverse(LifeEnsemble* ensemble, uint32_t universe, const LifeGrid* grid)
+	{
+		if (grid->width != ensemble->width || grid->height != ensemble->height || universe >= ensembleUniverses(ensemble)) return;
+
+		// the current generation becomes generation 0 for every universe
+		if (ensemble->generation != 0)
+		{
+			ensemble->states[0].swap(ensemble->states[ensemble->generation % (ensemble->maxPeriod + 1)]);
+			ensemble->generation = 0;
+		}
+
+		std::fill(ensemble->settled.begin(), ensemble->settled.end(), 0);
+		std::fill(ensemble->edge.begin(), ensemble->edge.end(), 0);
+		LifeSettleResult unsettled{};
+		unsettled.state = Life_Settle_Unsettled;
+		std::fill(ensemble->results.begin(), ensemble->results.end(), unsettled);
+		ensemble->settledCount = 0;
+
+		uint64_t* state = ensemble->states[0].data();
+		uint32_t laneWord = universe / LIFE_WORD_BITS;
+		uint64_t bit = 1ull << (universe % LIFE_WORD_BITS);
+
+		for (uint32_t y = 0; y < grid->height; y++)
+		{
+			for (uint32_t x = 0; x < grid->width; x++)
+			{
+				uint64_t& word = state[((size_t)y * ensemble->width + x) * ensemble->laneWords + laneWord];
+				word = getCell(grid, x, y) ? (word | bit) : (word & ~bit);
+			}
+		}
+	}
+
+	void getEnsembleUniverse(const LifeEnsemble* ensemble, uint32_t universe, LifeGrid* grid)
+	{
+		if (grid->width != ensemble->width || grid->height != ensemble->height || universe >= ensembleUniverses(ensemble)) return;
+
+		const uint64_t* state = ensembleState(ensemble, ensemble->generation);
+		uint32_t laneWord = universe / LIFE_WORD_BITS, shift = universe % LIFE_WORD_BITS;
+
+		for (uint32_t y = 0; y < grid->height; y++)
+		{
+			for (uint32_t x = 0; x < grid->width; x++)
+				setCell(grid, x, y, (state[((size_t)y * ensemble->width + x) * ensemble->laneWords + laneWord] >> shift) & 1);
+		}
+	}
+
+	void stepEnsemble(LifeEnsemble* ensemble, const LifeStepInfo* stepInfo)
+	{
+		LIFE_TRACE_SCOPE("sim", "ensemble step");
+		uint32_t laneWords = ensemble->laneWords;
+
+		// universes that are empty or on the border from the start
+		if (ensemble->generation == 0)
+		{
+			EnsembleMasks masks;
+			masks.alive.assign(laneWords, 0);
+			const std::vector<uint64_t>& state = ensemble->states[0];
+			for (size_t i = 0; i < state.size(); i++)
+				masks.alive[i % laneWords] |= state[i];
+			trackEnsemble(ensemble, &masks, 0, stepInfo->topology);
+		}
+
+		uint32_t periods = (uint32_t)std::min<uint64_t>(ensemble->maxPeriod, ensemble->generation + 1);
+
+		EnsembleMasks masks;
+		masks.alive.assign(laneWords, 0);
+		masks.changes.assign((size_t)ensemble->maxPeriod * laneWords, 0);
+		std::mutex masksMutex;
+
+		parallelFor(ensemble->height, stepInfo->threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			EnsembleMasks rowMasks;
+			rowMasks.alive.assign(laneWords, 0);
+			rowMasks.changes.assign((size_t)ensemble->maxPeriod * laneWords, 0);
+
+			switch (laneWords)
+			{
+			case 1: stepEnsembleRows<1>(ensemble, begin, end, stepInfo, &rowMasks); break;
+			case 4: stepEnsembleRows<4>(ensemble, begin, end, stepInfo, &rowMasks); break;
+			case 8: stepEnsembleRows<8>(ensemble, begin, end, stepInfo, &rowMasks); break;
+			default: stepEnsembleRows<0>(ensemble, begin, end, stepInfo, &rowMasks); break;
+			}
+
+			std::lock_guard<std::mutex> lock(masksMutex);
+			for (size_t i = 0; i < masks.alive.size(); i++)
+				masks.alive[i] |= rowMasks.alive[i];
+			for (size_t i = 0; i < masks.changes.size(); i++)
+				masks.changes[i] |= rowMasks.changes[i];
+		});
+
+		ensemble->generation++;
+		trackEnsemble(ensemble, &masks, periods, stepInfo->topology);
+	}
+
+	uint64_t runEnsemble(LifeEnsemble* ensemble, const LifeStepInfo* stepInfo, uint64_t maxGenerations)
+	{
+		while (ensemble->generation < maxGenerations && ensemble->settledCount < ensembleUniverses(ensemble))
+			stepEnsemble(ensemble, stepInfo);
+
+		return ensemble->generation;
+	}
+
+	uint64_t ensembleGeneration(const LifeEnsemble* ensemble)
+	{
+		return ensemble->generation;
+	}
+
+	uint32_t ensembleSettled(const LifeEnsemble* ensemble)
+	{
+		return ensemble->settledCount;
+	}
+
+	// every cell word is added into bit sliced counters, bit b of counters[b * laneWords + k]
+	// is then bit b of the population of the universes in lane word k
+	void ensemblePopulations(const LifeEnsemble* ensemble, uint64_t* populations)
+	{
+		uint32_t laneWords = ensemble->laneWords;
+		std::vector<uint64_t> counters((size_t)LIFE_WORD_BITS * laneWords, 0);
+		const std::vector<uint64_t>& state = ensemble->states[ensemble->generation % (ensemble->maxPeriod + 1)];
+
+		for (size_t i = 0; i < state.size(); i++)
+		{
+			uint32_t k = (uint32_t)(i % laneWords);
+			uint64_t carry = state[i];
+			for (uint32_t b = 0; carry != 0; b++)
+			{
+				uint64_t& counter = counters[(size_t)b * laneWords + k];
+				uint64_t next = counter & carry;
+				counter ^= carry;
+				carry = next;
+			}
+		}
+
+		for (uint32_t universe = 0; universe < ensembleUniverses(ensemble); universe++)
+		{
+			uint32_t k = universe / LIFE_WORD_BITS, shift = universe % LIFE_WORD_BITS;
+			uint64_t population = 0;
+			for (uint32_t b = 0; b < LIFE_WORD_BITS; b++)
+				population |= ((counters[(size_t)b * laneWords + k] >> shift) & 1) << b;
+			populations[universe] = population;
+		}
+	}
+
+	void ensembleResults(const LifeEnsemble* ensemble, LifeSettleResult* results)
+	{
+		std::vector<uint64_t> populations(ensembleUniverses(ensemble));
+		ensemblePopulations(ensemble, populations.data());
+
+		for (uint32_t universe = 0; universe < ensembleUniverses(ensemble); universe++)
+		{
+			results[universe] = ensemble->results[universe];
+			results[universe].population = populations[universe];
+			if (results[universe].state == Life_Settle_Unsettled)
+				results[universe].generation = ensemble->generation;
+		}
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "life.h"
+#include "settle.h"
+
+// many small universes of the same size stepped together, bit n of the k-th word of a cell
+// belongs to universe k * 64 + n so one word operation advances 64 universes
+struct LifeEnsemble;
+
+struct LifeEnsembleCreateInfo
+{
+	uint32_t width, height;
+	uint32_t universeCount; // rounded up to a multiple of 64, 64, 256 and 512 have unrolled kernels
+	uint32_t maxPeriod;     // longest period each universe is checked for, every period keeps a copy of the ensemble
+};
+
+namespace life
+{
+	LifeResult createEnsemble(LifeEnsemble** ensemble, const LifeEnsembleCreateInfo* createInfo);
+	void       destroyEnsemble(LifeEnsemble* ensemble);
+	uint32_t   ensembleUniverses(const LifeEnsemble* ensemble);
+
+	// copies a grid of the ensemble's size in and out of one universe, setting a universe
+	// restarts its termination tracking at generation 0
+	void       setEnsembleUniverse(LifeEnsemble* ensemble, uint32_t universe, const LifeGrid* grid);
+	void       getEnsembleUniverse(const LifeEnsemble* ensemble, uint32_t universe, LifeGrid* grid);
+
+	// advances every universe one generation, universes that died or became still or periodic
+	// keep stepping but their result is frozen at the generation they settled
+	void       stepEnsemble(LifeEnsemble* ensemble, const LifeStepInfo* stepInfo);
+	// steps until every universe settled or maxGenerations is reached, returns the generation stopped at
+	uint64_t   runEnsemble(LifeEnsemble* ensemble, const LifeStepInfo* stepInfo, uint64_t maxGenerations);
+
+	uint64_t   ensembleGeneration(const LifeEnsemble* ensemble);
+	uint32_t   ensembleSettled(const LifeEnsemble* ensemble);
+	// populations and results hold one entry per universe
+	void       ensemblePopulations(const LifeEnsemble* ensemble, uint64_t* populations);
+	void       ensembleResults(const LifeEnsemble* ensemble, LifeSettleResult* results);
+}
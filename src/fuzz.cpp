@@ -0,0 +1,689 @@
+#include "life.h"
+#include "pattern.h"
+#include "ensemble.h"
+#include "distributed.h"
+#include "mapped.h"
+#include "sparse.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <utility>
+#include <vector>
+
+// what firstDivergence returns besides the first bad generation, 0 when the engine agrees
+#define FUZZ_FAILED  (UINT64_MAX - 1) // the engine could not run the case at all
+#define FUZZ_SKIPPED UINT64_MAX       // the engine does not support the case, such as too few rows for its workers
+
+// cgol-fuzz steps random universes with every engine next to a naive per cell stepper and
+// compares them generation by generation, a divergence is shrunk to a small board and written
+// as RLE that --replay runs again
+namespace fuzz
+{
+	enum FuzzEngine
+	{
+		Fuzz_Engine_Packed,      // life::step on one thread
+		Fuzz_Engine_Threaded,    // life::step split over several threads
+		Fuzz_Engine_Ensemble,    // the case in one lane of a bit-sliced ensemble of random soups
+		Fuzz_Engine_Distributed, // worker processes exchanging halo rows, only the final state is compared
+		Fuzz_Engine_Blocked,     // life::stepBlocked, compared after every pass of several generations
+		Fuzz_Engine_Sparse,      // the case on an unbounded tiled plane, its topology is ignored
+		Fuzz_Engine_Mapped,      // a file backed universe stepped in stripes of a few rows, compared by hash
+
+		Fuzz_Engine_Count,
+	};
+
+	struct FuzzCase
+	{
+		LifeGrid* grid;
+		LifeRule rule;
+		LifeTopology topology;
+		uint64_t generations;
+		uint32_t threadCount; // threads or workers of the engine under test
+		uint32_t lane;        // ensemble universe the case runs in
+	};
+
+	static const char* s_Engines[Fuzz_Engine_Count] = { "packed", "threaded", "ensemble", "distributed", "blocked", "sparse", "mapped" };
+
+	static const char* s_Usage =
+		"usage: cgol-fuzz [options]\n"
+		"\n"
+		"  --seed <n>            first case seed, every case is reproducible from its seed (default 1)\n"
+		"  --cases <n>           cases to run, 0 runs until --seconds or forever (default 1000)\n"
+		"  --seconds <n>         stop after this many seconds, 0 for no limit (default 0)\n"
+		"  --engines <list>      any of packed,threaded,ensemble,distributed,blocked,sparse,\n"
+		"                        mapped (default all)\n"
+		"  --max-size <n>        largest universe side (default 300)\n"
+		"  --max-gens <n>        most generations a case is stepped (default 64)\n"
+		"  --distributed <n>     run the distributed engine on every n-th case, it forks (default 50)\n"
+		"  --output <dir>        where shrunk failing cases are written (default .)\n"
+		"  --replay <file>       run one saved case, with --engines, --gens, --threads and --torus\n";
+
+	// the stepper every engine is checked against, one cell at a time with no packing at all
+	static void referenceStep(const LifeGrid* src, LifeGrid* dst, const LifeRule* rule, LifeTopology topology);
+	static uint64_t mix(uint64_t seed, uint64_t counter, uint64_t range);
+	static uint32_t randomSide(uint64_t seed, uint64_t counter, uint32_t maxSize);
+	static void randomCase(uint64_t seed, uint32_t maxSize, uint64_t maxGenerations, FuzzCase* fuzzCase);
+	static uint64_t firstDivergence(FuzzEngine engine, const FuzzCase* fuzzCase);
+	static uint64_t checkPacked(const FuzzCase* fuzzCase, uint32_t threadCount);
+	static uint64_t checkEnsemble(const FuzzCase* fuzzCase);
+	static uint64_t checkBlocked(const FuzzCase* fuzzCase);
+	static uint64_t checkDistributed(const FuzzCase* fuzzCase);
+	static uint64_t checkSparse(const FuzzCase* fuzzCase);
+	static uint64_t checkMapped(const FuzzCase* fuzzCase);
+	static void cropGrid(LifeGrid** grid, int32_t x, int32_t y, uint32_t width, uint32_t height);
+	static void shrinkCase(FuzzEngine engine, FuzzCase* fuzzCase);
+	static void reportCase(FuzzEngine engine, const FuzzCase* fuzzCase, uint64_t seed, const char* outputDir);
+	static const char* optionValue(int argc, char** argv, const char* name);
+	static bool hasFlag(int argc, char** argv, const char* name);
+
+	static void referenceStep(const LifeGrid* src, LifeGrid* dst, const LifeRule* rule, LifeTopology topology)
+	{
+		int64_t width = src->width, height = src->height;
+		for (int64_t y = 0; y < height; y++)
+		{
+			for (int64_t x = 0; x < width; x++)
+			{
+				uint32_t neighbours = 0;
+				for (int64_t dy = -1; dy <= 1; dy++)
+				{
+					for (int64_t dx = -1; dx <= 1; dx++)
+					{
+						if (dx == 0 && dy == 0) continue;
+
+						int64_t nx = x + dx, ny = y + dy;
+						if (topology == Life_Topology_Torus)
+						{
+							nx = (nx + width) % width;
+							ny = (ny + height) % height;
+						}
+						else if (nx < 0 || ny < 0 || nx >= width || ny >= height)
+							continue;
+
+						neighbours += life::getCell(src, (uint32_t)nx, (uint32_t)ny);
+					}
+				}
+
+				bool alive = life::getCell(src, (uint32_t)x, (uint32_t)y);
+				life::setCell(dst, (uint32_t)x, (uint32_t)y, (((alive ? rule->survive : rule->birth) >> neighbours) & 1) != 0);
+			}
+		}
+	}
+
+	static uint64_t mix(uint64_t seed, uint64_t counter, uint64_t range)
+	{
+		return life::randomWord(seed, counter) % range;
+	}
+
+	// word boundaries are where packed kernels go wrong, so sides near multiples of 64 are favoured
+	static uint32_t randomSide(uint64_t seed, uint64_t counter, uint32_t maxSize)
+	{
+		uint32_t side;
+		switch (mix(seed, counter, 4))
+		{
+		case 0:  side = 1 + (uint32_t)mix(seed, counter + 1, 8); break;
+		case 1:  side = 64 * (1 + (uint32_t)mix(seed, counter + 1, 4)) + (uint32_t)mix(seed, counter + 2, 3) - 1; break;
+		default: side = 1 + (uint32_t)mix(seed, counter + 1, maxSize); break;
+		}
+		return std::min(std::max(side, 1u), maxSize);
+	}
+
+	static void randomCase(uint64_t seed, uint32_t maxSize, uint64_t maxGenerations, FuzzCase* fuzzCase)
+	{
+		uint32_t width = randomSide(seed, 0, maxSize), height = randomSide(seed, 3, maxSize);
+		life::createGrid(&fuzzCase->grid, width, height);
+
+		LifeRandomInfo randomInfo{};
+		randomInfo.seed = seed;
+		randomInfo.density = (float)(1 + mix(seed, 6, 255)) / 256.0f;
+		randomInfo.threadCount = 1;
+		life::fillRandom(fuzzCase->grid, &randomInfo);
+
+		// half the cases run Conway's rule, which most kernels special case
+		fuzzCase->rule = LIFE_RULE_CONWAY;
+		// birth on no neighbours is refused by parseRule, a case using it could not be saved and replayed
+		if (mix(seed, 7, 2))
+		{
+			fuzzCase->rule.birth = (uint16_t)(mix(seed, 8, 1 << 9) & ~1u);
+			fuzzCase->rule.survive = (uint16_t)mix(seed, 9, 1 << 9);
+		}
+
+		fuzzCase->topology = mix(seed, 10, 2) ? Life_Topology_Torus : Life_Topology_Plane;
+		fuzzCase->generations = 1 + mix(seed, 11, maxGenerations);
+		fuzzCase->threadCount = 2 + (uint32_t)mix(seed, 12, 7);
+		fuzzCase->lane = (uint32_t)mix(seed, 13, 64);
+	}
+
+	// the first generation whose state differs from the reference, 0 when the engine agrees throughout
+	static uint64_t firstDivergence(FuzzEngine engine, const FuzzCase* fuzzCase)
+	{
+		switch (engine)
+		{
+		case Fuzz_Engine_Packed:   return checkPacked(fuzzCase, 1);
+		case Fuzz_Engine_Threaded: return checkPacked(fuzzCase, fuzzCase->threadCount);
+		case Fuzz_Engine_Ensemble: return checkEnsemble(fuzzCase);
+		case Fuzz_Engine_Blocked:  return checkBlocked(fuzzCase);
+		case Fuzz_Engine_Sparse:   return checkSparse(fuzzCase);
+		case Fuzz_Engine_Mapped:   return checkMapped(fuzzCase);
+		default:                   return checkDistributed(fuzzCase);
+		}
+	}
+
+	// the hash computed while stepping is checked along with the cells themselves
+	static uint64_t checkPacked(const FuzzCase* fuzzCase, uint32_t threadCount)
+	{
+		LifeGrid *grid, *next, *expected, *expectedNext;
+		life::createGrid(&grid, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&next, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expected, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expectedNext, fuzzCase->grid->width, fuzzCase->grid->height);
+		grid->words = fuzzCase->grid->words;
+		expected->words = fuzzCase->grid->words;
+
+		uint64_t hash = 0;
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = fuzzCase->rule;
+		stepInfo.topology = fuzzCase->topology;
+		stepInfo.threadCount = threadCount;
+		stepInfo.hash = &hash;
+
+		uint64_t diverged = 0;
+		for (uint64_t generation = 1; generation <= fuzzCase->generations && !diverged; generation++)
+		{
+			life::step(grid, next, &stepInfo);
+			std::swap(grid, next);
+			referenceStep(expected, expectedNext, &fuzzCase->rule, fuzzCase->topology);
+			std::swap(expected, expectedNext);
+
+			if (grid->words != expected->words || hash != life::hashGrid(expected))
+				diverged = generation;
+		}
+
+		life::destroyGrid(grid);
+		life::destroyGrid(next);
+		life::destroyGrid(expected);
+		life::destroyGrid(expectedNext);
+		return diverged;
+	}
+
+	// the depth follows the thread count, so halos of 2 to 8 rows are crossed by every band edge
+	static uint64_t checkBlocked(const FuzzCase* fuzzCase)
+	{
+		LifeGrid *grid, *scratch, *expected, *expectedNext;
+		life::createGrid(&grid, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&scratch, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expected, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expectedNext, fuzzCase->grid->width, fuzzCase->grid->height);
+		grid->words = fuzzCase->grid->words;
+		expected->words = fuzzCase->grid->words;
+
+		uint64_t hash = 0;
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = fuzzCase->rule;
+		stepInfo.topology = fuzzCase->topology;
+		stepInfo.threadCount = fuzzCase->threadCount;
+		stepInfo.hash = &hash;
+
+		uint32_t depth = std::max<uint32_t>(fuzzCase->threadCount, 2);
+		uint64_t diverged = 0;
+		for (uint64_t generation = 0; generation < fuzzCase->generations && !diverged;)
+		{
+			uint32_t count = (uint32_t)std::min<uint64_t>(depth, fuzzCase->generations - generation);
+			life::stepBlocked(grid, scratch, count, depth, &stepInfo);
+			for (uint32_t i = 0; i < count; i++)
+			{
+				referenceStep(expected, expectedNext, &fuzzCase->rule, fuzzCase->topology);
+				std::swap(expected, expectedNext);
+			}
+			generation += count;
+
+			if (grid->words != expected->words || hash != life::hashGrid(expected))
+				diverged = generation;
+		}
+
+		life::destroyGrid(grid);
+		life::destroyGrid(scratch);
+		life::destroyGrid(expected);
+		life::destroyGrid(expectedNext);
+		return diverged;
+	}
+
+	// the other 63 universes hold their own soups so lanes leaking into each other show up
+	static uint64_t checkEnsemble(const FuzzCase* fuzzCase)
+	{
+		LifeEnsembleCreateInfo createInfo{};
+		createInfo.width = fuzzCase->grid->width;
+		createInfo.height = fuzzCase->grid->height;
+		createInfo.universeCount = 64;
+		createInfo.maxPeriod = 1;
+
+		LifeEnsemble* ensemble;
+		if (life::createEnsemble(&ensemble, &createInfo) == Life_Result_Failed)
+			return FUZZ_FAILED;
+
+		LifeGrid *grid, *expected, *expectedNext;
+		life::createGrid(&grid, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expected, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expectedNext, fuzzCase->grid->width, fuzzCase->grid->height);
+		expected->words = fuzzCase->grid->words;
+
+		for (uint32_t universe = 0; universe < life::ensembleUniverses(ensemble); universe++)
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = universe + 1;
+			randomInfo.density = 0.5f;
+			randomInfo.threadCount = 1;
+			life::fillRandom(grid, &randomInfo);
+			life::setEnsembleUniverse(ensemble, universe, universe == fuzzCase->lane ? fuzzCase->grid : grid);
+		}
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = fuzzCase->rule;
+		stepInfo.topology = fuzzCase->topology;
+		stepInfo.threadCount = 1;
+
+		uint64_t diverged = 0;
+		for (uint64_t generation = 1; generation <= fuzzCase->generations && !diverged; generation++)
+		{
+			life::stepEnsemble(ensemble, &stepInfo);
+			referenceStep(expected, expectedNext, &fuzzCase->rule, fuzzCase->topology);
+			std::swap(expected, expectedNext);
+
+			life::getEnsembleUniverse(ensemble, fuzzCase->lane, grid);
+			if (grid->words != expected->words)
+				diverged = generation;
+		}
+
+		life::destroyGrid(grid);
+		life::destroyGrid(expected);
+		life::destroyGrid(expectedNext);
+		life::destroyEnsemble(ensemble);
+		return diverged;
+	}
+
+	// the workers only report their final totals, so a mismatch is pinned to a generation by
+	// running again with fewer generations
+	static uint64_t checkDistributed(const FuzzCase* fuzzCase)
+	{
+		// the workers load the case from RLE, which cannot hold a rule with birth on no neighbours
+		uint32_t workers = std::min(fuzzCase->threadCount, fuzzCase->grid->height);
+		if (workers < 2 || (fuzzCase->rule.birth & 1))
+			return FUZZ_SKIPPED;
+
+		char name[64], path[64];
+		uint64_t tag = life::randomWord(std::chrono::steady_clock::now().time_since_epoch().count(), 0) & 0xFFFFFF;
+		snprintf(name, sizeof(name), "/cgol-fuzz-%llu", (unsigned long long)tag);
+		snprintf(path, sizeof(path), "/tmp/cgol-fuzz-%llu.rle", (unsigned long long)tag);
+		if (life::savePattern(path, fuzzCase->grid, &fuzzCase->rule) == Life_Result_Failed)
+			return FUZZ_FAILED;
+
+		LifeDistributedInfo distributedInfo{};
+		distributedInfo.width = fuzzCase->grid->width;
+		distributedInfo.height = fuzzCase->grid->height;
+		distributedInfo.workerCount = workers;
+		distributedInfo.slots = 4;
+		distributedInfo.rule = fuzzCase->rule;
+		distributedInfo.topology = fuzzCase->topology;
+		distributedInfo.pattern = path;
+		distributedInfo.name = name;
+
+		LifeGrid *expected, *expectedNext;
+		life::createGrid(&expected, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expectedNext, fuzzCase->grid->width, fuzzCase->grid->height);
+
+		bool failed = false;
+		auto agrees = [&](uint64_t generations)
+		{
+			expected->words = fuzzCase->grid->words;
+			for (uint64_t generation = 0; generation < generations; generation++)
+			{
+				referenceStep(expected, expectedNext, &fuzzCase->rule, fuzzCase->topology);
+				std::swap(expected, expectedNext);
+			}
+
+			distributedInfo.generations = generations;
+			distributedInfo.syncInterval = (uint32_t)generations;
+			LifeDistributedResult result;
+			if (life::runDistributed(&distributedInfo, &result) == Life_Result_Failed)
+			{
+				failed = true;
+				return true;
+			}
+			return result.reduction.hash == life::hashGrid(expected) && result.reduction.population == life::population(expected);
+		};
+
+		uint64_t diverged = 0;
+		if (!agrees(fuzzCase->generations))
+		{
+			uint64_t low = 1, high = fuzzCase->generations;
+			while (low < high)
+			{
+				uint64_t middle = (low + high) / 2;
+				if (agrees(middle)) low = middle + 1;
+				else high = middle;
+			}
+			diverged = low;
+		}
+
+		remove(path);
+		life::destroyGrid(expected);
+		life::destroyGrid(expectedNext);
+		return failed ? FUZZ_FAILED : diverged;
+	}
+
+	// the reference steps a bounded plane wide enough that no cell reaches its edge, the case is
+	// placed off the tile grid and across the origin so negative tile coordinates are crossed
+	static uint64_t checkSparse(const FuzzCase* fuzzCase)
+	{
+		// birth on no neighbours would fill the unbounded plane, the sparse plane cannot run it
+		if (fuzzCase->rule.birth & 1)
+			return FUZZ_SKIPPED;
+
+		uint32_t margin = (uint32_t)fuzzCase->generations + 1;
+		uint32_t width = fuzzCase->grid->width + 2 * margin, height = fuzzCase->grid->height + 2 * margin;
+		int64_t x = -(int64_t)fuzzCase->lane - 7, y = (int64_t)fuzzCase->lane * 3 - 100;
+
+		LifeSparseGrid* sparse;
+		if (life::createSparseGrid(&sparse) == Life_Result_Failed)
+			return FUZZ_FAILED;
+		life::placeSparsePattern(sparse, fuzzCase->grid, x, y);
+
+		LifeGrid *grid, *expected, *expectedNext;
+		life::createGrid(&grid, width, height);
+		life::createGrid(&expected, width, height);
+		life::createGrid(&expectedNext, width, height);
+		life::placePattern(expected, fuzzCase->grid, (int32_t)margin, (int32_t)margin);
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = fuzzCase->rule;
+		stepInfo.topology = Life_Topology_Plane;
+		stepInfo.threadCount = fuzzCase->threadCount;
+
+		uint64_t diverged = 0;
+		for (uint64_t generation = 1; generation <= fuzzCase->generations && !diverged; generation++)
+		{
+			life::stepSparse(sparse, &stepInfo);
+			referenceStep(expected, expectedNext, &fuzzCase->rule, Life_Topology_Plane);
+			std::swap(expected, expectedNext);
+
+			life::copySparseRegion(sparse, x - margin, y - margin, grid);
+			if (grid->words != expected->words || life::sparsePopulation(sparse) != life::population(expected))
+				diverged = generation;
+		}
+
+		life::destroyGrid(grid);
+		life::destroyGrid(expected);
+		life::destroyGrid(expectedNext);
+		life::destroySparseGrid(sparse);
+		return diverged;
+	}
+
+	// stripes of 1 to 7 rows put a stripe boundary, and the halo rows carried across it, every
+	// few rows, the file only exposes the hash and population of each generation
+	static uint64_t checkMapped(const FuzzCase* fuzzCase)
+	{
+		char path[64];
+		uint64_t tag = life::randomWord(std::chrono::steady_clock::now().time_since_epoch().count(), 0) & 0xFFFFFF;
+		snprintf(path, sizeof(path), "/tmp/cgol-fuzz-%llu.cgu", (unsigned long long)tag);
+
+		LifeMappedCreateInfo createInfo{};
+		createInfo.width = fuzzCase->grid->width;
+		createInfo.height = fuzzCase->grid->height;
+		createInfo.stripeRows = fuzzCase->threadCount - 1;
+		createInfo.threadCount = fuzzCase->threadCount;
+		createInfo.rule = fuzzCase->rule;
+		createInfo.topology = fuzzCase->topology;
+
+		LifeMappedGrid* mapped;
+		if (life::createMappedGrid(&mapped, path, &createInfo) == Life_Result_Failed)
+			return FUZZ_FAILED;
+		life::placeMappedPattern(mapped, fuzzCase->grid, 0, 0);
+
+		LifeGrid *expected, *expectedNext;
+		life::createGrid(&expected, fuzzCase->grid->width, fuzzCase->grid->height);
+		life::createGrid(&expectedNext, fuzzCase->grid->width, fuzzCase->grid->height);
+		expected->words = fuzzCase->grid->words;
+
+		uint64_t diverged = 0;
+		for (uint64_t generation = 1; generation <= fuzzCase->generations && !diverged; generation++)
+		{
+			uint64_t population, hash;
+			life::stepMappedGrid(mapped, &population, &hash);
+			referenceStep(expected, expectedNext, &fuzzCase->rule, fuzzCase->topology);
+			std::swap(expected, expectedNext);
+
+			if (hash != life::hashGrid(expected) || population != life::population(expected))
+				diverged = generation;
+		}
+
+		life::destroyMappedGrid(mapped);
+		remove(path);
+		life::destroyGrid(expected);
+		life::destroyGrid(expectedNext);
+		return diverged;
+	}
+
+	// keeps the width x height cells starting at x, y
+	static void cropGrid(LifeGrid** grid, int32_t x, int32_t y, uint32_t width, uint32_t height)
+	{
+		LifeGrid* cropped;
+		life::createGrid(&cropped, width, height);
+		life::placePattern(cropped, *grid, -x, -y);
+		life::destroyGrid(*grid);
+		*grid = cropped;
+	}
+
+	// greedy: stop at the first bad generation, then keep clearing rectangles and cutting rows
+	// and columns off the edges for as long as the engine still diverges
+	static void shrinkCase(FuzzEngine engine, FuzzCase* fuzzCase)
+	{
+		fuzzCase->generations = firstDivergence(engine, fuzzCase);
+
+		bool progress = true;
+		while (progress)
+		{
+			progress = false;
+
+			for (uint32_t parts = 2; parts <= 16 && !progress; parts *= 2)
+			{
+				uint32_t width = fuzzCase->grid->width, height = fuzzCase->grid->height;
+				for (uint32_t part = 0; part < parts * parts && !progress; part++)
+				{
+					int32_t x = (int32_t)(part % parts * width / parts), y = (int32_t)(part / parts * height / parts);
+					uint32_t w = (part % parts + 1) * width / parts - x, h = (part / parts + 1) * height / parts - y;
+
+					std::vector<uint64_t> words = fuzzCase->grid->words;
+					life::fillRegion(fuzzCase->grid, x, y, w, h, false);
+					uint64_t diverged = fuzzCase->grid->words != words ? firstDivergence(engine, fuzzCase) : 0;
+					if (diverged && diverged < FUZZ_FAILED)
+					{
+						fuzzCase->generations = diverged;
+						progress = true;
+					}
+					else
+						fuzzCase->grid->words = words;
+				}
+			}
+
+			const uint32_t cuts[] = { 64, 8, 1 };
+			for (uint32_t cut : cuts)
+			{
+				// right, bottom, left and top
+				for (uint32_t edge = 0; edge < 4 && !progress; edge++)
+				{
+					uint32_t width = fuzzCase->grid->width, height = fuzzCase->grid->height;
+					bool columns = edge % 2 == 0, near = edge >= 2;
+					if ((columns ? width : height) <= cut)
+						continue;
+
+					LifeGrid* original = fuzzCase->grid;
+					life::createGrid(&fuzzCase->grid, width, height);
+					fuzzCase->grid->words = original->words;
+					cropGrid(&fuzzCase->grid, near && columns ? cut : 0, near && !columns ? cut : 0,
+						columns ? width - cut : width, columns ? height : height - cut);
+
+					uint64_t diverged = firstDivergence(engine, fuzzCase);
+					if (diverged && diverged < FUZZ_FAILED)
+					{
+						fuzzCase->generations = diverged;
+						life::destroyGrid(original);
+						progress = true;
+					}
+					else
+					{
+						life::destroyGrid(fuzzCase->grid);
+						fuzzCase->grid = original;
+					}
+				}
+			}
+		}
+	}
+
+	static void reportCase(FuzzEngine engine, const FuzzCase* fuzzCase, uint64_t seed, const char* outputDir)
+	{
+		char rule[32], path[512];
+		life::ruleString(&fuzzCase->rule, rule, sizeof(rule));
+		snprintf(path, sizeof(path), "%s/fuzz-%s-%llu.rle", outputDir, s_Engines[engine], (unsigned long long)seed);
+
+		printf("fuzz: %s diverges at generation %llu on %u x %u %s, rule %s, %u threads, lane %u\n", s_Engines[engine],
+			(unsigned long long)fuzzCase->generations, fuzzCase->grid->width, fuzzCase->grid->height,
+			fuzzCase->topology == Life_Topology_Torus ? "torus" : "plane", rule, fuzzCase->threadCount, fuzzCase->lane);
+		if (life::savePattern(path, fuzzCase->grid, &fuzzCase->rule) == Life_Result_Success)
+		{
+			printf("fuzz: run it again with cgol-fuzz --replay %s --engines %s --gens %llu --threads %u%s\n", path, s_Engines[engine],
+				(unsigned long long)fuzzCase->generations, fuzzCase->threadCount, fuzzCase->topology == Life_Topology_Torus ? " --torus" : "");
+		}
+		fflush(stdout);
+	}
+
+	static const char* optionValue(int argc, char** argv, const char* name)
+	{
+		for (int i = 1; i < argc - 1; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+				return argv[i + 1];
+		}
+		return nullptr;
+	}
+
+	static bool hasFlag(int argc, char** argv, const char* name)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+				return true;
+		}
+		return false;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	using namespace fuzz;
+
+	if (hasFlag(argc, argv, "--help"))
+	{
+		printf("%s", s_Usage);
+		return 0;
+	}
+
+	const char* value;
+	bool engines[Fuzz_Engine_Count] = { true, true, true, true, true, true, true };
+	if ((value = optionValue(argc, argv, "--engines")))
+	{
+		for (uint32_t engine = 0; engine < Fuzz_Engine_Count; engine++)
+		{
+			const char* found = strstr(value, s_Engines[engine]);
+			size_t length = strlen(s_Engines[engine]);
+			engines[engine] = found && (found == value || found[-1] == ',') && (found[length] == '\0' || found[length] == ',');
+		}
+	}
+
+	const char* outputDir = (value = optionValue(argc, argv, "--output")) ? value : ".";
+
+	if ((value = optionValue(argc, argv, "--replay")))
+	{
+		FuzzCase fuzzCase{};
+		bool hasRule = false;
+		if (life::loadPattern(value, &fuzzCase.grid, &fuzzCase.rule, &hasRule) == Life_Result_Failed)
+		{
+			printf("fuzz: failed to load %s\n", value);
+			return 1;
+		}
+		if (!hasRule) fuzzCase.rule = LIFE_RULE_CONWAY;
+		fuzzCase.topology = hasFlag(argc, argv, "--torus") ? Life_Topology_Torus : Life_Topology_Plane;
+		fuzzCase.generations = (value = optionValue(argc, argv, "--gens")) ? strtoull(value, nullptr, 10) : 64;
+		fuzzCase.threadCount = (value = optionValue(argc, argv, "--threads")) ? (uint32_t)strtoul(value, nullptr, 10) : 4;
+
+		bool failed = false;
+		for (uint32_t engine = 0; engine < Fuzz_Engine_Count; engine++)
+		{
+			if (!engines[engine]) continue;
+			uint64_t diverged = firstDivergence((FuzzEngine)engine, &fuzzCase);
+			printf("fuzz: %s %s\n", s_Engines[engine], diverged == FUZZ_SKIPPED ? "skipped" : diverged == FUZZ_FAILED ? "failed to run" : diverged ? "diverges" : "agrees");
+			if (diverged && diverged < FUZZ_FAILED) printf("fuzz: first bad generation %llu\n", (unsigned long long)diverged);
+			failed = failed || (diverged && diverged != FUZZ_SKIPPED);
+		}
+		life::destroyGrid(fuzzCase.grid);
+		return failed ? 1 : 0;
+	}
+
+	uint64_t seed = (value = optionValue(argc, argv, "--seed")) ? strtoull(value, nullptr, 10) : 1;
+	uint64_t cases = (value = optionValue(argc, argv, "--cases")) ? strtoull(value, nullptr, 10) : 1000;
+	double seconds = (value = optionValue(argc, argv, "--seconds")) ? strtod(value, nullptr) : 0.0;
+	uint32_t maxSize = (value = optionValue(argc, argv, "--max-size")) ? std::max<uint32_t>((uint32_t)strtoul(value, nullptr, 10), 1) : 300;
+	uint64_t maxGenerations = (value = optionValue(argc, argv, "--max-gens")) ? std::max<uint64_t>(strtoull(value, nullptr, 10), 1) : 64;
+	uint64_t distributedEvery = (value = optionValue(argc, argv, "--distributed")) ? std::max<uint64_t>(strtoull(value, nullptr, 10), 1) : 50;
+
+	auto startTime = std::chrono::steady_clock::now();
+	auto lastProgress = startTime;
+	uint64_t ran = 0, failures = 0, skipped = 0;
+	for (uint64_t index = 0; cases == 0 || index < cases; index++)
+	{
+		auto now = std::chrono::steady_clock::now();
+		if (seconds > 0.0 && std::chrono::duration<double>(now - startTime).count() >= seconds)
+			break;
+		if (now - lastProgress >= std::chrono::seconds(10))
+		{
+			fprintf(stderr, "fuzz: %llu cases, %llu failures, %.0f s\n", (unsigned long long)ran, (unsigned long long)failures,
+				std::chrono::duration<double>(now - startTime).count());
+			lastProgress = now;
+		}
+
+		uint64_t caseSeed = seed + index;
+		for (uint32_t engine = 0; engine < Fuzz_Engine_Count; engine++)
+		{
+			if (!engines[engine] || (engine == Fuzz_Engine_Distributed && index % distributedEvery != 0))
+				continue;
+
+			FuzzCase fuzzCase;
+			randomCase(caseSeed, maxSize, maxGenerations, &fuzzCase);
+			uint64_t diverged = firstDivergence((FuzzEngine)engine, &fuzzCase);
+			if (diverged == FUZZ_SKIPPED)
+			{
+				skipped++;
+			}
+			else if (diverged == FUZZ_FAILED)
+			{
+				printf("fuzz: %s failed to run case %llu\n", s_Engines[engine], (unsigned long long)caseSeed);
+				fflush(stdout);
+				failures++;
+			}
+			else if (diverged)
+			{
+				shrinkCase((FuzzEngine)engine, &fuzzCase);
+				reportCase((FuzzEngine)engine, &fuzzCase, caseSeed, outputDir);
+				failures++;
+			}
+			life::destroyGrid(fuzzCase.grid);
+		}
+		ran++;
+	}
+
+	printf("fuzz: %llu cases from seed %llu, %llu failures, %llu engine runs skipped, %.1f s\n", (unsigned long long)ran, (unsigned long long)seed,
+		(unsigned long long)failures, (unsigned long long)skipped, std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count());
+	return failures ? 1 : 0;
+}
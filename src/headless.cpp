@@ -0,0 +1,1358 @@
+#include "headless.h"
+#include "life.h"
+#include "census.h"
+#include "pattern.h"
+#include "settle.h"
+#include "ensemble.h"
+#include "distributed.h"
+#include "publish.h"
+#include "control.h"
+#include "stream.h"
+#include "mapped.h"
+#include "placement.h"
+#include "sparse.h"
+#include "trace.h"
+
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// one generation of --stats-format binary, little endian
+struct StatsRecord
+{
+	uint64_t generation;
+	uint64_t population, births, deaths;
+	uint32_t x, y, width, height;
+};
+
+namespace headless
+{
+	static const char* s_Usage =
+		"usage: cgol [mode] [options]\n"
+		"\n"
+		"modes:\n"
+		"  --census              run random soups until they settle and tally the resulting objects\n"
+		"  --until-stable <files> step each pattern until it dies, becomes still or periodic\n"
+		"  --ensemble            run batches of small random universes together until each one settles\n"
+		"  --distributed         split one universe across worker processes sharing memory\n"
+		"  --run                 step one large universe, optionally publishing it for cgol --attach <name>\n"
+		"  --replay <file>       play back a stream of changed tiles written by --run --stream\n"
+		"  --out-of-core <file>  step a universe kept in file a stripe of rows at a time, it may exceed memory\n"
+		"  --sparse              step an unbounded plane kept as tiles around its live cells\n"
+		"\n"
+		"census options:\n"
+		"  --soups <n>           number of soups to run (default 10000)\n"
+		"  --seed <n>            seed of the first soup (default 1)\n"
+		"  --soup-size <n>       soups are n x n cells (default 16)\n"
+		"  --universe <n>        soups evolve on an n x n plane (default 256)\n"
+		"  --density <f>         probability of a soup cell being alive (default 0.5)\n"
+		"  --max-gen <n>         generations before a soup counts as unstable (default 20000)\n"
+		"  --distance <n>        cells within n of each other form one object (default 1)\n"
+		"  --max-period <n>      longest object period the classifier looks for (default 32)\n"
+		"  --output <file>       census file to write (default census.txt)\n"
+		"\n"
+		"until-stable options:\n"
+		"  --list <file>         also read pattern paths from file, one per line\n"
+		"  --max-gen <n>         generations before a pattern counts as unsettled (default 100000)\n"
+		"  --history <n>         longest period detected (default 4096)\n"
+		"  --margin <n>          dead cells around each pattern (default 128)\n"
+		"  --universe <n>        evolve on an n x n grid instead of pattern size plus margin\n"
+		"  --torus               wrap around the edges instead of a dead border\n"
+		"                        patterns reaching the border of a plane are reported, widen the margin for those\n"
+		"  --output <file>       also write the results as tab separated values\n"
+		"  patterns in RLE (.rle) or plaintext (.cells), an RLE rule is used unless --rule is given\n"
+		"\n"
+		"ensemble options:\n"
+		"  --universes <n>       universes stepped together, a multiple of 64 (default 512)\n"
+		"  --batches <n>         number of ensembles to run (default 1)\n"
+		"  --size <n>            universes are n x n cells (default 120)\n"
+		"  --seed <n>            seed of the first universe (default 1)\n"
+		"  --density <f>         probability of a cell being alive (default 0.35)\n"
+		"  --max-gen <n>         generations before a universe counts as unsettled (default 5000)\n"
+		"  --max-period <n>      longest period detected, below 64 (default 4)\n"
+		"  --torus               wrap around the edges instead of a dead border\n"
+		"  --output <file>       write every universe's result as tab separated values\n"
+		"\n"
+		"distributed options:\n"
+		"  --workers <n>         worker processes, each owns a stripe of rows (default 4)\n"
+		"  --universe <n>        the universe is n x n cells (default 4096)\n"
+		"  --gens <n>            generations to run (default 1000)\n"
+		"  --pattern <file>      start from a pattern in the middle instead of a random fill\n"
+		"  --seed <n>            seed of the random fill (default 1)\n"
+		"  --density <f>         probability of a cell being alive (default 0.35)\n"
+		"  --sync <n>            generations between barriers and population reductions (default 1)\n"
+		"  --slots <n>           halo rows a worker may run ahead of its neighbours (default 4)\n"
+		"  --name <name>         shared memory segment name (default a random /cgol-<n>)\n"
+		"  --torus               wrap around the edges instead of a dead border\n"
+		"  --verify              step the same universe in this process and compare the final state\n"
+		"\n"
+		"run options:\n"
+		"  --universe <n>        the universe is n x n cells (default 4096)\n"
+		"  --gens <n>            generations to run, 0 runs until interrupted (default 0)\n"
+		"  --pattern <file>      start from a pattern in the middle instead of a random fill\n"
+		"  --transform <t>       rotate or mirror the pattern first: rot90, rot180, rot270, flipx, flipy,\n"
+		"                        transpose or antitranspose\n"
+		"  --seed <n>            seed of the random fill (default 1)\n"
+		"  --density <f>         probability of a cell being alive (default 0.35)\n"
+		"  --publish <name>      copy the state to shared memory segment name for viewers to attach to\n"
+		"  --interval <ms>       milliseconds between published copies (default 16)\n"
+		"  --control <path>      accept commands on a Unix domain socket, see the README for the protocol\n"
+		"  --paused              start paused, the control socket's step and resume commands advance it\n"
+		"  --stream <file>       write the changed tiles of every frame to file or a named pipe\n"
+		"  --stream-interval <ms> milliseconds between streamed frames, 0 streams every generation (default 0)\n"
+		"  --keyframes <n>       frames between keyframes a late reader can sync at (default 100)\n"
+		"  --stats <file>        write the population, births, deaths and bounding box of every generation\n"
+		"  --stats-format <f>    csv or binary, binary writes 48 byte records, see the README (default csv)\n"
+		"  --numa                pin the step threads, move the rows each one steps to its NUMA node and\n"
+		"                        back the universe with 2 MB huge pages, Linux only\n"
+		"\n"
+		"out-of-core options:\n"
+		"  --universe <n>        a new universe is n x n cells (default 65536)\n"
+		"  --resume              continue the universe already in the file instead of replacing it\n"
+		"  --gens <n>            generations to run (default 10)\n"
+		"  --pattern <file>      start from a pattern in the middle instead of a random fill\n"
+		"  --seed <n>            seed of the random fill (default 1)\n"
+		"  --density <f>         probability of a cell being alive (default 0.35)\n"
+		"  --stripe-rows <n>     rows read, stepped and written back at a time, 0 picks about 64 MB (default 0)\n"
+		"  --torus               wrap around the edges instead of a dead border\n"
+		"  --verify              step the same universe in memory and compare the final state\n"
+		"\n"
+		"sparse options:\n"
+		"  --gens <n>            generations to run (default 1000)\n"
+		"  --pattern <file>      start from a pattern instead of a random soup\n"
+		"  --soup-size <n>       the random soup is n x n cells (default 1024)\n"
+		"  --seed <n>            seed of the random soup (default 1)\n"
+		"  --density <f>         probability of a soup cell being alive (default 0.35)\n"
+		"  --verify              step the same cells on a bounded plane large enough to hold them and compare\n"
+		"\n"
+		"replay options:\n"
+		"  --publish <name>      show the frames to cgol --attach <name> viewers\n"
+		"  --interval <ms>       milliseconds between published frames (default 33)\n"
+		"  --output <file>       write the last frame as RLE\n"
+		"  --torus               wrap around the edges instead of a dead border\n"
+		"\n"
+		"common options:\n"
+		"  --rule <rule>         rule string such as B3/S23 (default B3/S23)\n"
+		"  --threads <n>         worker threads, 0 uses every hardware thread (default 0)\n"
+		"  --trace <file>        record steps, tiles and I/O as Chrome trace JSON, written at exit\n";
+
+	// first arguments that run without a window
+	static const char* s_Modes[] = { "--census", "--until-stable", "--ensemble", "--distributed", "--run", "--replay", "--out-of-core", "--sparse", "--help" };
+
+	// options that do not take a value, every other option consumes the next argument
+	static const char* s_Flags[] = { "--census", "--until-stable", "--ensemble", "--distributed", "--run", "--sparse", "--paused", "--numa", "--resume", "--torus", "--verify", "--help" };
+
+	// the options each mode reads after its own name, any other one is refused rather than ignored
+	static const char* s_CommonOptions[] = { "--rule", "--threads", "--trace" };
+	static const char* s_ModeOptions[][20] =
+	{
+		{ "--census", "--soups", "--seed", "--soup-size", "--universe", "--density", "--max-gen", "--distance", "--max-period", "--output" },
+		{ "--until-stable", "--list", "--max-gen", "--history", "--margin", "--universe", "--torus", "--output" },
+		{ "--ensemble", "--universes", "--batches", "--size", "--seed", "--density", "--max-gen", "--max-period", "--torus", "--output" },
+		{ "--distributed", "--workers", "--universe", "--gens", "--pattern", "--seed", "--density", "--sync", "--slots", "--name", "--torus", "--verify" },
+		{ "--run", "--universe", "--gens", "--pattern", "--transform", "--seed", "--density", "--publish", "--interval", "--control", "--paused",
+			"--stream", "--stream-interval", "--keyframes", "--stats", "--stats-format", "--numa", "--torus" },
+		{ "--replay", "--publish", "--interval", "--output", "--torus" },
+		{ "--out-of-core", "--universe", "--resume", "--gens", "--pattern", "--seed", "--density", "--stripe-rows", "--torus", "--verify" },
+		{ "--sparse", "--gens", "--pattern", "--soup-size", "--seed", "--density", "--verify" },
+	};
+
+	static const char* optionValue(int argc, char** argv, const char* name);
+	static bool hasFlag(int argc, char** argv, const char* name);
+	static void positionalArguments(int argc, char** argv, std::vector<std::string>* arguments);
+	static bool knownOptions(int argc, char** argv);
+	static int runCensus(int argc, char** argv);
+	static int runUntilStable(int argc, char** argv);
+	static int runEnsemble(int argc, char** argv);
+	static int runDistributed(int argc, char** argv);
+	static void interrupt(int);
+	static bool writeStats(FILE* file, bool binary, uint64_t generation, const LifeStepStats* stats);
+	static int runSimulation(int argc, char** argv);
+	static int runReplay(int argc, char** argv);
+	static int runOutOfCore(int argc, char** argv);
+	static uint64_t residentMemory();
+	static void printSparse(const LifeSparseGrid* grid);
+	static int runSparse(int argc, char** argv);
+	static int runMode(int argc, char** argv);
+
+	static volatile sig_atomic_t s_Interrupted = 0;
+
+	static const char* optionValue(int argc, char** argv, const char* name)
+	{
+		for (int i = 1; i < argc - 1; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+				return argv[i + 1];
+		}
+		return nullptr;
+	}
+
+	static bool hasFlag(int argc, char** argv, const char* name)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strcmp(argv[i], name) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	static void positionalArguments(int argc, char** argv, std::vector<std::string>* arguments)
+	{
+		for (int i = 1; i < argc; i++)
+		{
+			if (strncmp(argv[i], "--", 2) != 0)
+			{
+				arguments->push_back(argv[i]);
+				continue;
+			}
+
+			bool flag = false;
+			for (const char* name : s_Flags)
+				flag = flag || strcmp(argv[i], name) == 0;
+			if (!flag) i++;
+		}
+	}
+
+	// a misspelt option would otherwise leave its default in place without a word
+	static bool knownOptions(int argc, char** argv)
+	{
+		const char* const* options = nullptr;
+		for (const auto& mode : s_ModeOptions)
+		{
+			if (strcmp(mode[0], argv[1]) == 0)
+				options = mode;
+		}
+		if (!options)
+			return true;
+
+		for (int i = 1; i < argc; i++)
+		{
+			if (strncmp(argv[i], "--", 2) != 0)
+				continue;
+
+			bool known = false;
+			for (const char* name : s_CommonOptions)
+				known = known || strcmp(argv[i], name) == 0;
+			for (uint32_t j = 0; j < sizeof(s_ModeOptions[0]) / sizeof(s_ModeOptions[0][0]) && options[j]; j++)
+				known = known || strcmp(argv[i], options[j]) == 0;
+			if (!known)
+			{
+				printf("%s does not take %s\n", argv[1], argv[i]);
+				return false;
+			}
+
+			bool flag = false;
+			for (const char* name : s_Flags)
+				flag = flag || strcmp(argv[i], name) == 0;
+			if (!flag) i++;
+		}
+		return true;
+	}
+
+	static int runCensus(int argc, char** argv)
+	{
+		LifeCensusInfo censusInfo{};
+		censusInfo.seed = 1;
+		censusInfo.soupCount = 10000;
+		censusInfo.soupSize = 16;
+		censusInfo.universeSize = 256;
+		censusInfo.maxGenerations = 20000;
+		censusInfo.threadCount = 0;
+		censusInfo.progressInterval = 2;
+		censusInfo.distance = 1;
+		censusInfo.maxPeriod = 32;
+		censusInfo.density = 0.5f;
+		censusInfo.rule = LIFE_RULE_CONWAY;
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--soups")))     censusInfo.soupCount = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--seed")))      censusInfo.seed = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--soup-size"))) censusInfo.soupSize = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--universe")))  censusInfo.universeSize = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--density")))   censusInfo.density = strtof(value, nullptr);
+		if ((value = optionValue(argc, argv, "--max-gen")))   censusInfo.maxGenerations = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--threads")))   censusInfo.threadCount = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--distance")))  censusInfo.distance = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--max-period"))) censusInfo.maxPeriod = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--rule")) && life::parseRule(value, &censusInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", value);
+			return 1;
+		}
+
+		const char* outputPath = optionValue(argc, argv, "--output");
+		if (!outputPath) outputPath = "census.txt";
+
+		LifeCensusResult result;
+		if (life::runCensus(&censusInfo, &result) == Life_Result_Failed)
+			return 1;
+
+		printf("census: %llu soups in %.2f s, %.1f soups/sec, %llu objects, %llu unstable\n",
+			(unsigned long long)result.soups, result.seconds, result.seconds > 0.0 ? result.soups / result.seconds : 0.0,
+			(unsigned long long)result.objects, (unsigned long long)result.unstable);
+
+		if (life::writeCensus(outputPath, &censusInfo, &result) == Life_Result_Failed)
+			return 1;
+
+		printf("census written to %s\n", outputPath);
+		return 0;
+	}
+
+	static int runUntilStable(int argc, char** argv)
+	{
+		LifeSettleInfo settleInfo{};
+		settleInfo.rule = LIFE_RULE_CONWAY;
+		settleInfo.topology = hasFlag(argc, argv, "--torus") ? Life_Topology_Torus : Life_Topology_Plane;
+		settleInfo.maxGenerations = 100000;
+		settleInfo.history = 4096;
+		uint32_t threadCount = 0, margin = 128, universeSize = 0;
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--max-gen")))  settleInfo.maxGenerations = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--history")))  settleInfo.history = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--threads")))  threadCount = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--margin")))   margin = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--universe"))) universeSize = strtoul(value, nullptr, 10);
+
+		const char* ruleValue = optionValue(argc, argv, "--rule");
+		if (ruleValue && life::parseRule(ruleValue, &settleInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", ruleValue);
+			return 1;
+		}
+
+		std::vector<std::string> paths;
+		positionalArguments(argc, argv, &paths);
+
+		if ((value = optionValue(argc, argv, "--list")))
+		{
+			FILE* list = fopen(value, "r");
+			if (!list)
+			{
+				printf("until-stable: failed to open %s\n", value);
+				return 1;
+			}
+
+			char line[4096];
+			while (fgets(line, sizeof(line), list))
+			{
+				size_t length = strcspn(line, "\r\n");
+				if (length > 0) paths.emplace_back(line, length);
+			}
+			fclose(list);
+		}
+
+		if (paths.empty() || settleInfo.history == 0)
+		{
+			printf("%s", s_Usage);
+			return 1;
+		}
+
+		if (threadCount == 0) threadCount = life::hardwareThreads();
+
+		// a single pattern gets every thread, batches run one pattern per thread
+		uint32_t workerCount = (uint32_t)std::min<size_t>(threadCount, paths.size());
+		uint32_t stepThreads = workerCount == 1 ? threadCount : 1;
+
+		std::vector<LifeSettleResult> results(paths.size());
+		std::vector<bool> loaded(paths.size(), false);
+		std::atomic<size_t> nextPattern{ 0 };
+		auto startTime = std::chrono::steady_clock::now();
+
+		auto worker = [&]()
+		{
+			for (;;)
+			{
+				size_t index = nextPattern.fetch_add(1);
+				if (index >= paths.size()) break;
+
+				LifeGrid *pattern, *universe;
+				LifeSettleInfo patternInfo = settleInfo;
+				patternInfo.threadCount = stepThreads;
+				if (life::loadPattern(paths[index].c_str(), &pattern, ruleValue ? nullptr : &patternInfo.rule, nullptr) == Life_Result_Failed)
+					continue;
+
+				uint32_t width = universeSize ? universeSize : pattern->width + margin * 2;
+				uint32_t height = universeSize ? universeSize : pattern->height + margin * 2;
+				if (width < pattern->width || height < pattern->height)
+				{
+					printf("until-stable: %s does not fit in the universe\n", paths[index].c_str());
+					life::destroyGrid(pattern);
+					continue;
+				}
+
+				life::createGrid(&universe, width, height);
+				life::placePattern(universe, pattern, (width - pattern->width) / 2, (height - pattern->height) / 2);
+
+				if (life::runUntilStable(universe, &patternInfo, &results[index]) == Life_Result_Success)
+					loaded[index] = true;
+
+				life::destroyGrid(pattern);
+				life::destroyGrid(universe);
+			}
+		};
+
+		std::vector<std::thread> threads;
+		for (uint32_t i = 1; i < workerCount; i++)
+			threads.emplace_back(worker);
+		worker();
+		for (std::thread& thread : threads)
+			thread.join();
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+
+		const char* outputPath = optionValue(argc, argv, "--output");
+		FILE* output = outputPath ? fopen(outputPath, "w") : nullptr;
+		if (outputPath && !output)
+			printf("until-stable: failed to open %s\n", outputPath);
+		if (output)
+			fprintf(output, "pattern\tresult\tgeneration\tperiod\tpopulation\tedge\n");
+
+		uint64_t counts[4] = {}, failed = 0;
+		for (size_t i = 0; i < paths.size(); i++)
+		{
+			if (!loaded[i])
+			{
+				failed++;
+				continue;
+			}
+
+			const LifeSettleResult& result = results[i];
+			counts[result.state]++;
+
+			char edge[64] = "";
+			if (result.reachedEdge)
+				snprintf(edge, sizeof(edge), ", reached the edge at generation %llu", (unsigned long long)result.edgeGeneration);
+
+			if (result.state == Life_Settle_Unsettled)
+				printf("%s: unsettled after %llu generations, population %llu%s\n", paths[i].c_str(),
+					(unsigned long long)result.generation, (unsigned long long)result.population, edge);
+			else if (result.state == Life_Settle_Dies)
+				printf("%s: dies at generation %llu%s\n", paths[i].c_str(), (unsigned long long)result.generation, edge);
+			else
+				printf("%s: %s from generation %llu, period %llu, population %llu%s\n", paths[i].c_str(), life::settleStateName(result.state),
+					(unsigned long long)result.generation, (unsigned long long)result.period, (unsigned long long)result.population, edge);
+
+			if (output)
+				fprintf(output, "%s\t%s\t%llu\t%llu\t%llu\t%lld\n", paths[i].c_str(), life::settleStateName(result.state),
+					(unsigned long long)result.generation, (unsigned long long)result.period, (unsigned long long)result.population,
+					result.reachedEdge ? (long long)result.edgeGeneration : -1ll);
+		}
+
+		if (output) fclose(output);
+
+		printf("until-stable: %zu patterns in %.2f s, %llu still, %llu periodic, %llu die, %llu unsettled, %llu failed\n",
+			paths.size(), seconds, (unsigned long long)counts[Life_Settle_Still], (unsigned long long)counts[Life_Settle_Periodic],
+			(unsigned long long)counts[Life_Settle_Dies], (unsigned long long)counts[Life_Settle_Unsettled], (unsigned long long)failed);
+
+		return failed == 0 ? 0 : 1;
+	}
+
+	static int runEnsemble(int argc, char** argv)
+	{
+		LifeEnsembleCreateInfo ensembleCreateInfo{};
+		ensembleCreateInfo.width = 120;
+		ensembleCreateInfo.universeCount = 512;
+		ensembleCreateInfo.maxPeriod = 4;
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = LIFE_RULE_CONWAY;
+		stepInfo.topology = hasFlag(argc, argv, "--torus") ? Life_Topology_Torus : Life_Topology_Plane;
+		stepInfo.threadCount = 0;
+
+		uint64_t seed = 1, batches = 1, maxGenerations = 5000;
+		float density = 0.35f;
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--universes")))  ensembleCreateInfo.universeCount = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--size")))       ensembleCreateInfo.width = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--max-period"))) ensembleCreateInfo.maxPeriod = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--batches")))    batches = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--seed")))       seed = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--max-gen")))    maxGenerations = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--density")))    density = strtof(value, nullptr);
+		if ((value = optionValue(argc, argv, "--threads")))    stepInfo.threadCount = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--rule")) && life::parseRule(value, &stepInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", value);
+			return 1;
+		}
+		ensembleCreateInfo.height = ensembleCreateInfo.width;
+
+		LifeEnsemble* ensemble;
+		if (life::createEnsemble(&ensemble, &ensembleCreateInfo) == Life_Result_Failed)
+		{
+			printf("ensemble: invalid size, universe count or period\n");
+			return 1;
+		}
+
+		const char* outputPath = optionValue(argc, argv, "--output");
+		FILE* output = outputPath ? fopen(outputPath, "w") : nullptr;
+		if (outputPath && !output)
+			printf("ensemble: failed to open %s\n", outputPath);
+		if (output)
+			fprintf(output, "universe\tresult\tgeneration\tperiod\tpopulation\tedge\n");
+
+		uint32_t universes = life::ensembleUniverses(ensemble);
+		std::vector<LifeSettleResult> results(universes);
+		LifeGrid* grid;
+		life::createGrid(&grid, ensembleCreateInfo.width, ensembleCreateInfo.height);
+
+		uint64_t counts[4] = {}, generations = 0, settledGenerations = 0;
+		auto startTime = std::chrono::steady_clock::now();
+
+		for (uint64_t batch = 0; batch < batches; batch++)
+		{
+			for (uint32_t universe = 0; universe < universes; universe++)
+			{
+				LifeRandomInfo randomInfo{};
+				randomInfo.seed = life::randomWord(seed, batch * universes + universe);
+				randomInfo.density = density;
+				randomInfo.threadCount = 1;
+				life::fillRandom(grid, &randomInfo);
+				life::setEnsembleUniverse(ensemble, universe, grid);
+			}
+
+			generations += life::runEnsemble(ensemble, &stepInfo, maxGenerations);
+			life::ensembleResults(ensemble, results.data());
+
+			for (uint32_t universe = 0; universe < universes; universe++)
+			{
+				const LifeSettleResult& result = results[universe];
+				counts[result.state]++;
+				if (result.state != Life_Settle_Unsettled)
+					settledGenerations += result.generation;
+
+				if (output)
+					fprintf(output, "%llu\t%s\t%llu\t%llu\t%llu\t%lld\n", (unsigned long long)(batch * universes + universe), life::settleStateName(result.state),
+						(unsigned long long)result.generation, (unsigned long long)result.period, (unsigned long long)result.population,
+						result.reachedEdge ? (long long)result.edgeGeneration : -1ll);
+			}
+
+			printf("ensemble: batch %llu/%llu, %u of %u universes settled after %llu generations\n", (unsigned long long)(batch + 1), (unsigned long long)batches,
+				life::ensembleSettled(ensemble), universes, (unsigned long long)life::ensembleGeneration(ensemble));
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		uint64_t settled = counts[Life_Settle_Dies] + counts[Life_Settle_Still] + counts[Life_Settle_Periodic];
+
+		printf("ensemble: %llu universes in %.2f s, %.0f universe generations/sec\n", (unsigned long long)(batches * universes), seconds,
+			seconds > 0.0 ? generations * universes / seconds : 0.0);
+		printf("ensemble: %llu still, %llu periodic, %llu die, %llu unsettled, settled at generation %.1f on average\n",
+			(unsigned long long)counts[Life_Settle_Still], (unsigned long long)counts[Life_Settle_Periodic], (unsigned long long)counts[Life_Settle_Dies],
+			(unsigned long long)counts[Life_Settle_Unsettled], settled > 0 ? (double)settledGenerations / settled : 0.0);
+
+		if (output) fclose(output);
+		life::destroyGrid(grid);
+		life::destroyEnsemble(ensemble);
+		return 0;
+	}
+
+	static int runDistributed(int argc, char** argv)
+	{
+		char name[64];
+		snprintf(name, sizeof(name), "/cgol-%ld", (long)life::randomWord(std::chrono::steady_clock::now().time_since_epoch().count(), 0) & 0xFFFFFF);
+
+		LifeDistributedInfo distributedInfo{};
+		distributedInfo.width = 4096;
+		distributedInfo.workerCount = 4;
+		distributedInfo.slots = 4;
+		distributedInfo.syncInterval = 1;
+		distributedInfo.progressInterval = 2;
+		distributedInfo.generations = 1000;
+		distributedInfo.rule = LIFE_RULE_CONWAY;
+		distributedInfo.topology = hasFlag(argc, argv, "--torus") ? Life_Topology_Torus : Life_Topology_Plane;
+		distributedInfo.seed = 1;
+		distributedInfo.density = 0.35f;
+		distributedInfo.name = name;
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--workers")))  distributedInfo.workerCount = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--universe"))) distributedInfo.width = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--gens")))     distributedInfo.generations = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--seed")))     distributedInfo.seed = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--density")))  distributedInfo.density = strtof(value, nullptr);
+		if ((value = optionValue(argc, argv, "--sync")))     distributedInfo.syncInterval = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--slots")))    distributedInfo.slots = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--name")))     distributedInfo.name = value;
+		distributedInfo.pattern = optionValue(argc, argv, "--pattern");
+		if ((value = optionValue(argc, argv, "--rule")) && life::parseRule(value, &distributedInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", value);
+			return 1;
+		}
+		distributedInfo.height = distributedInfo.width;
+
+		LifeDistributedResult result;
+		if (life::runDistributed(&distributedInfo, &result) == Life_Result_Failed)
+			return 1;
+
+		double cellUpdates = (double)distributedInfo.width * distributedInfo.height * distributedInfo.generations;
+		printf("distributed: %u workers, generation %llu, population %llu, %.2f s, %.0f generations/sec, %.3g cell updates/sec\n",
+			distributedInfo.workerCount, (unsigned long long)result.generation, (unsigned long long)result.reduction.population, result.seconds,
+			result.seconds > 0.0 ? distributedInfo.generations / result.seconds : 0.0, result.seconds > 0.0 ? cellUpdates / result.seconds : 0.0);
+
+		if (!hasFlag(argc, argv, "--verify"))
+			return 0;
+
+		LifeGrid *grid, *next;
+		life::createGrid(&grid, distributedInfo.width, distributedInfo.height);
+		life::createGrid(&next, distributedInfo.width, distributedInfo.height);
+		if (life::initialRows(&distributedInfo, 0, grid) == Life_Result_Failed)
+			return 1;
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = distributedInfo.rule;
+		stepInfo.topology = distributedInfo.topology;
+		stepInfo.threadCount = 0;
+		for (uint64_t generation = 0; generation < distributedInfo.generations; generation++)
+		{
+			life::step(grid, next, &stepInfo);
+			std::swap(grid, next);
+		}
+
+		bool match = life::hashGrid(grid) == result.reduction.hash && life::population(grid) == result.reduction.population;
+		printf("distributed: single process %s\n", match ? "matches" : "differs");
+
+		life::destroyGrid(grid);
+		life::destroyGrid(next);
+		return match ? 0 : 1;
+	}
+
+	static void interrupt(int)
+	{
+		s_Interrupted = 1;
+	}
+
+	static bool writeStats(FILE* file, bool binary, uint64_t generation, const LifeStepStats* stats)
+	{
+		if (binary)
+		{
+			StatsRecord record{ generation, stats->population, stats->births, stats->deaths, stats->x, stats->y, stats->width, stats->height };
+			return fwrite(&record, sizeof(record), 1, file) == 1;
+		}
+		return fprintf(file, "%llu,%llu,%llu,%llu,%u,%u,%u,%u\n", (unsigned long long)generation, (unsigned long long)stats->population,
+			(unsigned long long)stats->births, (unsigned long long)stats->deaths, stats->x, stats->y, stats->width, stats->height) > 0;
+	}
+
+	static int runSimulation(int argc, char** argv)
+	{
+		uint32_t universeSize = 4096, threadCount = 0, interval = 16, streamInterval = 0, keyframes = 100;
+		uint64_t generations = 0, seed = 1;
+		float density = 0.35f;
+
+		// the run loop and the control socket step and edit the same target
+		LifeControlTarget target{};
+		target.stepInfo.rule = LIFE_RULE_CONWAY;
+		target.stepInfo.topology = hasFlag(argc, argv, "--torus") ? Life_Topology_Torus : Life_Topology_Plane;
+		target.paused = hasFlag(argc, argv, "--paused");
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--universe"))) universeSize = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--gens")))     generations = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--seed")))     seed = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--density")))  density = strtof(value, nullptr);
+		if ((value = optionValue(argc, argv, "--threads")))  threadCount = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--interval"))) interval = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--stream-interval"))) streamInterval = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--keyframes"))) keyframes = strtoul(value, nullptr, 10);
+		const char* patternPath = optionValue(argc, argv, "--pattern");
+		const char* publishName = optionValue(argc, argv, "--publish");
+		const char* controlPath = optionValue(argc, argv, "--control");
+		const char* streamPath = optionValue(argc, argv, "--stream");
+		const char* statsPath = optionValue(argc, argv, "--stats");
+		const char* statsFormat = optionValue(argc, argv, "--stats-format");
+
+		const char* ruleValue = optionValue(argc, argv, "--rule");
+		if (ruleValue && life::parseRule(ruleValue, &target.stepInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", ruleValue);
+			return 1;
+		}
+
+		LifeTransform transform = Life_Transform_Identity;
+		const char* transformValue = optionValue(argc, argv, "--transform");
+		if (transformValue && life::parseTransform(transformValue, &transform) == Life_Result_Failed)
+		{
+			printf("invalid transform: %s\n", transformValue);
+			return 1;
+		}
+
+		if (universeSize == 0 || (statsFormat && strcmp(statsFormat, "csv") != 0 && strcmp(statsFormat, "binary") != 0))
+		{
+			printf("%s", s_Usage);
+			return 1;
+		}
+		bool statsBinary = statsFormat && strcmp(statsFormat, "binary") == 0;
+
+		target.stepInfo.threadCount = threadCount;
+		life::createGrid(&target.grid, universeSize, universeSize);
+		life::createGrid(&target.next, universeSize, universeSize);
+
+		LifeResult result = Life_Result_Success;
+		if (patternPath)
+		{
+			LifeGrid* pattern;
+			result = life::loadPattern(patternPath, &pattern, ruleValue ? nullptr : &target.stepInfo.rule, nullptr);
+			if (result == Life_Result_Success && transform != Life_Transform_Identity)
+			{
+				LifeGrid transformed;
+				life::transformGrid(pattern, transform, &transformed);
+				*pattern = std::move(transformed);
+			}
+			if (result == Life_Result_Success)
+			{
+				life::placePattern(target.grid, pattern, ((int32_t)universeSize - (int32_t)pattern->width) / 2, ((int32_t)universeSize - (int32_t)pattern->height) / 2);
+				life::destroyGrid(pattern);
+			}
+		}
+		else
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = seed;
+			randomInfo.density = density;
+			randomInfo.threadCount = threadCount;
+			life::fillRandom(target.grid, &randomInfo);
+		}
+
+		// the cells are placed first, first touch then moves every thread's rows to its node
+		if (result == Life_Result_Success && hasFlag(argc, argv, "--numa"))
+		{
+			life::setThreadPinning(true);
+			life::placeGrid(target.grid, threadCount, true);
+			life::placeGrid(target.next, threadCount, true);
+
+			LifePlacementReport placement;
+			life::gridPlacement(target.grid, &placement);
+			printf("run: %u NUMA nodes, %.0f of %.0f MB on huge pages, sampled pages per node:", placement.nodeCount,
+				placement.hugePageBytes / 1048576.0, target.grid->words.size() * sizeof(uint64_t) / 1048576.0);
+			for (uint32_t node = 0; node < std::min<uint32_t>(placement.nodeCount, LIFE_MAX_NODES); node++)
+				printf(" %llu", (unsigned long long)placement.nodePages[node]);
+			printf("\n");
+		}
+
+		LifePublisher* publisher = nullptr;
+		if (result == Life_Result_Success && publishName)
+		{
+			LifePublishInfo publishInfo{};
+			publishInfo.width = universeSize;
+			publishInfo.height = universeSize;
+			publishInfo.interval = interval;
+			result = life::createPublisher(&publisher, publishName, &publishInfo);
+			if (result == Life_Result_Success)
+			{
+				life::publishGrid(publisher, target.grid, 0, true);
+				printf("run: publishing to %s, view it with cgol --attach %s\n", publishName, publishName);
+			}
+		}
+
+		LifeControlServer* control = nullptr;
+		if (result == Life_Result_Success && controlPath)
+		{
+			result = life::createControlServer(&control, controlPath);
+			if (result == Life_Result_Success)
+				printf("run: listening for commands on %s\n", controlPath);
+		}
+
+		FILE* stream = nullptr;
+		if (result == Life_Result_Success && streamPath && !(stream = fopen(streamPath, "wb")))
+		{
+			printf("run: failed to open %s\n", streamPath);
+			result = Life_Result_Failed;
+		}
+
+		// the step kernel counts these as it goes, nothing walks the grid again, and the population
+		// each step leaves is the next step's src population unless a command edits the grid
+		FILE* statsFile = nullptr;
+		LifeStepStats stats{};
+		uint64_t statsPopulation = 0;
+		if (result == Life_Result_Success && statsPath)
+		{
+			if ((statsFile = fopen(statsPath, statsBinary ? "wb" : "w")))
+			{
+				if (!statsBinary) fprintf(statsFile, "generation,population,births,deaths,x,y,width,height\n");
+				target.stepInfo.stats = &stats;
+				target.stepInfo.srcPopulation = &statsPopulation;
+				statsPopulation = life::population(target.grid);
+			}
+			else
+			{
+				printf("run: failed to open %s\n", statsPath);
+				result = Life_Result_Failed;
+			}
+		}
+
+		if (result == Life_Result_Failed)
+		{
+			if (stream) fclose(stream);
+			if (control) life::destroyControlServer(control);
+			if (publisher) life::destroyPublisher(publisher);
+			life::destroyGrid(target.grid);
+			life::destroyGrid(target.next);
+			return 1;
+		}
+
+		LifeStreamEncoder* encoder = nullptr;
+		std::vector<uint8_t> frameData;
+		uint64_t streamFrames = 0, streamBytes = 0;
+		auto lastFrame = std::chrono::steady_clock::now();
+		if (stream)
+		{
+			LifeStreamInfo streamInfo{};
+			streamInfo.width = universeSize;
+			streamInfo.height = universeSize;
+			streamInfo.keyframeInterval = keyframes;
+			life::createStreamEncoder(&encoder, &streamInfo);
+
+			// a reader closing the pipe only ends the stream
+			signal(SIGPIPE, SIG_IGN);
+		}
+
+		auto emitFrame = [&](bool force)
+		{
+			auto now = std::chrono::steady_clock::now();
+			if (!encoder || (!force && streamFrames > 0 && now - lastFrame < std::chrono::milliseconds(streamInterval)))
+				return;
+			lastFrame = now;
+
+			frameData.clear();
+			life::encodeFrame(encoder, target.grid, target.generation, &frameData, nullptr);
+			if (fwrite(frameData.data(), 1, frameData.size(), stream) != frameData.size() || fflush(stream) != 0)
+			{
+				printf("run: failed to write to %s, streaming stopped\n", streamPath);
+				life::destroyStreamEncoder(encoder);
+				encoder = nullptr;
+				return;
+			}
+			streamFrames++;
+			streamBytes += frameData.size();
+		};
+		emitFrame(true);
+
+		// an interrupted run still removes its shared memory segment and socket
+		signal(SIGINT, interrupt);
+		signal(SIGTERM, interrupt);
+
+		auto startTime = std::chrono::steady_clock::now(), lastReport = startTime;
+		uint64_t stepped = 0;
+		while ((generations == 0 || target.generation < generations) && !s_Interrupted)
+		{
+			// commands run between generations, a paused run only wakes up for them
+			if (control)
+			{
+				target.changed = false;
+				life::serviceControl(control, &target);
+				if (publisher && target.changed)
+					life::publishGrid(publisher, target.grid, target.generation, true);
+				if (statsFile && target.changed)
+					statsPopulation = life::population(target.grid);
+				// a reader that just opened the stream asks for a frame it can sync at
+				if (target.keyframe && encoder)
+					life::requestKeyframe(encoder);
+				if (target.changed || target.keyframe)
+					emitFrame(true);
+				target.keyframe = false;
+
+				// a step command runs through the loop like free running generations, one per turn
+				if (target.paused && target.steps == 0)
+				{
+					life::waitControl(control, 100);
+					continue;
+				}
+				if (target.steps > 0)
+					target.steps--;
+			}
+
+			life::step(target.grid, target.next, &target.stepInfo);
+			std::swap(target.grid, target.next);
+			target.generation++;
+			stepped++;
+
+			if (publisher)
+				life::publishGrid(publisher, target.grid, target.generation, false);
+			emitFrame(false);
+
+			statsPopulation = stats.population;
+			if (statsFile && !writeStats(statsFile, statsBinary, target.generation, &stats))
+			{
+				printf("run: failed to write to %s, statistics stopped\n", statsPath);
+				fclose(statsFile);
+				statsFile = nullptr;
+				target.stepInfo.stats = nullptr;
+				target.stepInfo.srcPopulation = nullptr;
+			}
+
+			auto now = std::chrono::steady_clock::now();
+			if (std::chrono::duration<double>(now - lastReport).count() >= 2.0)
+			{
+				lastReport = now;
+				printf("run: generation %llu, population %llu\n", (unsigned long long)target.generation, (unsigned long long)life::population(target.grid));
+			}
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		double cellUpdates = (double)universeSize * universeSize * stepped;
+		printf("run: generation %llu, population %llu, %.2f s, %.0f generations/sec, %.3g cell updates/sec\n",
+			(unsigned long long)target.generation, (unsigned long long)life::population(target.grid), seconds,
+			seconds > 0.0 ? stepped / seconds : 0.0, seconds > 0.0 ? cellUpdates / seconds : 0.0);
+
+		if (stream)
+		{
+			emitFrame(true);
+			double fullFrame = (double)target.grid->words.size() * sizeof(uint64_t);
+			printf("run: streamed %llu frames, %llu bytes, %.0f bytes per frame against %.0f for a full frame\n",
+				(unsigned long long)streamFrames, (unsigned long long)streamBytes, streamFrames ? (double)streamBytes / streamFrames : 0.0, fullFrame);
+			if (encoder) life::destroyStreamEncoder(encoder);
+			fclose(stream);
+		}
+		if (statsFile)
+		{
+			fclose(statsFile);
+			printf("run: wrote the statistics of %llu generations to %s\n", (unsigned long long)stepped, statsPath);
+		}
+		if (control)
+			life::destroyControlServer(control);
+		if (publisher)
+		{
+			life::publishGrid(publisher, target.grid, target.generation, true);
+			life::destroyPublisher(publisher);
+		}
+
+		life::destroyGrid(target.grid);
+		life::destroyGrid(target.next);
+		return 0;
+	}
+
+	static int runReplay(int argc, char** argv)
+	{
+		uint32_t interval = 33;
+		const char* value;
+		if ((value = optionValue(argc, argv, "--interval"))) interval = strtoul(value, nullptr, 10);
+		const char* path = optionValue(argc, argv, "--replay");
+		const char* publishName = optionValue(argc, argv, "--publish");
+		const char* outputPath = optionValue(argc, argv, "--output");
+
+		FILE* file = path ? fopen(path, "rb") : nullptr;
+		if (!file)
+		{
+			printf("replay: failed to open %s\n", path ? path : "(no file)");
+			return 1;
+		}
+
+		LifeStreamDecoder* decoder;
+		life::createStreamDecoder(&decoder);
+		LifePublisher* publisher = nullptr;
+		LifeResult result = Life_Result_Success;
+
+		signal(SIGINT, interrupt);
+		signal(SIGTERM, interrupt);
+
+		std::vector<uint8_t> data;
+		size_t offset = 0;
+		uint64_t frames = 0, keyframes = 0, skipped = 0, bytes = 0, generation = 0;
+		bool ended = false;
+		while (!ended && !s_Interrupted && result == Life_Result_Success)
+		{
+			LifeStreamFrame frame;
+			size_t used = life::decodeFrame(decoder, data.data() + offset, data.size() - offset, &frame);
+			offset += used;
+
+			if (frame.size == 0)
+			{
+				if (used > 0) continue;
+
+				// keep the undecoded tail and read more of the file
+				data.erase(data.begin(), data.begin() + offset);
+				offset = 0;
+				size_t size = data.size();
+				data.resize(size + (1 << 20));
+				size_t read = fread(data.data() + size, 1, 1 << 20, file);
+				data.resize(size + read);
+				ended = read == 0;
+				continue;
+			}
+
+			frames++;
+			bytes += frame.size;
+			keyframes += frame.keyframe ? 1 : 0;
+			if (!frame.applied)
+			{
+				skipped++;
+				continue;
+			}
+			generation = frame.generation;
+
+			const LifeGrid* grid = life::decodedGrid(decoder);
+			if (publishName && !publisher)
+			{
+				LifePublishInfo publishInfo{};
+				publishInfo.width = grid->width;
+				publishInfo.height = grid->height;
+				result = life::createPublisher(&publisher, publishName, &publishInfo);
+				if (result == Life_Result_Success)
+					printf("replay: publishing to %s, view it with cgol --attach %s\n", publishName, publishName);
+			}
+
+			if (publisher)
+			{
+				life::publishGrid(publisher, grid, frame.generation, true);
+				std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+			}
+		}
+		fclose(file);
+
+		const LifeGrid* grid = life::decodedGrid(decoder);
+		printf("replay: %llu frames, %llu keyframes, %llu skipped before the first keyframe, %llu bytes, generation %llu, population %llu\n",
+			(unsigned long long)frames, (unsigned long long)keyframes, (unsigned long long)skipped, (unsigned long long)bytes,
+			(unsigned long long)generation, grid ? (unsigned long long)life::population(grid) : 0ull);
+
+		if (grid && outputPath)
+		{
+			LifeRule rule = LIFE_RULE_CONWAY;
+			if (life::savePattern(outputPath, grid, &rule) == Life_Result_Failed)
+				result = Life_Result_Failed;
+		}
+
+		if (publisher) life::destroyPublisher(publisher);
+		life::destroyStreamDecoder(decoder);
+		return result == Life_Result_Success && grid ? 0 : 1;
+	}
+
+	static int runOutOfCore(int argc, char** argv)
+	{
+		uint32_t universeSize = 65536;
+		uint64_t generations = 10, seed = 1;
+		float density = 0.35f;
+		bool resume = hasFlag(argc, argv, "--resume");
+		const char* path = optionValue(argc, argv, "--out-of-core");
+
+		LifeMappedCreateInfo createInfo{};
+		createInfo.rule = LIFE_RULE_CONWAY;
+		createInfo.topology = hasFlag(argc, argv, "--torus") ? Life_Topology_Torus : Life_Topology_Plane;
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--universe")))    universeSize = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--gens")))        generations = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--seed")))        seed = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--density")))     density = strtof(value, nullptr);
+		if ((value = optionValue(argc, argv, "--stripe-rows"))) createInfo.stripeRows = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--threads")))     createInfo.threadCount = strtoul(value, nullptr, 10);
+		const char* patternPath = optionValue(argc, argv, "--pattern");
+
+		const char* ruleValue = optionValue(argc, argv, "--rule");
+		if (ruleValue && life::parseRule(ruleValue, &createInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", ruleValue);
+			return 1;
+		}
+
+		if (!path || universeSize == 0)
+		{
+			printf("%s", s_Usage);
+			return 1;
+		}
+		createInfo.width = universeSize;
+		createInfo.height = universeSize;
+
+		// the pattern is loaded first so its rule applies before the file is created
+		LifeGrid* pattern = nullptr;
+		if (!resume && patternPath && life::loadPattern(patternPath, &pattern, ruleValue ? nullptr : &createInfo.rule, nullptr) == Life_Result_Failed)
+			return 1;
+
+		LifeMappedGrid* grid;
+		LifeResult result = resume ? life::openMappedGrid(&grid, path, &createInfo) : life::createMappedGrid(&grid, path, &createInfo);
+		if (result == Life_Result_Failed)
+		{
+			if (pattern) life::destroyGrid(pattern);
+			return 1;
+		}
+
+		// a resumed file steps under the rule and topology stored with it, whatever the flags say
+		uint32_t width, height;
+		char rule[32];
+		life::mappedGridSize(grid, &width, &height);
+		life::mappedGridRule(grid, &createInfo.rule, &createInfo.topology);
+		life::ruleString(&createInfo.rule, rule, sizeof(rule));
+		LifeRandomInfo randomInfo{};
+		randomInfo.seed = seed;
+		randomInfo.density = density;
+		randomInfo.threadCount = createInfo.threadCount;
+		if (pattern)
+			life::placeMappedPattern(grid, pattern, ((int32_t)width - (int32_t)pattern->width) / 2, ((int32_t)height - (int32_t)pattern->height) / 2);
+		else if (!resume)
+			life::fillMappedRandom(grid, &randomInfo);
+
+		double fileBytes = (double)life::mappedFileSize(grid);
+		printf("out-of-core: %u x %u %s in %s, %.1f MB, rule %s, generation %llu\n", width, height,
+			createInfo.topology == Life_Topology_Torus ? "torus" : "plane", path, fileBytes / (1 << 20), rule, (unsigned long long)life::mappedGeneration(grid));
+
+		// a verified run keeps the start state in memory, only sensible for universes that fit
+		LifeGrid *check = nullptr, *checkNext = nullptr;
+		if (hasFlag(argc, argv, "--verify") && resume)
+			printf("out-of-core: --verify needs a fresh universe, ignored with --resume\n");
+		else if (hasFlag(argc, argv, "--verify"))
+		{
+			life::createGrid(&check, width, height);
+			life::createGrid(&checkNext, width, height);
+			if (pattern)
+				life::placePattern(check, pattern, ((int32_t)width - (int32_t)pattern->width) / 2, ((int32_t)height - (int32_t)pattern->height) / 2);
+			else
+				life::fillRandom(check, &randomInfo);
+		}
+		if (pattern) life::destroyGrid(pattern);
+
+		signal(SIGINT, interrupt);
+		signal(SIGTERM, interrupt);
+
+		// every generation reads and writes the whole file once
+		auto startTime = std::chrono::steady_clock::now();
+		uint64_t stepped = 0, population = 0, hash = 0;
+		while (stepped < generations && !s_Interrupted)
+		{
+			auto stepStart = std::chrono::steady_clock::now();
+			life::stepMappedGrid(grid, &population, &hash);
+			stepped++;
+
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - stepStart).count();
+			printf("out-of-core: generation %llu, population %llu, %.2f s, %.0f MB/s\n", (unsigned long long)life::mappedGeneration(grid),
+				(unsigned long long)population, seconds, seconds > 0.0 ? 2.0 * fileBytes / seconds / (1 << 20) : 0.0);
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		double cellUpdates = (double)width * height * stepped;
+		printf("out-of-core: %llu generations, %.2f s, %.0f MB/s read and written, %.3g cell updates/sec\n", (unsigned long long)stepped, seconds,
+			seconds > 0.0 ? 2.0 * fileBytes * stepped / seconds / (1 << 20) : 0.0, seconds > 0.0 ? cellUpdates / seconds : 0.0);
+
+		bool match = true;
+		if (check)
+		{
+			LifeStepInfo stepInfo{};
+			stepInfo.rule = createInfo.rule;
+			stepInfo.topology = createInfo.topology;
+			stepInfo.threadCount = createInfo.threadCount;
+			for (uint64_t generation = 0; generation < stepped; generation++)
+			{
+				life::step(check, checkNext, &stepInfo);
+				std::swap(check, checkNext);
+			}
+
+			match = stepped == 0 || (life::hashGrid(check) == hash && life::population(check) == population);
+			printf("out-of-core: in memory %s\n", match ? "matches" : "differs");
+			life::destroyGrid(check);
+			life::destroyGrid(checkNext);
+		}
+
+		life::destroyMappedGrid(grid);
+		return match ? 0 : 1;
+	}
+
+	// bytes resident now, 0 where /proc is not available
+	static uint64_t residentMemory()
+	{
+		FILE* file = fopen("/proc/self/status", "r");
+		if (!file) return 0;
+
+		char line[256];
+		unsigned long long kilobytes = 0;
+		while (fgets(line, sizeof(line), file))
+		{
+			if (sscanf(line, "VmRSS: %llu kB", &kilobytes) == 1)
+				break;
+		}
+		fclose(file);
+		return kilobytes * 1024;
+	}
+
+	static void printSparse(const LifeSparseGrid* grid)
+	{
+		LifeArenaStats stats;
+		life::sparseArenaStats(grid, &stats);
+		printf("sparse: generation %llu, population %llu, %u tiles, arena %llu live %llu free %llu peak, %llu slabs %.1f MB, resident %.1f MB\n",
+			(unsigned long long)life::sparseGeneration(grid), (unsigned long long)life::sparsePopulation(grid), life::sparseTileCount(grid),
+			(unsigned long long)stats.liveTiles, (unsigned long long)stats.freeTiles, (unsigned long long)stats.peakTiles,
+			(unsigned long long)stats.slabs, stats.bytes / (double)(1 << 20), residentMemory() / (double)(1 << 20));
+	}
+
+	static int runSparse(int argc, char** argv)
+	{
+		uint32_t soupSize = 1024;
+		uint64_t generations = 1000, seed = 1;
+		float density = 0.35f;
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = LIFE_RULE_CONWAY;
+		stepInfo.topology = Life_Topology_Plane;
+
+		const char* value;
+		if ((value = optionValue(argc, argv, "--gens")))      generations = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--soup-size"))) soupSize = strtoul(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--seed")))      seed = strtoull(value, nullptr, 10);
+		if ((value = optionValue(argc, argv, "--density")))   density = strtof(value, nullptr);
+		if ((value = optionValue(argc, argv, "--threads")))   stepInfo.threadCount = strtoul(value, nullptr, 10);
+		const char* patternPath = optionValue(argc, argv, "--pattern");
+
+		const char* ruleValue = optionValue(argc, argv, "--rule");
+		if (ruleValue && life::parseRule(ruleValue, &stepInfo.rule) == Life_Result_Failed)
+		{
+			printf("invalid rule: %s\n", ruleValue);
+			return 1;
+		}
+
+		if (!patternPath && soupSize == 0)
+		{
+			printf("%s", s_Usage);
+			return 1;
+		}
+
+		LifeGrid* pattern;
+		if (patternPath)
+		{
+			if (life::loadPattern(patternPath, &pattern, ruleValue ? nullptr : &stepInfo.rule, nullptr) == Life_Result_Failed)
+				return 1;
+		}
+		else
+		{
+			LifeRandomInfo randomInfo{};
+			randomInfo.seed = seed;
+			randomInfo.density = density;
+			randomInfo.threadCount = stepInfo.threadCount;
+			life::createGrid(&pattern, soupSize, soupSize);
+			life::fillRandom(pattern, &randomInfo);
+		}
+
+		if (stepInfo.rule.birth & 1)
+		{
+			printf("sparse: rules with B0 would fill the unbounded plane\n");
+			life::destroyGrid(pattern);
+			return 1;
+		}
+
+		LifeSparseGrid* grid;
+		if (life::createSparseGrid(&grid) == Life_Result_Failed)
+		{
+			life::destroyGrid(pattern);
+			return 1;
+		}
+		life::placeSparsePattern(grid, pattern, 0, 0);
+		printf("sparse: %u x %u start\n", pattern->width, pattern->height);
+		printSparse(grid);
+
+		// nothing spreads faster than a cell a generation, so a plane with that much margin
+		// around the start holds every live cell, only sensible for short runs of small patterns
+		LifeGrid *check = nullptr, *checkNext = nullptr;
+		uint64_t margin = generations + 1;
+		if (hasFlag(argc, argv, "--verify") && (pattern->width + 2 * margin) * (pattern->height + 2 * margin) > (1ull << 30))
+			printf("sparse: --verify needs a plane of over 2^30 cells, ignored\n");
+		else if (hasFlag(argc, argv, "--verify"))
+		{
+			life::createGrid(&check, pattern->width + 2 * (uint32_t)margin, pattern->height + 2 * (uint32_t)margin);
+			life::createGrid(&checkNext, check->width, check->height);
+			life::placePattern(check, pattern, (int32_t)margin, (int32_t)margin);
+		}
+		life::destroyGrid(pattern);
+
+		signal(SIGINT, interrupt);
+		signal(SIGTERM, interrupt);
+
+		auto startTime = std::chrono::steady_clock::now();
+		uint64_t stepped = 0, report = std::max<uint64_t>(generations / 10, 1);
+		while (stepped < generations && !s_Interrupted)
+		{
+			life::stepSparse(grid, &stepInfo);
+			stepped++;
+			if (stepped % report == 0)
+				printSparse(grid);
+		}
+
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+		printf("sparse: %llu generations, %.2f s, %.0f generations/sec\n", (unsigned long long)stepped, seconds, seconds > 0.0 ? stepped / seconds : 0.0);
+
+		bool match = true;
+		if (check)
+		{
+			for (uint64_t generation = 0; generation < stepped; generation++)
+			{
+				life::step(check, checkNext, &stepInfo);
+				std::swap(check, checkNext);
+			}
+
+			LifeGrid* region;
+			life::createGrid(&region, check->width, check->height);
+			life::copySparseRegion(grid, -(int64_t)margin, -(int64_t)margin, region);
+			match = region->words == check->words && life::population(check) == life::sparsePopulation(grid);
+			printf("sparse: bounded plane %s\n", match ? "matches" : "differs");
+			life::destroyGrid(region);
+			life::destroyGrid(check);
+			life::destroyGrid(checkNext);
+		}
+
+		life::destroySparseGrid(grid);
+		return match ? 0 : 1;
+	}
+
+	bool requested(int argc, char** argv)
+	{
+		if (argc < 2) return false;
+
+		for (const char* mode : s_Modes)
+		{
+			if (strcmp(argv[1], mode) == 0)
+				return true;
+		}
+		return false;
+	}
+
+	int run(int argc, char** argv)
+	{
+		const char* tracePath = optionValue(argc, argv, "--trace");
+		if (tracePath)
+		{
+			life::nameTraceThread("main");
+			life::setTracing(true);
+		}
+
+		int result = runMode(argc, argv);
+
+		if (tracePath && life::writeTrace(tracePath) == Life_Result_Success)
+			printf("trace: wrote %s\n", tracePath);
+		return result;
+	}
+
+	static int runMode(int argc, char** argv)
+	{
+		if (!knownOptions(argc, argv))
+		{
+			printf("%s", s_Usage);
+			return 1;
+		}
+
+		if (strcmp(argv[1], "--census") == 0)
+			return runCensus(argc, argv);
+		if (strcmp(argv[1], "--until-stable") == 0)
+			return runUntilStable(argc, argv);
+		if (strcmp(argv[1], "--ensemble") == 0)
+			return runEnsemble(argc, argv);
+		if (strcmp(argv[1], "--distributed") == 0)
+			return runDistributed(argc, argv);
+		if (strcmp(argv[1], "--run") == 0)
+			return runSimulation(argc, argv);
+		if (strcmp(argv[1], "--replay") == 0)
+			return runReplay(argc, argv);
+		if (strcmp(argv[1], "--out-of-core") == 0)
+			return runOutOfCore(argc, argv);
+		if (strcmp(argv[1], "--sparse") == 0)
+			return runSparse(argc, argv);
+
+		printf("%s", s_Usage);
+		return strcmp(argv[1], "--help") == 0 ? 0 : 1;
+	}
+}
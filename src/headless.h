@@ -0,0 +1,8 @@
+#pragma once
+
+namespace headless
+{
+	// true when the command line asks for a mode that runs without a window
+	bool requested(int argc, char** argv);
+	int  run(int argc, char** argv);
+}
@@ -0,0 +1,276 @@
+#include "history.h"
+#include "trace.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#define HISTORY_SPARE_SEGMENTS 4 // dropped segments kept to be refilled, their buffers are already the right size
+
+// a keyframe followed by the xor of every changed word for each later generation
+struct HistorySegment
+{
+	uint64_t generation;           // generation of the keyframe
+	std::vector<uint64_t> keyframe;
+	std::vector<uint32_t> offsets; // applying changes [0, offsets[i]) to the keyframe gives generation + i
+	std::vector<uint32_t> indices;
+	std::vector<uint64_t> changes;
+};
+
+struct LifeHistory
+{
+	uint32_t wordCount;
+	uint32_t keyframeInterval;
+	uint64_t memoryBudget;
+	uint64_t memory;
+
+	std::vector<HistorySegment> segments; // oldest first, a vector so dropping the oldest frees nothing
+	std::vector<HistorySegment> spares; // emptied segments that kept their capacity
+	size_t largestChanges, largestOffsets;  // most any dropped segment held
+	std::vector<uint64_t> last; // newest recorded state
+	std::vector<uint32_t> deltaIndices;
+	std::vector<uint64_t> deltaChanges;
+};
+
+namespace life
+{
+	static uint64_t segmentMemory(const HistorySegment* segment);
+	static uint64_t newestGeneration(const LifeHistory* history);
+	static const HistorySegment* findSegment(const LifeHistory* history, uint64_t generation);
+	static void restoreWords(const LifeHistory* history, uint64_t generation, uint64_t* words);
+	static void truncateHistory(LifeHistory* history, uint64_t generation);
+	static void pushKeyframe(LifeHistory* history, uint64_t generation, const LifeGrid* grid);
+	static void recordDelta(LifeHistory* history, uint64_t generation, const LifeGrid* grid);
+	static void recycleSegment(LifeHistory* history, HistorySegment* segment);
+
+	static uint64_t segmentMemory(const HistorySegment* segment)
+	{
+		return segment->keyframe.size() * sizeof(uint64_t) + segment->offsets.size() * sizeof(uint32_t) +
+			segment->indices.size() * sizeof(uint32_t) + segment->changes.size() * sizeof(uint64_t);
+	}
+
+	static uint64_t newestGeneration(const LifeHistory* history)
+	{
+		const HistorySegment& segment = history->segments.back();
+		return segment.generation + segment.offsets.size() - 1;
+	}
+
+	static const HistorySegment* findSegment(const LifeHistory* history, uint64_t generation)
+	{
+		auto segment = std::upper_bound(history->segments.begin(), history->segments.end(), generation, [](uint64_t generation, const HistorySegment& segment)
+		{
+			return generation < segment.generation;
+		});
+		return &*(segment - 1);
+	}
+
+	static void restoreWords(const LifeHistory* history, uint64_t generation, uint64_t* words)
+	{
+		const HistorySegment* segment = findSegment(history, generation);
+		std::copy(segment->keyframe.begin(), segment->keyframe.end(), words);
+
+		// the deltas of consecutive generations are stored back to back
+		uint32_t end = segment->offsets[generation - segment->generation];
+		const uint32_t* indices = segment->indices.data();
+		const uint64_t* changes = segment->changes.data();
+		for (uint32_t i = 0; i < end; i++)
+			words[indices[i]] ^= changes[i];
+	}
+
+	// drops generation and everything after it
+	static void truncateHistory(LifeHistory* history, uint64_t generation)
+	{
+		while (!history->segments.empty() && history->segments.back().generation >= generation)
+		{
+			history->memory -= segmentMemory(&history->segments.back());
+			recycleSegment(history, &history->segments.back());
+			history->segments.pop_back();
+		}
+
+		if (history->segments.empty()) return;
+
+		HistorySegment& segment = history->segments.back();
+		history->memory -= segmentMemory(&segment);
+
+		uint32_t kept = (uint32_t)(generation - segment.generation);
+		if (kept < segment.offsets.size())
+		{
+			segment.offsets.resize(kept);
+			segment.indices.resize(segment.offsets.back());
+			segment.changes.resize(segment.offsets.back());
+		}
+
+		history->memory += segmentMemory(&segment);
+		if (generation - 1 <= newestGeneration(history))
+			restoreWords(history, generation - 1, history->last.data());
+	}
+
+	static void pushKeyframe(LifeHistory* history, uint64_t generation, const LifeGrid* grid)
+	{
+		if (history->spares.empty())
+			history->segments.emplace_back();
+		else
+		{
+			history->segments.push_back(std::move(history->spares.back()));
+			history->spares.pop_back();
+
+			// grown once to what segments have needed so far, rather than doubling its way there again
+			HistorySegment& spare = history->segments.back();
+			spare.offsets.reserve(history->largestOffsets);
+			spare.indices.reserve(history->largestChanges);
+			spare.changes.reserve(history->largestChanges);
+		}
+
+		HistorySegment& segment = history->segments.back();
+		segment.generation = generation;
+		segment.keyframe = grid->words;
+		segment.offsets.push_back(0);
+
+		history->memory += segmentMemory(&segment);
+	}
+
+	// once the budget is reached every new keyframe evicts an old segment, reusing its buffers
+	// keeps recording from allocating
+	static void recycleSegment(LifeHistory* history, HistorySegment* segment)
+	{
+		history->largestChanges = std::max(history->largestChanges, segment->changes.size());
+		history->largestOffsets = std::max(history->largestOffsets, segment->offsets.size());
+		if (history->spares.size() >= HISTORY_SPARE_SEGMENTS)
+			return;
+
+		segment->offsets.clear();
+		segment->indices.clear();
+		segment->changes.clear();
+		history->spares.push_back(std::move(*segment));
+	}
+
+	// appends the words that changed since the newest recorded generation
+	static void recordDelta(LifeHistory* history, uint64_t generation, const LifeGrid* grid)
+	{
+		history->deltaIndices.clear();
+		history->deltaChanges.clear();
+
+		const uint64_t* words = grid->words.data();
+		uint64_t* last = history->last.data();
+		for (uint32_t i = 0; i < history->wordCount; i++)
+		{
+			uint64_t change = words[i] ^ last[i];
+			if (change == 0) continue;
+
+			history->deltaIndices.push_back(i);
+			history->deltaChanges.push_back(change);
+			last[i] = words[i];
+		}
+
+		// a new keyframe once restoring would replay more data than a keyframe holds
+		HistorySegment* segment = &history->segments.back();
+		if (segment->offsets.size() > history->keyframeInterval ||
+			segment->changes.size() + history->deltaChanges.size() > history->wordCount)
+		{
+			pushKeyframe(history, generation, grid);
+		}
+		else
+		{
+			history->memory -= segmentMemory(segment);
+			segment->indices.insert(segment->indices.end(), history->deltaIndices.begin(), history->deltaIndices.end());
+			segment->changes.insert(segment->changes.end(), history->deltaChanges.begin(), history->deltaChanges.end());
+			segment->offsets.push_back((uint32_t)segment->changes.size());
+			history->memory += segmentMemory(segment);
+		}
+	}
+
+	LifeResult createHistory(LifeHistory** history, const LifeHistoryCreateInfo* createInfo)
+	{
+		if (createInfo->width == 0 || createInfo->height == 0 || createInfo->keyframeInterval == 0) { return Life_Result_Failed; }
+
+		*history = new LifeHistory();
+		LifeHistory* historyPtr = *history;
+		historyPtr->wordCount = (createInfo->width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS * createInfo->height;
+		historyPtr->keyframeInterval = createInfo->keyframeInterval;
+		historyPtr->memoryBudget = createInfo->memoryBudget;
+		historyPtr->memory = 0;
+		historyPtr->last.assign(historyPtr->wordCount, 0);
+		historyPtr->spares.reserve(HISTORY_SPARE_SEGMENTS);
+		historyPtr->largestChanges = 0;
+		historyPtr->largestOffsets = 0;
+
+		return Life_Result_Success;
+	}
+
+	void destroyHistory(LifeHistory* history)
+	{
+		delete history;
+	}
+
+	void clearHistory(LifeHistory* history)
+	{
+		for (HistorySegment& segment : history->segments)
+			recycleSegment(history, &segment);
+		history->segments.clear();
+		history->memory = 0;
+	}
+
+	void recordHistory(LifeHistory* history, uint64_t generation, const LifeGrid* grid)
+	{
+		LIFE_TRACE_SCOPE("sim", "record history");
+		if (grid->words.size() != history->wordCount) return;
+
+		if (!history->segments.empty() && generation <= newestGeneration(history))
+			truncateHistory(history, generation);
+
+		// a jump ahead, such as fast forwarding a periodic pattern, leaves a gap before a new keyframe
+		if (history->segments.empty() || generation != newestGeneration(history) + 1)
+		{
+			pushKeyframe(history, generation, grid);
+			history->last = grid->words;
+		}
+		else
+			recordDelta(history, generation, grid);
+
+		while (history->memory > history->memoryBudget && history->segments.size() > 1)
+		{
+			history->memory -= segmentMemory(&history->segments.front());
+			recycleSegment(history, &history->segments.front());
+			history->segments.erase(history->segments.begin());
+		}
+	}
+
+	LifeResult restoreHistory(const LifeHistory* history, uint64_t generation, LifeGrid* grid)
+	{
+		LIFE_TRACE_SCOPE("sim", "restore history");
+		uint64_t first, last;
+		if (!historyRange(history, &first, &last) || generation < first || generation > last || grid->words.size() != history->wordCount)
+			return Life_Result_Failed;
+
+		const HistorySegment* segment = findSegment(history, generation);
+		if (generation - segment->generation >= segment->offsets.size())
+			return Life_Result_Failed;
+
+		restoreWords(history, generation, grid->words.data());
+		return Life_Result_Success;
+	}
+
+	bool historyRange(const LifeHistory* history, uint64_t* first, uint64_t* last)
+	{
+		if (history->segments.empty()) return false;
+
+		*first = history->segments.front().generation;
+		*last = newestGeneration(history);
+		return true;
+	}
+
+	bool recordedGeneration(const LifeHistory* history, uint64_t generation, uint64_t* recorded)
+	{
+		if (history->segments.empty() || generation < history->segments.front().generation)
+			return false;
+
+		const HistorySegment* segment = findSegment(history, generation);
+		*recorded = std::min<uint64_t>(generation, segment->generation + segment->offsets.size() - 1);
+		return true;
+	}
+
+	uint64_t historyMemory(const LifeHistory* history)
+	{
+		return history->memory;
+	}
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "life.h"
+
+struct LifeHistory;
+
+struct LifeHistoryCreateInfo
+{
+	uint32_t width, height;    // size of the recorded grids
+	uint32_t keyframeInterval; // most generations between two full keyframes
+	uint64_t memoryBudget;     // bytes kept before the oldest generations are dropped
+};
+
+namespace life
+{
+	LifeResult createHistory(LifeHistory** history, const LifeHistoryCreateInfo* createInfo);
+	void       destroyHistory(LifeHistory* history);
+	void       clearHistory(LifeHistory* history);
+
+	// stores grid as the state at generation, recording a generation that is already in the
+	// history replaces it and drops every later one, after a gap a new keyframe is started and
+	// the generations in the gap cannot be restored
+	void       recordHistory(LifeHistory* history, uint64_t generation, const LifeGrid* grid);
+	// rebuilds a recorded generation from its keyframe and the deltas after it
+	LifeResult restoreHistory(const LifeHistory* history, uint64_t generation, LifeGrid* grid);
+
+	// oldest and newest recorded generation, false when nothing is recorded
+	bool       historyRange(const LifeHistory* history, uint64_t* first, uint64_t* last);
+	// the newest recorded generation at or before generation, false when there is none
+	bool       recordedGeneration(const LifeHistory* history, uint64_t generation, uint64_t* recorded);
+	uint64_t   historyMemory(const LifeHistory* history);
+}
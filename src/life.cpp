@@ -0,0 +1,1174 @@
+#include "life.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#if defined(__linux__)
+#include <sched.h>
+#include <pthread.h>
+#define LIFE_PINNING_SUPPORTED
+#endif
+
+// builds for any x86 still count with the popcount instruction where the CPU has one
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__)) && !defined(__POPCNT__)
+#define LIFE_POPCNT_DISPATCH
+#endif
+
+#define BLOCK_CACHE_BYTES (512 << 10) // both buffers of a band, about the size of an L2 cache
+#define BLOCK_TUNE_BYTES (32 << 20)  // sample tuned on, larger than most last level caches
+#define BLOCK_MAX_DEPTH 16
+
+// a depth tuned by stepBlocked for one grid size and thread count
+struct BlockTuning
+{
+	uint32_t width, height, threadCount;
+	uint32_t depth;
+};
+
+// bit sliced partial sums of the live cells in a run of words
+struct BitCounter
+{
+	uint64_t ones, twos, fours;
+	uint64_t eights;
+};
+
+// hash and statistics of a range of rows, folded into the step's totals once per range,
+// changed cells and the population of src give the births and deaths once the step is done
+struct RangeTotals
+{
+	uint64_t hash = 0;
+	uint64_t population = 0, changed = 0, previous = 0;
+	uint32_t minX = UINT32_MAX, minY = UINT32_MAX, maxX = 0, maxY = 0;
+};
+
+struct StepTotals
+{
+	std::atomic<uint64_t> hash{ 0 };
+	std::atomic<uint64_t> population{ 0 }, changed{ 0 }, previous{ 0 };
+	std::atomic<uint32_t> minX{ UINT32_MAX }, minY{ UINT32_MAX }, maxX{ 0 }, maxY{ 0 };
+};
+
+// threads kept between calls of parallelRanges, worker i always runs range i of a call so
+// the rows a grid was placed with stay with one thread, and with pinning on one CPU
+struct WorkerPool
+{
+	std::mutex busy; // held for a whole call, a concurrent or nested call spawns its own threads
+	std::mutex lock;
+	std::condition_variable start, finished;
+	std::vector<std::thread> threads;
+	uint64_t job;     // bumped for every call, workers wait for it to move
+	uint32_t pending; // workers still running ranges of the current call
+	uint32_t count, threadCount, workerRanges;
+	void (*func)(void* context, uint32_t begin, uint32_t end);
+	void* context;
+	bool pinned;
+};
+
+struct CycleEntry
+{
+	uint64_t key; // state hash
+	uint64_t generation;
+	bool used;
+};
+
+// an open addressed table of state hash to generation, sized once so recording never allocates
+struct LifeCycleDetector
+{
+	std::vector<CycleEntry> table; // linear probing, a power of two at least twice the capacity
+	std::vector<uint64_t> ring;    // hashes in the order they were recorded
+	uint32_t capacity, next, count;
+	uint32_t mask;
+};
+
+namespace life
+{
+	static bool emptyCycleEntry(const CycleEntry& entry);
+	static uint32_t cycleSlot(const LifeCycleDetector* detector, uint64_t hash);
+	static uint64_t blendWord(uint64_t dst, uint64_t src, uint64_t mask, LifeBlend blend);
+	static uint64_t rowBits(const uint64_t* words, uint32_t stride, int64_t start);
+	static void blendRect(LifeGrid* grid, int32_t x, int32_t y, uint32_t width, uint32_t height, uint64_t value, LifeBlend blend);
+	static void carrySave(uint64_t* high, uint64_t* low, uint64_t a, uint64_t b);
+	static void countBlock(BitCounter* counter, const uint64_t* words);
+	static uint64_t counterTotal(const BitCounter* counter);
+	static void countWords(const uint64_t* cur, const uint64_t* out, uint32_t stride, bool previous, uint64_t* counts);
+#ifdef LIFE_POPCNT_DISPATCH
+	static void countWordsPopcnt(const uint64_t* cur, const uint64_t* out, uint32_t stride, bool previous, uint64_t* counts);
+#endif
+	static void atomicMin(std::atomic<uint32_t>* value, uint32_t x);
+	static void atomicMax(std::atomic<uint32_t>* value, uint32_t x);
+	static void stepRow(const uint64_t* up, const uint64_t* cur, const uint64_t* down, uint64_t* out, const LifeGrid* grid, const LifeStepInfo* stepInfo);
+	static void countRow(RangeTotals* range, const uint64_t* cur, const uint64_t* out, uint32_t stride, uint32_t y, const LifeStepInfo* stepInfo);
+	static void addRange(StepTotals* totals, const RangeTotals* range, const LifeStepInfo* stepInfo);
+	static void finishTotals(const StepTotals* totals, const LifeStepInfo* stepInfo);
+	static void blockPass(const LifeGrid* src, LifeGrid* dst, uint32_t depth, const LifeStepInfo* stepInfo);
+	static void rangeBounds(uint32_t count, uint32_t threadCount, uint32_t index, uint32_t* begin, uint32_t* end);
+	static WorkerPool* workerPool();
+	static void pinThread(uint32_t index, bool pinned);
+	static void poolWorker(WorkerPool* pool, uint32_t index);
+
+	static std::mutex s_BlockLock;
+	static std::vector<BlockTuning> s_BlockDepths;
+	static std::atomic<bool> s_Pinned{ false };
+	static WorkerPool* s_Pool = nullptr;
+
+	static bool emptyCycleEntry(const CycleEntry& entry)
+	{
+		return !entry.used;
+	}
+
+	// the slot holding hash, or the empty slot it would be inserted at
+	static uint32_t cycleSlot(const LifeCycleDetector* detector, uint64_t hash)
+	{
+		return probeSlot(detector->table.data(), detector->mask, hash, emptyCycleEntry);
+	}
+
+	uint64_t ruleWord(uint64_t alive, uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3, const LifeRule* rule)
+	{
+		uint64_t next = 0;
+		for (uint32_t n = 0; n <= 8; n++)
+		{
+			uint16_t bit = 1 << n;
+			if (!((rule->birth | rule->survive) & bit)) continue;
+
+			uint64_t eq = ((n & 1) ? s0 : ~s0) & ((n & 2) ? s1 : ~s1) & ((n & 4) ? s2 : ~s2) & ((n & 8) ? s3 : ~s3);
+			if (rule->birth & bit) next |= eq & ~alive;
+			if (rule->survive & bit) next |= eq & alive;
+		}
+
+		return next;
+	}
+
+	static void stepRow(const uint64_t* up, const uint64_t* cur, const uint64_t* down, uint64_t* out, const LifeGrid* grid, const LifeStepInfo* stepInfo)
+	{
+		uint32_t stride = grid->stride;
+		uint32_t tail = (grid->width - 1) % LIFE_WORD_BITS; // bit of the last cell in the last word
+		bool torus = stepInfo->topology == Life_Topology_Torus;
+		bool conway = stepInfo->rule.birth == LIFE_RULE_CONWAY.birth && stepInfo->rule.survive == LIFE_RULE_CONWAY.survive;
+		uint64_t lastMask = rowMask(grid);
+
+		const uint64_t* rows[3] = { up, cur, down };
+
+		for (uint32_t w = 0; w < stride; w++)
+		{
+			uint64_t left[3], center[3], right[3];
+			for (uint32_t r = 0; r < 3; r++)
+			{
+				const uint64_t* row = rows[r];
+				uint64_t word = row[w];
+				uint64_t prevBit = w > 0 ? row[w - 1] >> 63 : (torus ? (row[stride - 1] >> tail) & 1 : 0);
+				uint64_t nextBit = w + 1 < stride ? row[w + 1] << 63 : 0;
+				if (w == stride - 1 && torus)
+					nextBit = (row[0] & 1) << tail;
+
+				center[r] = word;
+				left[r] = (word << 1) | prevBit;   // neighbour at x - 1
+				right[r] = (word >> 1) | nextBit;  // neighbour at x + 1
+			}
+
+			uint64_t next = nextWord(left, center, right, &stepInfo->rule, conway);
+			out[w] = w == stride - 1 ? next & lastMask : next;
+		}
+	}
+
+	LifeResult createGrid(LifeGrid** grid, uint32_t width, uint32_t height)
+	{
+		if (width == 0 || height == 0) { return Life_Result_Failed; }
+
+		*grid = new LifeGrid();
+		LifeGrid* gridPtr = *grid;
+		gridPtr->width = width;
+		gridPtr->height = height;
+		gridPtr->stride = (width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+		gridPtr->words.assign((size_t)gridPtr->stride * height, 0);
+
+		return Life_Result_Success;
+	}
+
+	void destroyGrid(LifeGrid* grid)
+	{
+		delete grid;
+	}
+
+	void clearGrid(LifeGrid* grid)
+	{
+		std::fill(grid->words.begin(), grid->words.end(), 0);
+	}
+
+	void fillGrid(LifeGrid* grid)
+	{
+		std::fill(grid->words.begin(), grid->words.end(), ~0ull);
+
+		uint64_t lastMask = rowMask(grid);
+		for (uint32_t y = 0; y < grid->height; y++)
+			grid->words[(size_t)y * grid->stride + grid->stride - 1] = lastMask;
+	}
+
+	bool getCell(const LifeGrid* grid, uint32_t x, uint32_t y)
+	{
+		return (grid->words[(size_t)y * grid->stride + x / LIFE_WORD_BITS] >> (x % LIFE_WORD_BITS)) & 1;
+	}
+
+	void setCell(LifeGrid* grid, uint32_t x, uint32_t y, bool alive)
+	{
+		uint64_t& word = grid->words[(size_t)y * grid->stride + x / LIFE_WORD_BITS];
+		uint64_t bit = 1ull << (x % LIFE_WORD_BITS);
+		word = alive ? (word | bit) : (word & ~bit);
+	}
+
+	uint64_t rowMask(const LifeGrid* grid)
+	{
+		uint32_t tail = grid->width % LIFE_WORD_BITS;
+		return tail == 0 ? ~0ull : (1ull << tail) - 1;
+	}
+
+	uint64_t population(const LifeGrid* grid)
+	{
+		uint64_t count = 0;
+		for (uint64_t word : grid->words)
+			count += popcount64(word);
+		return count;
+	}
+
+	uint64_t hashGrid(const LifeGrid* grid)
+	{
+		uint64_t hash = 0;
+		for (uint32_t y = 0; y < grid->height; y++)
+			hash ^= hashRow(grid->words.data() + (size_t)y * grid->stride, grid->stride, y);
+		return hash;
+	}
+
+	bool boundingBox(const LifeGrid* grid, uint32_t* x, uint32_t* y, uint32_t* width, uint32_t* height)
+	{
+		uint32_t left = grid->width, right = 0, top = grid->height, bottom = 0;
+		for (uint32_t row = 0; row < grid->height; row++)
+		{
+			const uint64_t* words = grid->words.data() + (size_t)row * grid->stride;
+			uint32_t first = 0, last = grid->stride - 1;
+			while (first < grid->stride && !words[first]) first++;
+			if (first == grid->stride) continue;
+			while (!words[last]) last--;
+
+			left = std::min(left, first * LIFE_WORD_BITS + lowestBit64(words[first]));
+			right = std::max(right, last * LIFE_WORD_BITS + highestBit64(words[last]));
+			top = std::min(top, row);
+			bottom = row;
+		}
+
+		if (top == grid->height)
+			return false;
+
+		*x = left;
+		*y = top;
+		*width = right - left + 1;
+		*height = bottom - top + 1;
+		return true;
+	}
+
+	// adds two words to low, carrying into high where both were set
+	static void carrySave(uint64_t* high, uint64_t* low, uint64_t a, uint64_t b)
+	{
+		uint64_t u = *low ^ a;
+		*high = (*low & a) | (u & b);
+		*low = u ^ b;
+	}
+
+	// counts eight words with a tree of carry save adders, only the eights carry is popcounted
+	static void countBlock(BitCounter* counter, const uint64_t* words)
+	{
+		uint64_t twosA, twosB, foursA, foursB, eights;
+		carrySave(&twosA, &counter->ones, words[0], words[1]);
+		carrySave(&twosB, &counter->ones, words[2], words[3]);
+		carrySave(&foursA, &counter->twos, twosA, twosB);
+		carrySave(&twosA, &counter->ones, words[4], words[5]);
+		carrySave(&twosB, &counter->ones, words[6], words[7]);
+		carrySave(&foursB, &counter->twos, twosA, twosB);
+		carrySave(&eights, &counter->fours, foursA, foursB);
+		counter->eights += popcount64(eights);
+	}
+
+	static uint64_t counterTotal(const BitCounter* counter)
+	{
+		return 8 * counter->eights + 4 * popcount64(counter->fours) + 2 * popcount64(counter->twos) + popcount64(counter->ones);
+	}
+
+	// counts out, out ^ cur and, when previous is set, cur into counts[0..2]
+	static void countWords(const uint64_t* cur, const uint64_t* out, uint32_t stride, bool previous, uint64_t* counts)
+	{
+		BitCounter alive{}, changed{}, prior{};
+		uint32_t w = 0;
+		for (; w + 8 <= stride; w += 8)
+		{
+			uint64_t flips[8];
+			for (uint32_t i = 0; i < 8; i++)
+				flips[i] = out[w + i] ^ cur[w + i];
+			countBlock(&alive, out + w);
+			countBlock(&changed, flips);
+			if (previous) countBlock(&prior, cur + w);
+		}
+		counts[0] += counterTotal(&alive);
+		counts[1] += counterTotal(&changed);
+		counts[2] += counterTotal(&prior);
+		for (; w < stride; w++)
+		{
+			counts[0] += popcount64(out[w]);
+			counts[1] += popcount64(out[w] ^ cur[w]);
+			counts[2] += previous ? popcount64(cur[w]) : 0;
+		}
+	}
+
+#ifdef LIFE_POPCNT_DISPATCH
+	// the same counts a word at a time, one instruction each
+	__attribute__((target("popcnt")))
+	static void countWordsPopcnt(const uint64_t* cur, const uint64_t* out, uint32_t stride, bool previous, uint64_t* counts)
+	{
+		uint64_t alive = 0, changed = 0, prior = 0;
+		for (uint32_t w = 0; w < stride; w++)
+		{
+			alive += popcount64(out[w]);
+			changed += popcount64(out[w] ^ cur[w]);
+		}
+		if (previous)
+		{
+			for (uint32_t w = 0; w < stride; w++)
+				prior += popcount64(cur[w]);
+		}
+		counts[0] += alive;
+		counts[1] += changed;
+		counts[2] += prior;
+	}
+#endif
+
+	static void atomicMin(std::atomic<uint32_t>* value, uint32_t x)
+	{
+		uint32_t current = value->load(std::memory_order_relaxed);
+		while (x < current && !value->compare_exchange_weak(current, x, std::memory_order_relaxed)) {}
+	}
+
+	static void atomicMax(std::atomic<uint32_t>* value, uint32_t x)
+	{
+		uint32_t current = value->load(std::memory_order_relaxed);
+		while (x > current && !value->compare_exchange_weak(current, x, std::memory_order_relaxed)) {}
+	}
+
+	// only the cells under mask take part, the rest of dst is kept
+	static uint64_t blendWord(uint64_t dst, uint64_t src, uint64_t mask, LifeBlend blend)
+	{
+		switch (blend)
+		{
+		case Life_Blend_Or:      return dst | (src & mask);
+		case Life_Blend_And:     return dst & (src | ~mask);
+		case Life_Blend_Xor:     return dst ^ (src & mask);
+		case Life_Blend_Replace: return (dst & ~mask) | (src & mask);
+		}
+		return dst;
+	}
+
+	// the 64 cells of a row starting at column start, cells outside the row read as dead
+	static uint64_t rowBits(const uint64_t* words, uint32_t stride, int64_t start)
+	{
+		int64_t index = start >= 0 ? start / LIFE_WORD_BITS : -((-start + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS);
+		uint32_t shift = (uint32_t)(start - index * LIFE_WORD_BITS);
+
+		uint64_t low = index >= 0 && index < stride ? words[index] : 0;
+		if (shift == 0) return low;
+		uint64_t high = index + 1 >= 0 && index + 1 < stride ? words[index + 1] : 0;
+		return (low >> shift) | (high << (LIFE_WORD_BITS - shift));
+	}
+
+	// blends the same word into every row of a rectangle, the part outside grid is ignored
+	static void blendRect(LifeGrid* grid, int32_t x, int32_t y, uint32_t width, uint32_t height, uint64_t value, LifeBlend blend)
+	{
+		int64_t left = std::max<int64_t>(x, 0), right = std::min<int64_t>((int64_t)x + width, grid->width);
+		int64_t top = std::max<int64_t>(y, 0), bottom = std::min<int64_t>((int64_t)y + height, grid->height);
+		if (left >= right || top >= bottom)
+			return;
+
+		uint32_t firstWord = (uint32_t)(left / LIFE_WORD_BITS), lastWord = (uint32_t)((right - 1) / LIFE_WORD_BITS);
+		uint64_t firstMask = ~0ull << (left % LIFE_WORD_BITS);
+		uint64_t lastMask = ~0ull >> (LIFE_WORD_BITS - 1 - (right - 1) % LIFE_WORD_BITS);
+
+		for (int64_t row = top; row < bottom; row++)
+		{
+			uint64_t* words = grid->words.data() + (size_t)row * grid->stride;
+			for (uint32_t w = firstWord; w <= lastWord; w++)
+			{
+				uint64_t mask = (w == firstWord ? firstMask : ~0ull) & (w == lastWord ? lastMask : ~0ull);
+				words[w] = blendWord(words[w], value, mask, blend);
+			}
+		}
+	}
+
+	void fillRegion(LifeGrid* grid, int32_t x, int32_t y, uint32_t width, uint32_t height, bool alive)
+	{
+		blendRect(grid, x, y, width, height, alive ? ~0ull : 0, Life_Blend_Replace);
+	}
+
+	void invertRegion(LifeGrid* grid, int32_t x, int32_t y, uint32_t width, uint32_t height)
+	{
+		blendRect(grid, x, y, width, height, ~0ull, Life_Blend_Xor);
+	}
+
+	void copyRegion(const LifeGrid* grid, int32_t x, int32_t y, LifeGrid* region)
+	{
+		for (uint32_t row = 0; row < region->height; row++)
+		{
+			uint64_t* target = region->words.data() + (size_t)row * region->stride;
+			int64_t sourceRow = (int64_t)y + row;
+			if (sourceRow < 0 || sourceRow >= grid->height)
+			{
+				std::fill(target, target + region->stride, 0);
+				continue;
+			}
+
+			// the tail bits of a grid row are dead, so only the region's own tail needs masking
+			const uint64_t* source = grid->words.data() + (size_t)sourceRow * grid->stride;
+			for (uint32_t w = 0; w < region->stride; w++)
+				target[w] = rowBits(source, grid->stride, (int64_t)x + (int64_t)w * LIFE_WORD_BITS);
+			target[region->stride - 1] &= rowMask(region);
+		}
+	}
+
+	void pasteRegion(LifeGrid* grid, const LifeGrid* region, int32_t x, int32_t y, LifeBlend blend)
+	{
+		int64_t left = std::max<int64_t>(x, 0), right = std::min<int64_t>((int64_t)x + region->width, grid->width);
+		int64_t top = std::max<int64_t>(y, 0), bottom = std::min<int64_t>((int64_t)y + region->height, grid->height);
+		if (left >= right || top >= bottom)
+			return;
+
+		uint32_t firstWord = (uint32_t)(left / LIFE_WORD_BITS), lastWord = (uint32_t)((right - 1) / LIFE_WORD_BITS);
+		uint64_t firstMask = ~0ull << (left % LIFE_WORD_BITS);
+		uint64_t lastMask = ~0ull >> (LIFE_WORD_BITS - 1 - (right - 1) % LIFE_WORD_BITS);
+
+		// each target word takes the region's cells shifted into place, a whole word at a time
+		for (int64_t row = top; row < bottom; row++)
+		{
+			uint64_t* target = grid->words.data() + (size_t)row * grid->stride;
+			const uint64_t* source = region->words.data() + (size_t)(row - y) * region->stride;
+			for (uint32_t w = firstWord; w <= lastWord; w++)
+			{
+				uint64_t mask = (w == firstWord ? firstMask : ~0ull) & (w == lastWord ? lastMask : ~0ull);
+				uint64_t bits = rowBits(source, region->stride, (int64_t)w * LIFE_WORD_BITS - x);
+				target[w] = blendWord(target[w], bits, mask, blend);
+			}
+		}
+	}
+
+	// the usual recursive swap: exchange the off diagonal 32 x 32 blocks, then 16 x 16 blocks
+	// inside each, down to single cells, six passes of 32 word pairs
+	void transposeTile(uint64_t* tile)
+	{
+		uint64_t mask = 0x00000000FFFFFFFFull;
+		for (uint32_t j = 32; j != 0; j >>= 1, mask ^= mask << j)
+		{
+			for (uint32_t k = 0; k < 64; k = (k + j + 1) & ~j)
+			{
+				uint64_t t = ((tile[k] >> j) ^ tile[k + j]) & mask;
+				tile[k] ^= t << j;
+				tile[k + j] ^= t;
+			}
+		}
+	}
+
+	void transformGrid(const LifeGrid* src, LifeTransform transform, LifeGrid* dst)
+	{
+		bool transpose = transform & 4, flipX = transform & 1, flipY = transform & 2;
+		dst->width = transpose ? src->height : src->width;
+		dst->height = transpose ? src->width : src->height;
+		dst->stride = (dst->width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+		dst->words.resize((size_t)dst->stride * dst->height);
+
+		if (!transpose)
+		{
+			// a mirrored row is read 64 cells at a time from the far end and bit reversed
+			for (uint32_t y = 0; y < src->height; y++)
+			{
+				const uint64_t* source = src->words.data() + (size_t)y * src->stride;
+				uint64_t* target = dst->words.data() + (size_t)(flipY ? src->height - 1 - y : y) * dst->stride;
+				if (!flipX)
+				{
+					memcpy(target, source, dst->stride * sizeof(uint64_t));
+					continue;
+				}
+				for (uint32_t w = 0; w < dst->stride; w++)
+					target[w] = reverseBits64(rowBits(source, src->stride, (int64_t)src->width - (int64_t)(w + 1) * LIFE_WORD_BITS));
+				target[dst->stride - 1] &= rowMask(dst);
+			}
+			return;
+		}
+
+		// each 64 x 64 tile is transposed whole, mirroring x reads the source rows bottom up and
+		// mirroring y stores the transposed rows bottom up, so no pass visits single cells
+		uint64_t tile[LIFE_WORD_BITS];
+		for (uint32_t ty = 0; ty < dst->stride; ty++)
+		{
+			for (uint32_t tx = 0; tx < src->stride; tx++)
+			{
+				for (uint32_t i = 0; i < LIFE_WORD_BITS; i++)
+				{
+					uint32_t row = ty * LIFE_WORD_BITS + i;
+					tile[i] = row < src->height ? src->words[(size_t)(flipX ? src->height - 1 - row : row) * src->stride + tx] : 0;
+				}
+				transposeTile(tile);
+
+				for (uint32_t j = 0; j < LIFE_WORD_BITS && tx * LIFE_WORD_BITS + j < src->width; j++)
+				{
+					uint32_t column = tx * LIFE_WORD_BITS + j;
+					dst->words[(size_t)(flipY ? src->width - 1 - column : column) * dst->stride + ty] = tile[j];
+				}
+			}
+		}
+	}
+
+	LifeResult parseTransform(const char* str, LifeTransform* transform)
+	{
+		static const char* s_Names[] = { "identity", "flipx", "flipy", "rot180", "transpose", "rot90", "rot270", "antitranspose" };
+		for (uint32_t i = 0; i < 8; i++)
+		{
+			if (strcmp(str, s_Names[i]) == 0)
+			{
+				*transform = (LifeTransform)i;
+				return Life_Result_Success;
+			}
+		}
+		return Life_Result_Failed;
+	}
+
+	// the new row is still in L1, hashing and counting it here saves a second pass over the
+	// grid, only the outermost live words of a row are scanned for the bounding box
+	static void countRow(RangeTotals* range, const uint64_t* cur, const uint64_t* out, uint32_t stride, uint32_t y, const LifeStepInfo* stepInfo)
+	{
+		if (stepInfo->hash)
+			range->hash ^= hashRow(out, stride, y);
+		if (!stepInfo->stats)
+			return;
+
+		// src is only counted when the caller does not know its population
+		uint64_t counts[3] = { 0, 0, 0 };
+		bool previous = !stepInfo->srcPopulation;
+#ifdef LIFE_POPCNT_DISPATCH
+		static const bool s_Popcnt = __builtin_cpu_supports("popcnt");
+		if (s_Popcnt)
+			countWordsPopcnt(cur, out, stride, previous, counts);
+		else
+#endif
+			countWords(cur, out, stride, previous, counts);
+
+		uint64_t rowPopulation = counts[0];
+		range->population += rowPopulation;
+		range->changed += counts[1];
+		range->previous += counts[2];
+
+		if (rowPopulation != 0)
+		{
+			uint32_t first = 0, last = stride - 1;
+			while (out[first] == 0) first++;
+			while (out[last] == 0) last--;
+			range->minX = std::min(range->minX, first * LIFE_WORD_BITS + lowestBit64(out[first]));
+			range->maxX = std::max(range->maxX, last * LIFE_WORD_BITS + highestBit64(out[last]));
+			range->minY = std::min(range->minY, y);
+			range->maxY = std::max(range->maxY, y);
+		}
+	}
+
+	// one reduction per range of rows, not per row
+	static void addRange(StepTotals* totals, const RangeTotals* range, const LifeStepInfo* stepInfo)
+	{
+		if (stepInfo->hash)
+			totals->hash.fetch_xor(range->hash, std::memory_order_relaxed);
+		if (!stepInfo->stats)
+			return;
+
+		totals->population.fetch_add(range->population, std::memory_order_relaxed);
+		totals->changed.fetch_add(range->changed, std::memory_order_relaxed);
+		totals->previous.fetch_add(range->previous, std::memory_order_relaxed);
+		if (range->minY != UINT32_MAX)
+		{
+			atomicMin(&totals->minX, range->minX);
+			atomicMin(&totals->minY, range->minY);
+			atomicMax(&totals->maxX, range->maxX);
+			atomicMax(&totals->maxY, range->maxY);
+		}
+	}
+
+	static void finishTotals(const StepTotals* totals, const LifeStepInfo* stepInfo)
+	{
+		if (stepInfo->hash) *stepInfo->hash = totals->hash.load();
+		if (stepInfo->stats)
+		{
+			LifeStepStats* stats = stepInfo->stats;
+			bool empty = totals->minY.load() == UINT32_MAX;
+			// every changed cell is a birth or a death, births minus deaths is the population's change
+			uint64_t previous = stepInfo->srcPopulation ? *stepInfo->srcPopulation : totals->previous.load();
+			uint64_t changed = totals->changed.load();
+			stats->population = totals->population.load();
+			stats->births = (changed + stats->population - previous) / 2;
+			stats->deaths = changed - stats->births;
+			stats->x = empty ? 0 : totals->minX.load();
+			stats->y = empty ? 0 : totals->minY.load();
+			stats->width = empty ? 0 : totals->maxX.load() - totals->minX.load() + 1;
+			stats->height = empty ? 0 : totals->maxY.load() - totals->minY.load() + 1;
+		}
+	}
+
+	void step(const LifeGrid* src, LifeGrid* dst, const LifeStepInfo* stepInfo)
+	{
+		uint32_t stride = src->stride;
+		uint32_t height = src->height;
+		StepTotals totals;
+
+		// the dead row beyond a plane's edge only grows, so stepping the same size never allocates
+		static thread_local std::vector<uint64_t> zeroRow;
+		if (zeroRow.size() < stride) zeroRow.assign(stride, 0);
+		const uint64_t* zeros = zeroRow.data();
+		LIFE_TRACE_SCOPE("sim", "step");
+
+		parallelFor(height, stepInfo->threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			LIFE_TRACE_SCOPE("sim", "rows");
+			RangeTotals range;
+			for (uint32_t y = begin; y < end; y++)
+			{
+				const uint64_t* up;
+				const uint64_t* down;
+				if (stepInfo->topology == Life_Topology_Torus)
+				{
+					up = src->words.data() + (size_t)(y == 0 ? height - 1 : y - 1) * stride;
+					down = src->words.data() + (size_t)(y == height - 1 ? 0 : y + 1) * stride;
+				}
+				else
+				{
+					up = y == 0 ? zeros : src->words.data() + (size_t)(y - 1) * stride;
+					down = y == height - 1 ? zeros : src->words.data() + (size_t)(y + 1) * stride;
+				}
+
+				const uint64_t* cur = src->words.data() + (size_t)y * stride;
+				uint64_t* out = dst->words.data() + (size_t)y * stride;
+				stepRow(up, cur, down, out, src, stepInfo);
+				countRow(&range, cur, out, stride, y, stepInfo);
+			}
+			addRange(&totals, &range, stepInfo);
+		});
+
+		finishTotals(&totals, stepInfo);
+	}
+
+	// one pass of depth generations: every band of rows is copied with depth halo rows above
+	// and below into a buffer that stays in cache, and each generation the rows that still
+	// have every neighbour shrink by one at both ends until exactly the band is left, only a
+	// plane's own edge does not shrink since the dead cells beyond it never change
+	static void blockPass(const LifeGrid* src, LifeGrid* dst, uint32_t depth, const LifeStepInfo* stepInfo)
+	{
+		uint32_t stride = src->stride;
+		uint32_t height = src->height;
+		uint32_t rows = blockRows(src, depth);
+		uint32_t bands = (height + rows - 1) / rows;
+		bool torus = stepInfo->topology == Life_Topology_Torus;
+		StepTotals totals;
+		LIFE_TRACE_SCOPE("sim", "block pass");
+
+		parallelFor(bands, stepInfo->threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			LIFE_TRACE_SCOPE("sim", "bands");
+
+			// buffers only grow, so passes over the same grid never allocate
+			static thread_local std::vector<uint64_t> buffers[2], zeroRow;
+			size_t bufferWords = (size_t)(rows + 2 * depth) * stride;
+			if (buffers[0].size() < bufferWords) { buffers[0].resize(bufferWords); buffers[1].resize(bufferWords); }
+			if (zeroRow.size() < stride) zeroRow.assign(stride, 0);
+			const uint64_t* zeros = zeroRow.data();
+
+			RangeTotals range;
+			for (uint32_t band = begin; band < end; band++)
+			{
+				int64_t first = (int64_t)band * rows, last = std::min<int64_t>(first + rows, height);
+				int64_t top = first - depth, bottom = last + depth;
+				if (!torus)
+				{
+					top = std::max<int64_t>(top, 0);
+					bottom = std::min<int64_t>(bottom, height);
+				}
+
+				// a torus wraps halo rows around, a band may hold the same row twice
+				uint32_t count = (uint32_t)(bottom - top);
+				uint64_t* cur = buffers[0].data();
+				uint64_t* next = buffers[1].data();
+				for (uint32_t i = 0; i < count; i++)
+				{
+					int64_t y = ((top + i) % height + height) % height;
+					memcpy(cur + (size_t)i * stride, src->words.data() + (size_t)y * stride, stride * sizeof(uint64_t));
+				}
+
+				bool topEdge = !torus && top == 0, bottomEdge = !torus && bottom == height;
+				uint32_t low = 0, high = count;
+				for (uint32_t generation = 0; generation < depth; generation++)
+				{
+					uint32_t nextLow = topEdge ? low : low + 1, nextHigh = bottomEdge ? high : high - 1;
+					for (uint32_t i = nextLow; i < nextHigh; i++)
+					{
+						const uint64_t* up = i == 0 ? zeros : cur + (size_t)(i - 1) * stride;
+						const uint64_t* down = i + 1 == count ? zeros : cur + (size_t)(i + 1) * stride;
+						stepRow(up, cur + (size_t)i * stride, down, next + (size_t)i * stride, src, stepInfo);
+					}
+					low = nextLow;
+					high = nextHigh;
+					std::swap(cur, next);
+				}
+
+				// next still holds the generation before, which the births and deaths compare against
+				uint32_t offset = (uint32_t)(first - top);
+				for (uint32_t y = (uint32_t)first; y < (uint32_t)last; y++)
+				{
+					const uint64_t* row = cur + (size_t)(y - first + offset) * stride;
+					memcpy(dst->words.data() + (size_t)y * stride, row, stride * sizeof(uint64_t));
+					countRow(&range, next + (size_t)(y - first + offset) * stride, row, stride, y, stepInfo);
+				}
+			}
+			addRange(&totals, &range, stepInfo);
+		});
+
+		finishTotals(&totals, stepInfo);
+	}
+
+	uint32_t blockRows(const LifeGrid* grid, uint32_t depth)
+	{
+		// two buffers of a band and its halo fit the cache budget, but a band is never thinner
+		// than four times the halo or recomputing the halo would cost more than it saves
+		size_t bandRows = BLOCK_CACHE_BYTES / (2 * (size_t)grid->stride * sizeof(uint64_t));
+		size_t rows = bandRows > 2 * (size_t)depth ? bandRows - 2 * (size_t)depth : 0;
+		rows = std::max<size_t>(rows, std::max<uint32_t>(4 * depth, 1));
+		return (uint32_t)std::min<size_t>(rows, grid->height);
+	}
+
+	uint32_t tuneBlockDepth(const LifeGrid* grid, const LifeStepInfo* stepInfo)
+	{
+		LIFE_TRACE_SCOPE("sim", "tune block depth");
+
+		// a sample of the grid's own rows, large enough not to fit in the last level cache
+		uint32_t sampleRows = (uint32_t)std::min<size_t>(grid->height, std::max<size_t>(BLOCK_TUNE_BYTES / (grid->stride * sizeof(uint64_t)), 1));
+		LifeGrid *sample = nullptr, *scratch = nullptr;
+		if (createGrid(&sample, grid->width, sampleRows) == Life_Result_Failed ||
+			createGrid(&scratch, grid->width, sampleRows) == Life_Result_Failed)
+		{
+			if (sample) destroyGrid(sample);
+			return 1;
+		}
+		std::copy(grid->words.begin(), grid->words.begin() + (size_t)sampleRows * grid->stride, sample->words.begin());
+
+		LifeStepInfo tuneInfo = *stepInfo;
+		tuneInfo.hash = nullptr;
+		tuneInfo.stats = nullptr;
+
+		uint32_t best = 1;
+		double bestSeconds = 0.0;
+		for (uint32_t depth = 1; depth <= BLOCK_MAX_DEPTH; depth *= 2)
+		{
+			auto startTime = std::chrono::steady_clock::now();
+			stepBlocked(sample, scratch, BLOCK_MAX_DEPTH, depth, &tuneInfo);
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+			if (depth == 1 || seconds < bestSeconds)
+			{
+				best = depth;
+				bestSeconds = seconds;
+			}
+		}
+
+		destroyGrid(sample);
+		destroyGrid(scratch);
+		return best;
+	}
+
+	void stepBlocked(LifeGrid* grid, LifeGrid* scratch, uint32_t generations, uint32_t depth, const LifeStepInfo* stepInfo)
+	{
+		if (depth == 0)
+		{
+			std::lock_guard<std::mutex> guard(s_BlockLock);
+			for (const BlockTuning& tuning : s_BlockDepths)
+			{
+				if (tuning.width == grid->width && tuning.height == grid->height && tuning.threadCount == stepInfo->threadCount)
+					depth = tuning.depth;
+			}
+			if (depth == 0)
+			{
+				depth = tuneBlockDepth(grid, stepInfo);
+				s_BlockDepths.push_back({ grid->width, grid->height, stepInfo->threadCount, depth });
+			}
+		}
+
+		// only the last pass reports the hash and statistics, its src is only the caller's after one generation
+		LifeStepInfo passInfo = *stepInfo, lastInfo = *stepInfo;
+		passInfo.hash = nullptr;
+		passInfo.stats = nullptr;
+		if (generations > 1)
+			lastInfo.srcPopulation = nullptr;
+
+		LifeGrid* src = grid;
+		LifeGrid* dst = scratch;
+		while (generations > 0)
+		{
+			uint32_t passDepth = std::min(depth, generations);
+			generations -= passDepth;
+			if (passDepth == 1)
+				step(src, dst, generations == 0 ? &lastInfo : &passInfo);
+			else
+				blockPass(src, dst, passDepth, generations == 0 ? &lastInfo : &passInfo);
+			std::swap(src, dst);
+		}
+
+		// the words swap rather than being copied after an odd number of passes
+		if (src != grid)
+			std::swap(grid->words, scratch->words);
+	}
+
+	LifeResult createCycleDetector(LifeCycleDetector** detector, uint32_t capacity)
+	{
+		if (capacity == 0) { return Life_Result_Failed; }
+
+		*detector = new LifeCycleDetector();
+		LifeCycleDetector* detectorPtr = *detector;
+		detectorPtr->capacity = capacity;
+		detectorPtr->ring.resize(capacity);
+
+		uint32_t size = 2;
+		while (size < capacity * 2) size *= 2;
+		detectorPtr->table.assign(size, CycleEntry{});
+		detectorPtr->mask = size - 1;
+		detectorPtr->next = 0;
+		detectorPtr->count = 0;
+
+		return Life_Result_Success;
+	}
+
+	void destroyCycleDetector(LifeCycleDetector* detector)
+	{
+		delete detector;
+	}
+
+	void resetCycleDetector(LifeCycleDetector* detector)
+	{
+		std::fill(detector->table.begin(), detector->table.end(), CycleEntry{});
+		detector->next = 0;
+		detector->count = 0;
+	}
+
+	bool recordCycle(LifeCycleDetector* detector, uint64_t generation, uint64_t hash, LifeCycle* cycle)
+	{
+		const CycleEntry& entry = detector->table[cycleSlot(detector, hash)];
+		if (entry.used && entry.generation < generation)
+		{
+			cycle->generation = entry.generation;
+			cycle->period = generation - entry.generation;
+			return true;
+		}
+
+		// evict the oldest generation once the table is full
+		if (detector->count == detector->capacity)
+		{
+			uint32_t evicted = cycleSlot(detector, detector->ring[detector->next]);
+			if (detector->table[evicted].used && detector->table[evicted].generation + detector->capacity <= generation)
+				eraseSlot(detector->table.data(), detector->mask, evicted, emptyCycleEntry);
+		}
+		else
+		{
+			detector->count++;
+		}
+
+		detector->ring[detector->next] = hash;
+		detector->next = (detector->next + 1) % detector->capacity;
+		detector->table[cycleSlot(detector, hash)] = { hash, generation, true };
+
+		return false;
+	}
+
+	uint64_t cycleSteps(const LifeCycle* cycle, uint64_t current, uint64_t target)
+	{
+		if (target <= current) return 0;
+		return (target - current) % cycle->period;
+	}
+
+	LifeResult parseRule(const char* str, LifeRule* rule)
+	{
+		LifeRule parsed{};
+		uint16_t* target = nullptr;
+		bool slashOnly = true; // "23/3" lists survival first
+
+		for (const char* c = str; *c; c++)
+		{
+			if (*c == 'B' || *c == 'b') { target = &parsed.birth; slashOnly = false; }
+			else if (*c == 'S' || *c == 's') { target = &parsed.survive; slashOnly = false; }
+		}
+
+		if (slashOnly) target = &parsed.survive;
+
+		for (const char* c = str; *c; c++)
+		{
+			if (*c == 'B' || *c == 'b') { target = &parsed.birth; }
+			else if (*c == 'S' || *c == 's') { target = &parsed.survive; }
+			else if (*c == '/' && slashOnly) { target = &parsed.birth; }
+			else if (*c >= '0' && *c <= '8')
+			{
+				if (!target) return Life_Result_Failed;
+				*target |= 1 << (*c - '0');
+			}
+			else if (*c != '/' && *c != ' ') { return Life_Result_Failed; }
+		}
+
+		// births without neighbours would need a strobing plane, which the kernels do not model
+		if (parsed.birth & 1) return Life_Result_Failed;
+
+		*rule = parsed;
+		return Life_Result_Success;
+	}
+
+	void ruleString(const LifeRule* rule, char* str, uint32_t size)
+	{
+		char buffer[32];
+		uint32_t len = 0;
+		buffer[len++] = 'B';
+		for (uint32_t n = 0; n <= 8; n++)
+			if (rule->birth & (1 << n)) buffer[len++] = '0' + n;
+		buffer[len++] = '/';
+		buffer[len++] = 'S';
+		for (uint32_t n = 0; n <= 8; n++)
+			if (rule->survive & (1 << n)) buffer[len++] = '0' + n;
+		buffer[len] = 0;
+
+		snprintf(str, size, "%s", buffer);
+	}
+
+	uint64_t randomWord(uint64_t seed, uint64_t counter)
+	{
+		return mix64(mix64(seed) + (counter + 1) * 0x9E3779B97F4A7C15ull);
+	}
+
+	void fillRandom(LifeGrid* grid, const LifeRandomInfo* randomInfo)
+	{
+		uint32_t density = (uint32_t)(randomInfo->density * 256.0f + 0.5f);
+		if (density > 256) density = 256;
+
+		uint64_t seed = randomInfo->seed;
+		uint64_t lastMask = rowMask(grid);
+		uint32_t stride = grid->stride;
+		uint64_t* words = grid->words.data();
+
+		// every output word combines up to 8 random words, one per bit of the density,
+		// starting from the least significant set bit: OR for a set bit, AND for a clear one
+		uint32_t firstBit = 0;
+		while (density != 0 && density != 256 && !((density >> firstBit) & 1)) firstBit++;
+
+		parallelFor(grid->height, randomInfo->threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; y++)
+			{
+				uint64_t* row = words + (size_t)y * stride;
+				for (uint32_t w = 0; w < stride; w++)
+				{
+					uint64_t value = 0;
+					if (density == 256)
+					{
+						value = ~0ull;
+					}
+					else if (density != 0)
+					{
+						uint64_t counter = (((uint64_t)randomInfo->firstRow + y) * stride + w) * 8;
+						for (uint32_t bit = firstBit; bit < 8; bit++)
+						{
+							uint64_t r = randomWord(seed, counter + bit);
+							value = ((density >> bit) & 1) ? (value | r) : (value & r);
+						}
+					}
+
+					row[w] = w == stride - 1 ? value & lastMask : value;
+				}
+			}
+		});
+	}
+
+	uint32_t hardwareThreads()
+	{
+		uint32_t count = std::thread::hardware_concurrency();
+		return count == 0 ? 1 : count;
+	}
+
+	void setThreadPinning(bool pinned)
+	{
+		s_Pinned.store(pinned);
+	}
+
+	// the same split for every call with the same count and thread count
+	static void rangeBounds(uint32_t count, uint32_t threadCount, uint32_t index, uint32_t* begin, uint32_t* end)
+	{
+		uint32_t chunk = count / threadCount, extra = count % threadCount;
+		*begin = index * chunk + std::min(index, extra);
+		*end = *begin + chunk + (index < extra ? 1 : 0);
+	}
+
+	// never destroyed, the workers sleep until the process exits
+	static WorkerPool* workerPool()
+	{
+		static std::once_flag created;
+		std::call_once(created, []()
+		{
+			s_Pool = new WorkerPool();
+#ifdef LIFE_PINNING_SUPPORTED
+			// a forked child has none of the workers, it starts a pool of its own
+			pthread_atfork(nullptr, nullptr, []() { s_Pool = new WorkerPool(); });
+#endif
+		});
+		return s_Pool;
+	}
+
+	// workers are spread over the CPUs the process may use, grouped by NUMA node, so
+	// consecutive ranges of rows are stepped on the same node
+	static void pinThread(uint32_t index, bool pinned)
+	{
+#ifdef LIFE_PINNING_SUPPORTED
+		static std::vector<uint32_t> cpus;
+		static cpu_set_t allowed;
+		static std::once_flag ordered;
+		std::call_once(ordered, []()
+		{
+			if (sched_getaffinity(0, sizeof(allowed), &allowed) != 0)
+				return;
+
+			std::vector<bool> taken(CPU_SETSIZE, false);
+			for (uint32_t node = 0;; node++)
+			{
+				char path[64];
+				snprintf(path, sizeof(path), "/sys/devices/system/node/node%u/cpulist", node);
+				FILE* file = fopen(path, "r");
+				if (!file) break;
+
+				// a list such as 0-15,32-47
+				unsigned first, last;
+				while (fscanf(file, "%u", &first) == 1)
+				{
+					last = first;
+					if (fgetc(file) == '-' && fscanf(file, "%u", &last) == 1) fgetc(file);
+					for (uint32_t cpu = first; cpu <= last && cpu < CPU_SETSIZE; cpu++)
+					{
+						if (!CPU_ISSET(cpu, &allowed) || taken[cpu]) continue;
+						taken[cpu] = true;
+						cpus.push_back(cpu);
+					}
+				}
+				fclose(file);
+			}
+
+			// machines without nodes in sysfs are pinned in CPU order
+			for (uint32_t cpu = 0; cpu < CPU_SETSIZE; cpu++)
+			{
+				if (CPU_ISSET(cpu, &allowed) && !taken[cpu])
+					cpus.push_back(cpu);
+			}
+		});
+		if (cpus.empty()) return;
+
+		cpu_set_t set;
+		if (pinned)
+		{
+			CPU_ZERO(&set);
+			CPU_SET(cpus[index % cpus.size()], &set);
+		}
+		else
+			set = allowed;
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+#endif
+	}
+
+	static void poolWorker(WorkerPool* pool, uint32_t index)
+	{
+		uint64_t seen = 0;
+		bool pinned = false;
+		for (;;)
+		{
+			std::unique_lock<std::mutex> guard(pool->lock);
+			pool->start.wait(guard, [&]() { return pool->job != seen; });
+			seen = pool->job;
+			if (index >= pool->workerRanges)
+				continue;
+			guard.unlock();
+
+			if (pinned != pool->pinned)
+			{
+				pinned = pool->pinned;
+				pinThread(index, pinned);
+			}
+
+			uint32_t begin, end;
+			rangeBounds(pool->count, pool->threadCount, index, &begin, &end);
+			pool->func(pool->context, begin, end);
+
+			guard.lock();
+			if (--pool->pending == 0)
+				pool->finished.notify_one();
+		}
+	}
+
+	void parallelRanges(uint32_t count, uint32_t threadCount, void (*func)(void* context, uint32_t begin, uint32_t end), void* context)
+	{
+		if (threadCount == 0) threadCount = hardwareThreads();
+		if (threadCount > count) threadCount = count;
+
+		bool pinned = s_Pinned.load();
+		if (threadCount <= 1 && !pinned)
+		{
+			if (count > 0) func(context, 0, count);
+			return;
+		}
+
+		// the caller runs the last range itself unless every range has to run on a pinned worker
+		WorkerPool* pool = workerPool();
+		std::unique_lock<std::mutex> busy(pool->busy, std::try_to_lock);
+		if (busy.owns_lock())
+		{
+			uint32_t workerRanges = pinned ? threadCount : threadCount - 1;
+			std::unique_lock<std::mutex> guard(pool->lock);
+			while (pool->threads.size() < workerRanges)
+				pool->threads.emplace_back(poolWorker, pool, (uint32_t)pool->threads.size());
+
+			pool->count = count;
+			pool->threadCount = threadCount;
+			pool->workerRanges = workerRanges;
+			pool->func = func;
+			pool->context = context;
+			pool->pinned = pinned;
+			pool->pending = workerRanges;
+			pool->job++;
+			guard.unlock();
+			pool->start.notify_all();
+
+			if (!pinned)
+			{
+				uint32_t begin, end;
+				rangeBounds(count, threadCount, threadCount - 1, &begin, &end);
+				func(context, begin, end);
+			}
+
+			guard.lock();
+			pool->finished.wait(guard, [&]() { return pool->pending == 0; });
+			return;
+		}
+
+		std::vector<std::thread> threads;
+		threads.reserve(threadCount - 1);
+		for (uint32_t i = 0; i < threadCount; i++)
+		{
+			uint32_t begin, end;
+			rangeBounds(count, threadCount, i, &begin, &end);
+			if (i == threadCount - 1)
+				func(context, begin, end);
+			else
+				threads.emplace_back(func, context, begin, end);
+		}
+
+		for (std::thread& thread : threads)
+			thread.join();
+	}
+}
@@ -0,0 +1,295 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// cells are packed 64 to a word, row major, bit (x % 64) of word (x / 64) in row y
+#define LIFE_WORD_BITS 64
+
+enum LifeResult
+{
+	Life_Result_Failed  = 0,
+	Life_Result_Success = 1,
+};
+
+enum LifeTopology
+{
+	Life_Topology_Plane, // everything outside the grid is dead
+	Life_Topology_Torus,
+};
+
+// how pasted cells combine with the cells already under them
+enum LifeBlend
+{
+	Life_Blend_Or,
+	Life_Blend_And,
+	Life_Blend_Xor,
+	Life_Blend_Replace,
+};
+
+// bit 2 transposes first, then bit 0 mirrors x and bit 1 mirrors y, rotations turn
+// clockwise with rows running down as they do in a pattern file
+enum LifeTransform
+{
+	Life_Transform_Identity      = 0,
+	Life_Transform_FlipX         = 1,
+	Life_Transform_FlipY         = 2,
+	Life_Transform_Rotate180     = 3,
+	Life_Transform_Transpose     = 4,
+	Life_Transform_Rotate90      = 5,
+	Life_Transform_Rotate270     = 6,
+	Life_Transform_AntiTranspose = 7,
+};
+
+// bit n of birth/survive is set when a cell with n live neighbours is born/survives
+struct LifeRule
+{
+	uint16_t birth;
+	uint16_t survive;
+};
+
+#define LIFE_RULE_CONWAY LifeRule{ 1 << 3, (1 << 2) | (1 << 3) }
+
+struct LifeGrid
+{
+	uint32_t width, height;
+	uint32_t stride; // words per row
+	std::vector<uint64_t> words;
+};
+
+// counted while stepping, births and deaths compare dst against src
+struct LifeStepStats
+{
+	uint64_t population;
+	uint64_t births, deaths;
+	uint32_t x, y, width, height; // bounding box of dst, all zero when it is empty
+};
+
+struct LifeStepInfo
+{
+	LifeRule rule;
+	LifeTopology topology;
+	uint32_t threadCount; // 0 uses every hardware thread
+	uint64_t* hash;       // optional, receives hashGrid(dst) computed while stepping
+	LifeStepStats* stats; // optional, receives the statistics of dst computed while stepping
+	const uint64_t* srcPopulation; // optional, population(src) when the caller knows it, spares counting src for the statistics
+};
+
+// the state is periodic from generation on, repeating every period generations
+struct LifeCycle
+{
+	uint64_t generation;
+	uint64_t period;
+};
+
+struct LifeCycleDetector;
+
+struct LifeRandomInfo
+{
+	uint64_t seed;
+	float density;        // probability of a cell being alive, quantized to 1/256
+	uint32_t threadCount; // 0 uses every hardware thread
+	uint32_t firstRow;    // row of a larger universe the grid starts at, stripes filled separately match a whole fill
+};
+
+namespace life
+{
+	inline uint32_t popcount64(uint64_t x)
+	{
+#ifdef _MSC_VER
+		return (uint32_t)__popcnt64(x);
+#else
+		return (uint32_t)__builtin_popcountll(x);
+#endif
+	}
+
+	// bit n moves to bit 63 - n, bits are swapped within each byte and the bytes reversed
+	inline uint64_t reverseBits64(uint64_t x)
+	{
+		x = ((x >> 1) & 0x5555555555555555ull) | ((x & 0x5555555555555555ull) << 1);
+		x = ((x >> 2) & 0x3333333333333333ull) | ((x & 0x3333333333333333ull) << 2);
+		x = ((x >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((x & 0x0F0F0F0F0F0F0F0Full) << 4);
+#ifdef _MSC_VER
+		return _byteswap_uint64(x);
+#else
+		return __builtin_bswap64(x);
+#endif
+	}
+
+	// index of the lowest/highest set bit, x must not be zero
+	inline uint32_t lowestBit64(uint64_t x)
+	{
+#ifdef _MSC_VER
+		unsigned long index; _BitScanForward64(&index, x); return index;
+#else
+		return (uint32_t)__builtin_ctzll(x);
+#endif
+	}
+
+	inline uint32_t highestBit64(uint64_t x)
+	{
+#ifdef _MSC_VER
+		unsigned long index; _BitScanReverse64(&index, x); return index;
+#else
+		return 63 - (uint32_t)__builtin_clzll(x);
+#endif
+	}
+
+	// the splitmix64 finalizer, every input bit affects every output bit
+	inline uint64_t mix64(uint64_t z)
+	{
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+		return z ^ (z >> 31);
+	}
+
+	// open addressed tables with linear probing over a power of two of slots, an entry has a
+	// uint64_t key, empty(entry) tells a free slot and Entry{} is one, returns the slot holding
+	// key or the free slot ending its probe run
+	template <typename Entry, typename Empty>
+	uint32_t probeSlot(const Entry* table, uint32_t mask, uint64_t key, const Empty& empty)
+	{
+		uint32_t slot = (uint32_t)mix64(key) & mask;
+		while (!empty(table[slot]) && table[slot].key != key)
+			slot = (slot + 1) & mask;
+		return slot;
+	}
+
+	// frees slot, later entries of its probe run shift back so no lookup stops early at the hole
+	template <typename Entry, typename Empty>
+	void eraseSlot(Entry* table, uint32_t mask, uint32_t slot, const Empty& empty)
+	{
+		uint32_t hole = slot;
+		for (uint32_t next = (slot + 1) & mask; !empty(table[next]); next = (next + 1) & mask)
+		{
+			uint32_t home = (uint32_t)mix64(table[next].key) & mask;
+			if (((next - home) & mask) >= ((next - hole) & mask))
+			{
+				table[hole] = table[next];
+				hole = next;
+			}
+		}
+		table[hole] = Entry{};
+	}
+
+	// row hash combined into hashGrid: words are mixed with per position keys and folded
+	// with 32x32 bit multiplies the compiler can vectorize, then the sum is finalized once
+	inline uint64_t hashRow(const uint64_t* row, uint32_t stride, uint64_t y)
+	{
+		uint64_t acc = y * 0xD6E8FEB86659FD93ull, position = 0x94D049BB133111EBull;
+		for (uint32_t w = 0; w < stride; w++)
+		{
+			uint64_t key = row[w] ^ position;
+			acc += row[w] + (key & 0xFFFFFFFFull) * (key >> 32);
+			position += 0x9E3779B97F4A7C15ull;
+		}
+
+		return mix64(acc);
+	}
+
+	// next state of 64 cells given the bit planes s0..s3 of their neighbour counts
+	uint64_t ruleWord(uint64_t alive, uint64_t s0, uint64_t s1, uint64_t s2, uint64_t s3, const LifeRule* rule);
+
+	// the eight neighbours of 64 cells are summed into the bit planes s0..s3 with full adders,
+	// the row above and below contribute 0..3 each and the middle row 0..2, center[1] are the cells themselves
+	inline uint64_t nextWord(const uint64_t left[3], const uint64_t center[3], const uint64_t right[3], const LifeRule* rule, bool conway)
+	{
+		uint64_t u0 = left[0] ^ center[0] ^ right[0];
+		uint64_t u1 = (left[0] & center[0]) | (right[0] & (left[0] ^ center[0]));
+		uint64_t d0 = left[2] ^ center[2] ^ right[2];
+		uint64_t d1 = (left[2] & center[2]) | (right[2] & (left[2] ^ center[2]));
+		uint64_t m0 = left[1] ^ right[1];
+		uint64_t m1 = left[1] & right[1];
+
+		uint64_t s0 = u0 ^ m0 ^ d0;
+		uint64_t c0 = (u0 & m0) | (d0 & (u0 ^ m0));
+
+		uint64_t t = u1 ^ m1 ^ d1;
+		uint64_t tc = (u1 & m1) | (d1 & (u1 ^ m1));
+		uint64_t s1 = t ^ c0;
+		uint64_t k = t & c0;
+		uint64_t s2 = tc ^ k;
+		uint64_t s3 = tc & k;
+
+		uint64_t alive = center[1];
+		if (conway)
+			return s1 & ~s2 & ~s3 & (s0 | alive);
+		return ruleWord(alive, s0, s1, s2, s3, rule);
+	}
+
+	LifeResult createGrid(LifeGrid** grid, uint32_t width, uint32_t height);
+	void       destroyGrid(LifeGrid* grid);
+	void       clearGrid(LifeGrid* grid);
+	void       fillGrid(LifeGrid* grid);
+
+	bool       getCell(const LifeGrid* grid, uint32_t x, uint32_t y);
+	void       setCell(LifeGrid* grid, uint32_t x, uint32_t y, bool alive);
+	uint64_t   rowMask(const LifeGrid* grid); // valid bits of the last word in a row
+	uint64_t   population(const LifeGrid* grid);
+	uint64_t   hashGrid(const LifeGrid* grid);
+	// smallest rectangle holding every live cell, false when the grid is empty
+	bool       boundingBox(const LifeGrid* grid, uint32_t* x, uint32_t* y, uint32_t* width, uint32_t* height);
+	// sets or clears a rectangle a word at a time, the part outside grid is ignored
+	void       fillRegion(LifeGrid* grid, int32_t x, int32_t y, uint32_t width, uint32_t height, bool alive);
+	void       invertRegion(LifeGrid* grid, int32_t x, int32_t y, uint32_t width, uint32_t height);
+	// fills region with the cells of grid starting at (x, y), cells outside grid read as dead
+	void       copyRegion(const LifeGrid* grid, int32_t x, int32_t y, LifeGrid* region);
+	// blends region into grid with its first cell at (x, y), only cells under region change
+	void       pasteRegion(LifeGrid* grid, const LifeGrid* region, int32_t x, int32_t y, LifeBlend blend);
+
+	// transposes a 64 x 64 tile of cells in place, word i holding row i
+	void       transposeTile(uint64_t* tile);
+	// writes src rotated or mirrored into dst, which is resized to fit and must not be src
+	void       transformGrid(const LifeGrid* src, LifeTransform transform, LifeGrid* dst);
+	// accepts identity, flipx, flipy, rot90, rot180, rot270, transpose and antitranspose
+	LifeResult parseTransform(const char* str, LifeTransform* transform);
+
+	// advances src by one generation into dst, both grids must have the same size
+	void       step(const LifeGrid* src, LifeGrid* dst, const LifeStepInfo* stepInfo);
+	// advances grid by generations in place, depth of them per pass over memory, scratch must
+	// have the same size, depth 0 tunes one the first time a grid of this size is stepped with
+	// this thread count, the hash and statistics describe the final generation as they do for step
+	void       stepBlocked(LifeGrid* grid, LifeGrid* scratch, uint32_t generations, uint32_t depth, const LifeStepInfo* stepInfo);
+	// times depths 1, 2, 4, 8 and 16 on a sample of grid's rows and returns the fastest
+	uint32_t   tuneBlockDepth(const LifeGrid* grid, const LifeStepInfo* stepInfo);
+	// rows of a band stepBlocked keeps in cache at depth
+	uint32_t   blockRows(const LifeGrid* grid, uint32_t depth);
+
+	// remembers the state hashes of the last capacity generations
+	LifeResult createCycleDetector(LifeCycleDetector** detector, uint32_t capacity);
+	void       destroyCycleDetector(LifeCycleDetector* detector);
+	void       resetCycleDetector(LifeCycleDetector* detector);
+	// true once the hash matches an earlier generation still in the table
+	bool       recordCycle(LifeCycleDetector* detector, uint64_t generation, uint64_t hash, LifeCycle* cycle);
+	// steps needed from current to reach a state equal to the one at target
+	uint64_t   cycleSteps(const LifeCycle* cycle, uint64_t current, uint64_t target);
+
+	// accepts "B3/S23", "b3s23" and "23/3" style rule strings
+	LifeResult parseRule(const char* str, LifeRule* rule);
+	void       ruleString(const LifeRule* rule, char* str, uint32_t size);
+
+	// counter based generator, the same (seed, counter) pair always gives the same word
+	uint64_t   randomWord(uint64_t seed, uint64_t counter);
+	void       fillRandom(LifeGrid* grid, const LifeRandomInfo* randomInfo);
+
+	uint32_t   hardwareThreads();
+	// splits [0, count) into contiguous ranges and runs them on up to threadCount threads,
+	// range i of a split always runs on the same pooled worker
+	void       parallelRanges(uint32_t count, uint32_t threadCount, void (*func)(void* context, uint32_t begin, uint32_t end), void* context);
+	// pins pooled worker i to one CPU, workers in order fill one NUMA node before the next,
+	// and runs every range on a worker so the calling thread never steps rows, Linux only
+	void       setThreadPinning(bool pinned);
+
+	// takes the callable by reference rather than as a std::function, so a lambda with any
+	// number of captures is passed without allocating
+	template <typename Func>
+	void parallelFor(uint32_t count, uint32_t threadCount, const Func& func)
+	{
+		parallelRanges(count, threadCount, [](void* context, uint32_t begin, uint32_t end) { (*(const Func*)context)(begin, end); }, (void*)&func);
+	}
+}
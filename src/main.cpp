@@ -7,17 +7,27 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include <cstdio>
+#include <cstring>
+#include <cfloat>
 #include <cmath>
 #include <cstdint>
 #include <vector>
 #include <chrono>
-#include <string>
+#include <algorithm>
+#include <numeric>
 
 #include <imgui/imgui.h>
 #include <imgui/imgui_impl_glfw.h>
 #include <imgui/imgui_impl_opengl3.h>
 
 #include "ogls.h"
+#include "life.h"
+#include "history.h"
+#include "publish.h"
+#include "trace.h"
+#include "alloc.h"
+#include "planes.h"
+#include "headless.h"
 
 
 #define COLOR_FG 0.78, 0.82, 1.0
@@ -27,6 +37,10 @@
 #define CELL_SPACE_WIDTH 120
 #define CELL_SPACE_HEIGHT 120
 #define CELL_SPACE_SCALE 13.0f
+#define VIEWER_MAX_CELLS 240 /* cells per side an attached viewer draws, zooming out further is clamped */
+#define PROFILER_FRAMES 240  /* frames of phase timings the profiler keeps */
+#define TRACE_FILE "cgol-trace.json" /* where Write trace puts the recorded events */
+#define POPULATION_GENERATIONS 512 /* generations the population graph keeps */
 
 
 #define PI (22.0f/7.0f) /* 3.1415... */
@@ -51,6 +65,212 @@ public:
 	float elapsedms() { return elapsed() * 1000.0f; }
 };
 
+enum FramePhase
+{
+	Frame_Phase_Input,       // input and camera
+	Frame_Phase_Step,        // generation step, history and cycle detection
+	Frame_Phase_Cells,       // building the cell batch
+	Frame_Phase_Border,      // building the border batch
+	Frame_Phase_Upload,      // submitDrawList
+	Frame_Phase_ImGuiBuild,
+	Frame_Phase_ImGuiRender,
+	Frame_Phase_Swap,        // swap buffers and poll events
+
+	Frame_Phase_Count,
+};
+
+static const char* s_FramePhaseNames[Frame_Phase_Count] = { "input", "step", "cells", "border", "upload", "imgui build", "imgui render", "swap" };
+static const ImVec4 s_FramePhaseColors[Frame_Phase_Count] =
+{
+	{ 0.55f, 0.62f, 0.98f, 1.0f }, { 0.97f, 0.46f, 0.55f, 1.0f }, { 0.62f, 0.81f, 0.42f, 1.0f }, { 0.88f, 0.69f, 0.41f, 1.0f },
+	{ 0.73f, 0.60f, 0.97f, 1.0f }, { 0.49f, 0.81f, 0.81f, 1.0f }, { 0.96f, 0.85f, 0.55f, 1.0f }, { 0.60f, 0.60f, 0.65f, 1.0f },
+};
+
+// the frame is split into consecutive phases, each mark closes the running phase and starts
+// the next one, finished frames go into a ring of the last PROFILER_FRAMES along with the
+// allocations made during them, while tracing every phase is also recorded as a trace event
+class FrameProfiler
+{
+private:
+	Timer m_Timer;
+	float m_Last;
+	FramePhase m_Phase;
+	float m_Current[Frame_Phase_Count];
+	std::vector<float> m_Frames; // PROFILER_FRAMES rows of Frame_Phase_Count milliseconds
+	std::vector<LifeAllocationStats> m_Allocations; // made during each kept frame
+	mutable std::vector<float> m_Samples; // sorted by stats, sized once so the profiler itself never allocates
+	LifeAllocationStats m_FrameStart;
+	uint32_t m_Next, m_Count;
+	uint64_t m_TraceFrame, m_TracePhase; // 0 when the frame started with tracing off
+
+public:
+	FrameProfiler() : m_Timer{}, m_Last(0.0f), m_Phase(Frame_Phase_Input), m_Current{}, m_Frames(PROFILER_FRAMES * Frame_Phase_Count, 0.0f),
+		m_Allocations(PROFILER_FRAMES, LifeAllocationStats{}), m_Samples(PROFILER_FRAMES, 0.0f), m_FrameStart{}, m_Next(0), m_Count(0), m_TraceFrame(0), m_TracePhase(0) {}
+
+	void beginFrame(FramePhase phase)
+	{
+		std::fill(m_Current, m_Current + Frame_Phase_Count, 0.0f);
+		m_Timer.reset();
+		m_Timer.play();
+		m_Last = 0.0f;
+		m_Phase = phase;
+		m_TraceFrame = m_TracePhase = life::traceEnabled.load(std::memory_order_relaxed) ? life::traceClock() : 0;
+		life::allocationStats(&m_FrameStart);
+	}
+	void mark(FramePhase phase)
+	{
+		float now = m_Timer.elapsedms();
+		m_Current[m_Phase] += now - m_Last;
+		m_Last = now;
+
+		if (m_TracePhase)
+		{
+			uint64_t traceNow = life::traceClock();
+			life::recordTrace("frame", s_FramePhaseNames[m_Phase], m_TracePhase, traceNow);
+			m_TracePhase = traceNow;
+		}
+		m_Phase = phase;
+	}
+	void endFrame()
+	{
+		mark(m_Phase);
+		if (m_TraceFrame)
+			life::recordTrace("frame", "frame", m_TraceFrame, m_TracePhase);
+		std::copy(m_Current, m_Current + Frame_Phase_Count, m_Frames.begin() + (size_t)m_Next * Frame_Phase_Count);
+
+		LifeAllocationStats now;
+		life::allocationStats(&now);
+		m_Allocations[m_Next] = { now.count - m_FrameStart.count, now.bytes - m_FrameStart.bytes };
+		m_Next = (m_Next + 1) % PROFILER_FRAMES;
+		m_Count = std::min<uint32_t>(m_Count + 1, PROFILER_FRAMES);
+	}
+
+	uint32_t count() const { return m_Count; }
+	// i = 0 is the oldest frame kept
+	const float* frame(uint32_t i) const { return m_Frames.data() + (size_t)((m_Next + PROFILER_FRAMES - m_Count + i) % PROFILER_FRAMES) * Frame_Phase_Count; }
+	const LifeAllocationStats* allocations(uint32_t i) const { return &m_Allocations[(m_Next + PROFILER_FRAMES - m_Count + i) % PROFILER_FRAMES]; }
+
+	void stats(FramePhase phase, float* min, float* avg, float* p99) const
+	{
+		float* samples = m_Samples.data();
+		for (uint32_t i = 0; i < m_Count; i++)
+			samples[i] = frame(i)[phase];
+		std::sort(samples, samples + m_Count);
+
+		*min = m_Count == 0 ? 0.0f : samples[0];
+		*avg = m_Count == 0 ? 0.0f : std::accumulate(samples, samples + m_Count, 0.0f) / m_Count;
+		*p99 = m_Count == 0 ? 0.0f : samples[std::min<size_t>(m_Count - 1, m_Count * 99 / 100)];
+	}
+};
+
+// population of the last POPULATION_GENERATIONS generations stepped, kept in a ring ImGui plots from the oldest entry
+class PopulationGraph
+{
+private:
+	std::vector<float> m_Population;
+	uint32_t m_Next, m_Count;
+
+public:
+	PopulationGraph() : m_Population(POPULATION_GENERATIONS, 0.0f), m_Next(0), m_Count(0) {}
+
+	void push(uint64_t population)
+	{
+		m_Population[m_Next] = (float)population;
+		m_Next = (m_Next + 1) % POPULATION_GENERATIONS;
+		m_Count = std::min<uint32_t>(m_Count + 1, POPULATION_GENERATIONS);
+	}
+	void reset() { m_Next = m_Count = 0; }
+
+	uint32_t count() const { return m_Count; }
+	const float* values() const { return m_Population.data(); }
+	// index of the oldest value once the ring has wrapped
+	uint32_t offset() const { return m_Count == POPULATION_GENERATIONS ? m_Next : 0; }
+};
+
+// the statistics come from the step kernel, drawing them never walks the grid
+void drawPopulation(const PopulationGraph* graph, const LifeStepStats* stats)
+{
+	char overlay[64];
+	snprintf(overlay, sizeof(overlay), "population %llu", (unsigned long long)stats->population);
+	ImVec2 size(std::max(ImGui::GetContentRegionAvail().x, 100.0f), 80.0f);
+	ImGui::PlotLines("##population", graph->values(), graph->count(), graph->offset(), overlay, 0.0f, FLT_MAX, size);
+
+	ImGui::Text("births %llu, deaths %llu", (unsigned long long)stats->births, (unsigned long long)stats->deaths);
+	if (stats->population)
+		ImGui::Text("bounding box %u x %u at (%u, %u)", stats->width, stats->height, stats->x, stats->y);
+	else
+		ImGui::Text("bounding box: empty");
+}
+
+// stacked bars of every kept frame, the tallest frame fills the height
+void drawProfiler(const FrameProfiler* profiler)
+{
+	float tallest = 1.0f;
+	for (uint32_t i = 0; i < profiler->count(); i++)
+		tallest = std::max(tallest, std::accumulate(profiler->frame(i), profiler->frame(i) + Frame_Phase_Count, 0.0f));
+
+	ImVec2 size(std::max(ImGui::GetContentRegionAvail().x, 100.0f), 100.0f);
+	ImVec2 origin = ImGui::GetCursorScreenPos();
+	ImGui::InvisibleButton("frame timeline", size);
+
+	ImDrawList* drawList = ImGui::GetWindowDrawList();
+	drawList->AddRectFilled(origin, ImVec2(origin.x + size.x, origin.y + size.y), ImGui::GetColorU32(ImVec4(COLOR_FG2, 1.0f)));
+
+	float barWidth = size.x / PROFILER_FRAMES;
+	for (uint32_t i = 0; i < profiler->count(); i++)
+	{
+		float x = origin.x + (PROFILER_FRAMES - profiler->count() + i) * barWidth;
+		float bottom = origin.y + size.y;
+		for (uint32_t phase = 0; phase < Frame_Phase_Count; phase++)
+		{
+			float height = profiler->frame(i)[phase] / tallest * size.y;
+			drawList->AddRectFilled(ImVec2(x, bottom - height), ImVec2(x + std::max(barWidth - 1.0f, 1.0f), bottom), ImGui::GetColorU32(s_FramePhaseColors[phase]));
+			bottom -= height;
+		}
+	}
+	ImGui::Text("tallest frame %.2f ms", tallest);
+
+	// a steady frame should show zeros here, anything else is a regression
+	uint64_t allocatingFrames = 0, mostAllocations = 0, mostBytes = 0;
+	for (uint32_t i = 0; i < profiler->count(); i++)
+	{
+		const LifeAllocationStats* allocations = profiler->allocations(i);
+		allocatingFrames += allocations->count > 0;
+		mostAllocations = std::max(mostAllocations, allocations->count);
+		mostBytes = std::max(mostBytes, allocations->bytes);
+	}
+	const LifeAllocationStats* last = profiler->count() ? profiler->allocations(profiler->count() - 1) : nullptr;
+	ImGui::Text("allocations last frame %llu (%llu bytes), most %llu (%llu bytes), %llu of %u frames allocated",
+		(unsigned long long)(last ? last->count : 0), (unsigned long long)(last ? last->bytes : 0), (unsigned long long)mostAllocations,
+		(unsigned long long)mostBytes, (unsigned long long)allocatingFrames, profiler->count());
+
+	if (ImGui::BeginTable("phases", 4))
+	{
+		ImGui::TableSetupColumn("phase");
+		ImGui::TableSetupColumn("min ms");
+		ImGui::TableSetupColumn("avg ms");
+		ImGui::TableSetupColumn("p99 ms");
+		ImGui::TableHeadersRow();
+
+		for (uint32_t phase = 0; phase < Frame_Phase_Count; phase++)
+		{
+			float min, avg, p99;
+			profiler->stats((FramePhase)phase, &min, &avg, &p99);
+
+			ImGui::TableNextRow();
+			ImGui::TableNextColumn();
+			ImGui::TextColored(s_FramePhaseColors[phase], "%s", s_FramePhaseNames[phase]);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", min);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", avg);
+			ImGui::TableNextColumn();
+			ImGui::Text("%.3f", p99);
+		}
+		ImGui::EndTable();
+	}
+}
+
 struct Vertex
 {
 	OglsVec2 pos;
@@ -67,52 +287,62 @@ struct DrawCommand
 	uint32_t indexCount;
 };
 
+// a fixed arena sized once to the gpu buffers, filling it every frame never allocates and
+// commands that would not fit the buffers are dropped
 class DrawList
 {
 	std::vector<float> m_VerticesRaw;
 	std::vector<uint32_t> m_Indices;
-	std::vector<DrawCommand> m_DrawCommands;
-	size_t m_Vertices;
+	size_t m_FloatCount, m_IndexCount, m_Vertices, m_Commands;
 
 public:
-	void push_back(const DrawCommand& drawCmd)
+	DrawList() : m_FloatCount(0), m_IndexCount(0), m_Vertices(0), m_Commands(0) {}
+
+	void reserve(size_t floatCount, size_t indexCount)
 	{
-		m_DrawCommands.push_back(drawCmd);
-		
-		m_Indices.insert(m_Indices.end(), drawCmd.pIndices, drawCmd.pIndices + drawCmd.indexCount);
-		for (uint32_t i = m_Indices.size() - drawCmd.indexCount; i < m_Indices.size(); i++)
-		{
-			m_Indices[i] += m_Vertices;
-		}
+		m_VerticesRaw.resize(floatCount);
+		m_Indices.resize(indexCount);
+		clear();
+	}
+	bool push_back(const DrawCommand& drawCmd)
+	{
+		size_t floats = drawCmd.vertexCount * drawCmd.vertexAttributeCount;
+		if (m_FloatCount + floats > m_VerticesRaw.size() || m_IndexCount + drawCmd.indexCount > m_Indices.size())
+			return false;
 
-		m_VerticesRaw.insert(m_VerticesRaw.end(), drawCmd.pVertices, drawCmd.pVertices + drawCmd.vertexCount * drawCmd.vertexAttributeCount);
+		for (uint32_t i = 0; i < drawCmd.indexCount; i++)
+			m_Indices[m_IndexCount + i] = drawCmd.pIndices[i] + (uint32_t)m_Vertices;
+		std::copy(drawCmd.pVertices, drawCmd.pVertices + floats, m_VerticesRaw.begin() + m_FloatCount);
+
+		m_FloatCount += floats;
+		m_IndexCount += drawCmd.indexCount;
 		m_Vertices += drawCmd.vertexCount;
+		m_Commands++;
+		return true;
 	}
 	void clear()
 	{
-		m_DrawCommands.clear();
-		m_VerticesRaw.clear();
-		m_Indices.clear();
+		m_FloatCount = 0;
+		m_IndexCount = 0;
 		m_Vertices = 0;
+		m_Commands = 0;
 	}
 	bool empty()
 	{
-		return m_VerticesRaw.empty() && m_Indices.empty() && m_DrawCommands.empty();
+		return m_Commands == 0;
 	}
 
 	float* vertices()                         { return m_VerticesRaw.data(); }
 	const float* vertices() const             { return m_VerticesRaw.data(); }
-	size_t vertex_count()                     { return m_VerticesRaw.size(); }
-	size_t vertex_size()                      { return m_VerticesRaw.size() * sizeof(float); }
+	size_t vertex_count()                     { return m_FloatCount; }
+	size_t vertex_size()                      { return m_FloatCount * sizeof(float); }
 
 	uint32_t* indices()                       { return m_Indices.data(); }
 	const uint32_t* indices() const           { return m_Indices.data(); }
-	size_t index_count()                      { return m_Indices.size(); }
-	size_t index_size()                       { return m_Indices.size() * sizeof(uint32_t); }
+	size_t index_count()                      { return m_IndexCount; }
+	size_t index_size()                       { return m_IndexCount * sizeof(uint32_t); }
 
-	DrawCommand* drawcmds()                { return m_DrawCommands.data(); }
-	const DrawCommand* drawcmds() const    { return m_DrawCommands.data(); }
-	size_t drawcmd_count()                    { return m_DrawCommands.size(); }
+	size_t drawcmd_count()                    { return m_Commands; }
 };
 
 struct BatchGroup
@@ -147,12 +377,33 @@ in vec3 fragColor;
 
 out vec4 outColor;
 
+// a negative blue channel marks a palette cell, red is its position along the palette
+uniform vec3 u_Palette[4];
+
 void main()
 {
-    outColor = vec4(fragColor, 1.0f);
+    vec3 color = fragColor;
+    if (fragColor.b < 0.0)
+    {
+        float t = clamp(fragColor.r, 0.0, 1.0) * 3.0;
+        int i = min(int(t), 2);
+        color = mix(u_Palette[i], u_Palette[i + 1], t - float(i));
+    }
+    outColor = vec4(color, 1.0f);
 }
 )";
 
+enum CellView
+{
+	Cell_View_State,
+	Cell_View_Age,      // how long each live cell has been alive
+	Cell_View_Activity, // births and deaths, decaying over time
+};
+
+// four colors the shader interpolates between, from the lowest value to the highest
+static const float s_AgePalette[4 * 3] = { 0.55f, 0.62f, 0.98f, 0.49f, 0.81f, 0.81f, 0.96f, 0.85f, 0.55f, 0.97f, 0.46f, 0.55f };
+static const float s_ActivityPalette[4 * 3] = { 0.098f, 0.094f, 0.156f, 0.45f, 0.30f, 0.70f, 0.97f, 0.46f, 0.55f, 1.0f, 0.95f, 0.80f };
+
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
     glViewport(0, 0, width, height);
@@ -291,14 +542,187 @@ void drawRectImmediate(BatchGroup* batch, OglsVec2 pos, OglsVec2 size, OglsVec3
 	ogls::bindVertexArray(0);
 }
 
-struct Cell
+void drawOutlineImmediate(BatchGroup* batch, OglsVec2 pos, OglsVec2 size, OglsVec3 color)
+{
+	const float thickness = 1.5f;
+	drawRectImmediate(batch, pos, {size.x, thickness}, color);
+	drawRectImmediate(batch, {pos.x, pos.y + size.y - thickness}, {size.x, thickness}, color);
+	drawRectImmediate(batch, pos, {thickness, size.y}, color);
+	drawRectImmediate(batch, {pos.x + size.x - thickness, pos.y}, {thickness, size.y}, color);
+}
+
+struct PresetCell
 {
 	int x, y;
-	bool alive;
 };
 
+static const PresetCell s_PresetBeacon[] = { {0, 0}, {1, 0}, {0, -1}, {3, -2}, {3, -3}, {2, -3} };
+static const PresetCell s_PresetGlider[] = { {0, 0}, {1, 0}, {2, 0}, {1, 2}, {2, 1} };
+static const PresetCell s_PresetRPentomino[] = { {0, 0}, {0, 1}, {-1, 0}, {0, -1}, {1, -1} };
+
+static const PresetCell s_PresetGosperGliderGun[] =
+{
+	{-1, -1}, {-2, 0}, {-2, -1}, {-2, -2}, {-3, 1}, {-3, -3}, {-4, -1}, {-5, 2}, {-5, -4}, {-6, 2}, {-6, -4},
+	{-7, 1}, {-7, -3}, {-8, 0}, {-8, -1}, {-8, -2}, {-17, 0}, {-17, -1}, {-18, 0}, {-18, -1},
+	{2, 0}, {2, 1}, {2, 2}, {3, 0}, {3, 1}, {3, 2}, {4, -1}, {4, 3}, {6, 3}, {6, 4}, {6, -1}, {6, -2},
+	{16, 1}, {16, 2}, {17, 1}, {17, 2},
+};
+
+static const PresetCell s_PresetPentaDecathlon[] =
+{
+	{0, 0}, {-1, 0}, {-2, 1}, {-2, -1}, {-3, 0}, {-4, 0}, {1, 0}, {2, 0}, {3, 1}, {3, -1}, {4, 0}, {5, 0},
+};
+
+// cells on the border of the cell space always die, the grid only holds the cells inside it
+bool getSpaceCell(const LifeGrid* grid, int x, int y)
+{
+	if (x < 1 || y < 1 || x > CELL_SPACE_WIDTH - 2 || y > CELL_SPACE_HEIGHT - 2) return false;
+	return life::getCell(grid, x - 1, y - 1);
+}
+
+void setSpaceCell(LifeGrid* grid, int x, int y, bool alive)
+{
+	if (x < 1 || y < 1 || x > CELL_SPACE_WIDTH - 2 || y > CELL_SPACE_HEIGHT - 2) return;
+	life::setCell(grid, x - 1, y - 1, alive);
+}
+
+void loadPreset(LifeGrid* grid, const PresetCell* cells, uint32_t count, int x, int y)
+{
+	life::clearGrid(grid);
+	for (uint32_t i = 0; i < count; i++)
+		setSpaceCell(grid, x + cells[i].x, y + cells[i].y, true);
+}
+
+void stepSpace(LifeGrid** grid, LifeGrid** nextGrid, uint64_t* hash, LifeStepStats* stats)
+{
+	LifeStepInfo stepInfo{};
+	stepInfo.rule = LIFE_RULE_CONWAY;
+	stepInfo.topology = Life_Topology_Plane;
+	stepInfo.threadCount = 1;
+	stepInfo.hash = hash;
+	stepInfo.stats = stats;
+
+	life::step(*grid, *nextGrid, &stepInfo);
+	std::swap(*grid, *nextGrid);
+}
+
+// renders the universe a headless run publishes, only the words under the viewport are read
+void runViewer(GLFWwindow* window, BatchGroup* batch, OglsShader* shader, LifeViewer* viewer)
+{
+	uint32_t universeWidth, universeHeight;
+	life::viewerSize(viewer, &universeWidth, &universeHeight);
+
+	float camx = universeWidth * CELL_SPACE_SCALE * 0.5f, camy = universeHeight * CELL_SPACE_SCALE * 0.5f;
+	float scale = 1.0f;
+	uint64_t generation = 0;
+	uint32_t tornFrames = 0;
+
+	LifeGrid* visible = nullptr;
+
+	float oldTime = 0.0f;
+	Timer deltaTime{};
+	deltaTime.start();
+
+	while (!glfwWindowShouldClose(window))
+	{
+		float timeNow = deltaTime.elapsed();
+		float dt = timeNow - oldTime;
+		oldTime = timeNow;
+
+		glClearColor(COLOR_BG, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		int width, height;
+		glfwGetWindowSize(window, &width, &height);
+
+		cameraMovement(window, &camx, &camy, dt);
+		cameraScale(window, &scale, dt);
+
+		float maxScale = VIEWER_MAX_CELLS * CELL_SPACE_SCALE / std::max(std::max(width, height), 1);
+		if (scale > maxScale) scale = maxScale;
+		if (camx > universeWidth * CELL_SPACE_SCALE) camx = universeWidth * CELL_SPACE_SCALE;
+		if (camx < 0) camx = 0;
+		if (camy > universeHeight * CELL_SPACE_SCALE) camy = universeHeight * CELL_SPACE_SCALE;
+		if (camy < 0) camy = 0;
+
+		glm::mat4 proj = glm::ortho(-static_cast<float>(width) * 0.5f * scale, static_cast<float>(width) * 0.5f * scale, -static_cast<float>(height) * 0.5f * scale, static_cast<float>(height) * 0.5f * scale);
+		glm::mat4 view = glm::inverse(glm::translate(glm::mat4(1.0f), glm::vec3(camx, camy, 0.0f)));
+		glm::mat4 camera = proj * view;
+
+		ogls::bindShader(shader);
+		glUniformMatrix4fv(glGetUniformLocation(ogls::getShaderId(shader), "u_Camera"), 1, GL_FALSE, glm::value_ptr(camera));
+
+		clearDrawList(batch);
+
+		// row 0 of the universe is drawn at the top like a pattern file
+		float left = camx - width * 0.5f * scale, top = camy + height * 0.5f * scale;
+		int32_t cellx = (int32_t)std::floor(left / CELL_SPACE_SCALE);
+		int32_t celly = (int32_t)universeHeight - 1 - (int32_t)std::floor(top / CELL_SPACE_SCALE);
+		uint32_t cellsx = std::min<uint32_t>((uint32_t)std::ceil(width * scale / CELL_SPACE_SCALE) + 2, VIEWER_MAX_CELLS);
+		uint32_t cellsy = std::min<uint32_t>((uint32_t)std::ceil(height * scale / CELL_SPACE_SCALE) + 2, VIEWER_MAX_CELLS);
+
+		if (!visible || visible->width != cellsx || visible->height != cellsy)
+		{
+			if (visible) life::destroyGrid(visible);
+			life::createGrid(&visible, cellsx, cellsy);
+		}
+
+		// a frame torn by the producer is skipped and the previous one drawn again
+		if (life::readViewport(viewer, cellx, celly, visible, &generation) == Life_Result_Failed)
+			tornFrames++;
+
+		drawRect(batch, {0.0f, 0.0f}, {universeWidth * CELL_SPACE_SCALE, universeHeight * CELL_SPACE_SCALE}, {COLOR_FG2});
+		for (uint32_t j = 0; j < cellsy; j++)
+		{
+			for (uint32_t i = 0; i < cellsx; i++)
+			{
+				if (life::getCell(visible, i, j))
+					drawRect(batch, {(cellx + (int32_t)i) * CELL_SPACE_SCALE, ((int32_t)universeHeight - 1 - celly - (int32_t)j) * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {COLOR_FG});
+			}
+		}
+
+		submitDrawList(batch);
+
+		ImGui_ImplOpenGL3_NewFrame();
+		ImGui_ImplGlfw_NewFrame();
+		ImGui::NewFrame();
+
+		ImGui::Begin("Attached");
+		ImGui::Text("- Use (wasd) to move the camera around");
+		ImGui::Text("- Press (-) and (+) to zoom in and out");
+		ImGui::Text("Universe: %u x %u", universeWidth, universeHeight);
+		ImGui::Text("Generation: %llu", (unsigned long long)generation);
+		ImGui::Text("Viewport: %u x %u cells at (%d, %d)", cellsx, cellsy, cellx, celly);
+		ImGui::Text("Torn frames skipped: %u", tornFrames);
+		if (!life::viewerLive(viewer))
+			ImGui::TextColored(ImVec4(COLOR_RED, 1), "the simulation has exited, showing its last state");
+		ImGui::End();
+
+		ImGui::Render();
+		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+
+		glfwSwapBuffers(window);
+		glfwPollEvents();
+	}
+
+	if (visible) life::destroyGrid(visible);
+}
+
 int main(int argv, char** argc)
 {
+	// --attach <name> opens a window on a headless run publishing to that segment
+	LifeViewer* viewer = nullptr;
+	if (argv > 1 && strcmp(argc[1], "--attach") == 0)
+	{
+		if (argv < 3 || life::attachViewer(&viewer, argc[2]) == Life_Result_Failed)
+		{
+			printf("usage: cgol --attach <name>, where name is the --publish segment of a running simulation\n");
+			return 1;
+		}
+	}
+	else if (headless::requested(argv, argc))
+		return headless::run(argv, argc);
+
 	if (!glfwInit())
 	{
 		printf("failed to initialize glfw\n");
@@ -328,6 +752,7 @@ int main(int argv, char** argc)
 
 	// Setup Dear ImGui context
 	IMGUI_CHECKVERSION();
+	ImGui::SetAllocatorFunctions(life::countedMalloc, life::countedFree);
 	ImGui::CreateContext();
 	ImGuiIO& io = ImGui::GetIO();
 	io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;     // Enable Keyboard Controls
@@ -372,42 +797,38 @@ int main(int argv, char** argc)
 
 	// setup batch groups
 	BatchGroup batch{};
+	batch.list.reserve((size_t)s_MaxVertices * sizeof(Vertex) / sizeof(float), s_MaxIndices);
 	batch.vertexBuffer = vertexBuffer;
 	batch.indexBuffer = indexBuffer;
 	batch.vertexArray = vertexArray;
 
+	if (viewer)
+	{
+		runViewer(window, &batch, shader, viewer);
+		life::detachViewer(viewer);
 
-	std::vector<std::vector<Cell>> spaces(CELL_SPACE_WIDTH);
-	std::vector<std::vector<bool>> aliveSpaces(CELL_SPACE_WIDTH);
+		ImGui_ImplOpenGL3_Shutdown();
+		ImGui_ImplGlfw_Shutdown();
+		ImGui::DestroyContext();
 
-	for (uint32_t i = 0; i < spaces.size(); i++)
-	{
-		spaces[i].resize(CELL_SPACE_HEIGHT);
-		aliveSpaces[i].resize(CELL_SPACE_HEIGHT);
+		ogls::destroyShader(shader);
+		ogls::destroyVertexArray(vertexArray);
+		ogls::destroyIndexBuffer(indexBuffer);
+		ogls::destroyVertexBuffer(vertexBuffer);
 
-		for (uint32_t j = 0; j < spaces[i].size(); j++)
-		{
-			spaces[i][j].x = i;
-			spaces[i][j].y = j;
-			spaces[i][j].alive = false;
-			aliveSpaces[i][j] = false;
-		}
+		glfwTerminate();
+		return 0;
 	}
 
+	LifeGrid* grid;
+	LifeGrid* nextGrid;
+	life::createGrid(&grid, CELL_SPACE_WIDTH - 2, CELL_SPACE_HEIGHT - 2);
+	life::createGrid(&nextGrid, CELL_SPACE_WIDTH - 2, CELL_SPACE_HEIGHT - 2);
+
 	int x = CELL_SPACE_WIDTH / 2;
 	int y = CELL_SPACE_HEIGHT / 2;
 
-	spaces[x + 0][y + 0].alive = true;
-	spaces[x + 0][y + 1].alive = true;
-	spaces[x - 1][y + 0].alive = true;
-	spaces[x + 0][y - 1].alive = true;
-	spaces[x + 1][y - 1].alive = true;
-
-	aliveSpaces[x + 0][y + 0] = true;
-	aliveSpaces[x + 0][y + 1] = true;
-	aliveSpaces[x - 1][y + 0] = true;
-	aliveSpaces[x + 0][y - 1] = true;
-	aliveSpaces[x + 1][y - 1] = true;
+	loadPreset(grid, s_PresetRPentomino, ARRAY_LEN(s_PresetRPentomino), x, y);
 
 	float camx = CELL_SPACE_WIDTH * CELL_SPACE_SCALE * 0.5f, camy = CELL_SPACE_HEIGHT * CELL_SPACE_SCALE * 0.5f;
 	float scale = 1.0f;
@@ -415,10 +836,16 @@ int main(int argv, char** argc)
 	uint32_t generation = 0;
 
 	bool pause = false, iterate = false;
-	std::string pauseName = "pause";
+	const char* pauseName = "pause";
 
 	int editx = CELL_SPACE_WIDTH / 2, edity = CELL_SPACE_HEIGHT / 2;
 
+	// the selection spans the anchor and the cursor, the clipboard keeps the last copy between frames
+	int anchorx = 0, anchory = 0;
+	bool selecting = false;
+	LifeGrid* clipboard = nullptr;
+	int pasteBlend = Life_Blend_Or;
+
 	Timer timer{};
 	timer.start();
 
@@ -432,17 +859,43 @@ int main(int argv, char** argc)
 
 	glViewport(0, 0, 1280, 800);
 
-    srand((unsigned)time(0));
-	int distribution = 2;
-	int concentration = 33;
-	int concRadius = 6;
+	uint64_t seed = 1;
+	int density = 33;
+
+	LifeCycleDetector* cycleDetector;
+	life::createCycleDetector(&cycleDetector, 4096);
+	LifeCycle cycle{};
+	uint64_t gridHash = 0;
+	uint32_t skipTarget = 0;
+	bool gridChanged = true, cycleFound = false, pauseOnCycle = false;
+
+	// every generation stepped or edited is recorded so the timeline can move back to it
+	LifeHistoryCreateInfo historyCreateInfo{};
+	historyCreateInfo.width = CELL_SPACE_WIDTH - 2;
+	historyCreateInfo.height = CELL_SPACE_HEIGHT - 2;
+	historyCreateInfo.keyframeInterval = 256;
+	historyCreateInfo.memoryBudget = 64ull << 20;
+
+	LifeHistory* history;
+	life::createHistory(&history, &historyCreateInfo);
+	bool timelineMoved = false;
+
 
+	FrameProfiler profiler{};
+	PopulationGraph populationGraph{};
+	LifeStepStats stepStats{};
+
+	// the planes only exist while a heatmap is shown, stepping never pays for them otherwise
+	LifeCellPlanes* planes = nullptr;
+	int cellView = Cell_View_State;
 
 	printf("Conway's game of life simulation in OpenGL and C++\n");
 	printf("Note: Press the \'c\' key to open the settings\n");
 
     while (!glfwWindowShouldClose(window))
     {
+		profiler.beginFrame(Frame_Phase_Input);
+
 		float timeNow = deltaTime.elapsed();
 		float dt = timeNow - oldTime;
 		oldTime = timeNow;
@@ -469,10 +922,12 @@ int main(int argv, char** argc)
 
 		ogls::bindShader(shader);
 		glUniformMatrix4fv(glGetUniformLocation(ogls::getShaderId(shader), "u_Camera"), 1, GL_FALSE, glm::value_ptr(camera));
+		glUniform3fv(glGetUniformLocation(ogls::getShaderId(shader), "u_Palette"), 4, cellView == Cell_View_Age ? s_AgePalette : s_ActivityPalette);
 
 
 		clearDrawList(&batch);
 
+		profiler.mark(Frame_Phase_Step);
 		bool calculate = false;
 		if (timeStep.elapsed() >= timeInt)
 		{
@@ -480,76 +935,107 @@ int main(int argv, char** argc)
 			timeStep.reset();
 		}
 
+		// the cycle history only holds generations stepped from the current state
+		if (gridChanged || timelineMoved)
+		{
+			// an edit replaces the recorded generation and drops the ones after it
+			if (gridChanged)
+				life::recordHistory(history, generation, grid);
+
+			gridHash = life::hashGrid(grid);
+			life::resetCycleDetector(cycleDetector);
+
+			// edits are not steps, only the population and bounding box are refreshed
+			stepStats = LifeStepStats{};
+			stepStats.population = life::population(grid);
+			life::boundingBox(grid, &stepStats.x, &stepStats.y, &stepStats.width, &stepStats.height);
+			life::recordCycle(cycleDetector, generation, gridHash, &cycle);
+			if (planes) life::syncCellPlanes(planes, grid);
+			gridChanged = false;
+			timelineMoved = false;
+			cycleFound = false;
+		}
+
+		// calculate cell generation
 		if ((!pause && calculate) || iterate)
+		{
+			stepSpace(&grid, &nextGrid, &gridHash, &stepStats);
 			generation++;
+			life::recordHistory(history, generation, grid);
+			populationGraph.push(stepStats.population);
+			if (planes) life::updateCellPlanes(planes, nextGrid, grid, 1);
 
+			if (!cycleFound && life::recordCycle(cycleDetector, generation, gridHash, &cycle))
+			{
+				cycleFound = true;
+				printf("period %llu reached at generation %llu\n", (unsigned long long)cycle.period, (unsigned long long)cycle.generation);
 
-		// calculate and draw cells
-		for (uint32_t i = 1; i < spaces.size() - 1; i++)
+				if (pauseOnCycle && !pause)
+				{
+					pause = true;
+					pauseName = "Play";
+					timer.pause();
+				}
+			}
+		}
+
+		// draw cells
+		profiler.mark(Frame_Phase_Cells);
+		if (planes)
 		{
-			for (uint32_t j = 1; j < spaces[i].size() - 1; j++)
+			const uint8_t* ages;
+			const uint8_t* activity;
+			uint32_t rowBytes;
+			life::cellPlanes(planes, &ages, &activity, &rowBytes);
+
+			// palette cells carry their byte in the red channel
+			for (uint32_t i = 1; i < CELL_SPACE_WIDTH - 1; i++)
 			{
-				Cell& cell = spaces[i][j];
-
-				if ((!pause && calculate) || iterate)
-				{
-					// calculate cell generation
-					int neighbors = 0;
-					if (aliveSpaces[i-1][j]) neighbors++; // left
-					if (aliveSpaces[i+1][j]) neighbors++; // right
-					if (aliveSpaces[i][j-1]) neighbors++; // bottom
-					if (aliveSpaces[i][j+1]) neighbors++; // top
-					if (aliveSpaces[i-1][j-1]) neighbors++; // botom left
-					if (aliveSpaces[i-1][j+1]) neighbors++; // top left
-					if (aliveSpaces[i+1][j-1]) neighbors++; // bottom right
-					if (aliveSpaces[i+1][j+1]) neighbors++; // top right
-
-					if (cell.alive && neighbors < 2) cell.alive = false;
-					else if (cell.alive && neighbors > 3) cell.alive = false;
-					else if (cell.alive && (neighbors == 2 || neighbors == 3)) cell.alive = true;
-					else if (!cell.alive && neighbors == 3) cell.alive = true;
-				}
-
-				// draw cells
-				if (cell.alive)
-					drawRect(&batch, {cell.x * CELL_SPACE_SCALE, cell.y * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {COLOR_FG});
-				else
-					drawRect(&batch, {cell.x * CELL_SPACE_SCALE, cell.y * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {COLOR_FG2});
+				for (uint32_t j = 1; j < CELL_SPACE_HEIGHT - 1; j++)
+				{
+					size_t index = (size_t)(j - 1) * rowBytes + (i - 1);
+					if (cellView == Cell_View_Activity)
+						drawRect(&batch, {i * CELL_SPACE_SCALE, j * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {activity[index] / 255.0f, 0.0f, -1.0f});
+					else if (ages[index])
+						drawRect(&batch, {i * CELL_SPACE_SCALE, j * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {ages[index] / 255.0f, 0.0f, -1.0f});
+					else
+						drawRect(&batch, {i * CELL_SPACE_SCALE, j * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {COLOR_FG2});
+				}
 			}
 		}
-
-		for (uint32_t i = 1; i < spaces.size() - 1; i++)
+		else
 		{
-			for (uint32_t j = 1; j < spaces[i].size() - 1; j++)
+			for (uint32_t i = 1; i < CELL_SPACE_WIDTH - 1; i++)
 			{
-				aliveSpaces[i][j] = spaces[i][j].alive;
+				for (uint32_t j = 1; j < CELL_SPACE_HEIGHT - 1; j++)
+				{
+					if (getSpaceCell(grid, i, j))
+						drawRect(&batch, {i * CELL_SPACE_SCALE, j * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {COLOR_FG});
+					else
+						drawRect(&batch, {i * CELL_SPACE_SCALE, j * CELL_SPACE_SCALE}, {10.0f, 10.0f}, {COLOR_FG2});
+				}
 			}
 		}
 
-		// check for cells on border
-		for (uint32_t i = 0; i < spaces.size(); i++)
+		// draw the border, cells on it always die
+		profiler.mark(Frame_Phase_Border);
+		for (uint32_t i = 0; i < CELL_SPACE_WIDTH; i++)
 		{
-			Cell& cell = spaces[i][0];
-			cell.alive = false;
-			drawRect(&batch, {cell.x * CELL_SPACE_SCALE + 3.0f, cell.y * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
-			Cell cell2 = spaces[i].back();
-			cell2.alive = false;
-			drawRect(&batch, {cell2.x * CELL_SPACE_SCALE + 3.0f, cell2.y * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
+			drawRect(&batch, {i * CELL_SPACE_SCALE + 3.0f, 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
+			drawRect(&batch, {i * CELL_SPACE_SCALE + 3.0f, (CELL_SPACE_HEIGHT - 1) * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
 		}
-		for (uint32_t i = 0; i < spaces[0].size(); i++)
+		for (uint32_t i = 0; i < CELL_SPACE_HEIGHT; i++)
 		{
-			Cell& cell = spaces[0][i];
-			cell.alive = false;
-			drawRect(&batch, {cell.x * CELL_SPACE_SCALE + 3.0f, cell.y * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
-			Cell cell2 = spaces.back()[i];
-			cell2.alive = false;
-			drawRect(&batch, {cell2.x * CELL_SPACE_SCALE + 3.0f, cell2.y * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
+			drawRect(&batch, {3.0f, i * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
+			drawRect(&batch, {(CELL_SPACE_WIDTH - 1) * CELL_SPACE_SCALE + 3.0f, i * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
 		}
 
 		// draw the cells
+		profiler.mark(Frame_Phase_Upload);
 		submitDrawList(&batch);
 
 		// imgui
+		profiler.mark(Frame_Phase_ImGuiBuild);
 		int key = glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS;
 		if (key == GLFW_PRESS && !pressOnce)
 		{
@@ -577,7 +1063,7 @@ int main(int argv, char** argc)
 			ImGui::Text("- Cells will die when on the border (squares marked red)");
 			ImGui::NewLine();
 
-			if (ImGui::Button(pauseName.c_str()))
+			if (ImGui::Button(pauseName))
 			{
 				if (pause)
 				{
@@ -601,14 +1087,8 @@ int main(int argv, char** argc)
 			ImGui::SameLine();
 			if (ImGui::Button("Clear"))
 			{
-				for (uint32_t i = 0; i < spaces.size(); i++)
-				{
-					for (uint32_t j = 0; j < spaces[i].size(); j++)
-					{
-						spaces[i][j].alive = false;
-						aliveSpaces[i][j] = false;
-					}
-				}
+				life::clearGrid(grid);
+				gridChanged = true;
 			}
 
 			ImGui::Spacing();
@@ -618,6 +1098,7 @@ int main(int argv, char** argc)
 				ImGui::Text("add or remove cells with the red cursor");
 				ImGui::Text("use the button pads or use the (hjkl) keys to move the cursor");
 				ImGui::Text("press the space key to add/remove cell");
+				ImGui::Text("press (v) to select from the cursor, (y) to copy, (x) to cut and (p) to paste");
 				ImGui::TextColored(ImVec4(COLOR_RED,1), "Note: pause the game to prevent cells from immediately dying");
 				ImGui::Spacing();
 
@@ -632,8 +1113,8 @@ int main(int argv, char** argc)
 
 				if (ImGui::IsKeyPressed(ImGuiKey_Space))
 				{
-					spaces[editx][edity].alive = !spaces[editx][edity].alive;
-					aliveSpaces[editx][edity] = !aliveSpaces[editx][edity];
+					setSpaceCell(grid, editx, edity, !getSpaceCell(grid, editx, edity));
+					gridChanged = true;
 				}
 
 				ImGui::Indent(20);
@@ -659,14 +1140,14 @@ int main(int argv, char** argc)
 
 				if (ImGui::Button("Place Cell"))
 				{
-					spaces[editx][edity].alive = true;
-					aliveSpaces[editx][edity] = true;
+					setSpaceCell(grid, editx, edity, true);
+					gridChanged = true;
 				}
 				ImGui::SameLine();
 				if (ImGui::Button("Remove Cell"))
 				{
-					spaces[editx][edity].alive = false;
-					aliveSpaces[editx][edity] = false;
+					setSpaceCell(grid, editx, edity, false);
+					gridChanged = true;
 				}
 
 				ImGui::Spacing();
@@ -692,77 +1173,131 @@ int main(int argv, char** argc)
 				ImGui::NewLine();
 				if (ImGui::Button("Fill all cells"))
 				{
-					for (uint32_t i = 0; i < spaces.size(); i++)
-					{
-						for (uint32_t j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = true;
-							aliveSpaces[i][j] = true;
-						}
-					}
+					life::fillGrid(grid);
+					gridChanged = true;
 				}
 				ImGui::SameLine();
 				if (ImGui::Button("Remove all cells"))
 				{
-					for (uint32_t i = 0; i < spaces.size(); i++)
-					{
-						for (uint32_t j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = false;
-							aliveSpaces[i][j] = false;
-						}
-					}
+					life::clearGrid(grid);
+					gridChanged = true;
 				}
 
 				ImGui::NewLine();
-				if (ImGui::Button("Fill Randomly"))
+				bool select = ImGui::Button(selecting ? "Drop selection" : "Select from cursor");
+				if (select || ImGui::IsKeyPressed(ImGuiKey_V))
 				{
-					for (int i = 0; i < spaces.size(); i++)
-					{
-						for (int j = 0; j < spaces[i].size(); j++)
-						{
-							bool alive = (rand() % distribution) == 0 ? true : false;
+					anchorx = editx;
+					anchory = edity;
+					selecting = !selecting;
+				}
 
-							spaces[i][j].alive = alive;
-							aliveSpaces[i][j] = alive;
+				// grid coordinates of the selection, the border of the cell space is not part of the grid
+				int selx = std::min(anchorx, editx) - 1, sely = std::min(anchory, edity) - 1;
+				uint32_t selw = std::abs(anchorx - editx) + 1, selh = std::abs(anchory - edity) + 1;
 
-							if (alive)
-							{
-								for (int k = i - concRadius; k < i + concRadius; k++)
-								{
-									for (int l = j - concRadius; l < j + concRadius; l++)
-									{
-										int left = k;
-										int bottom = l;
-
-										if (left < 0) left = 0;
-										if (left > CELL_SPACE_WIDTH - 1) left = CELL_SPACE_WIDTH - 1;
-										if (bottom > CELL_SPACE_HEIGHT - 1) bottom = CELL_SPACE_HEIGHT - 1;
-										if (bottom < 0) bottom = 0;
-
-										bool neighborAlive = (rand() % 100 + 1) <= concentration ? true : false;
-										spaces[left][bottom].alive = neighborAlive;
-										aliveSpaces[left][bottom] = neighborAlive;
-									}
-								}
-							}
-						}
+				ImGui::BeginDisabled(!selecting);
+				bool copy = ImGui::Button("Copy");
+				ImGui::SameLine();
+				bool cut = ImGui::Button("Cut");
+				copy |= selecting && ImGui::IsKeyPressed(ImGuiKey_Y);
+				cut |= selecting && ImGui::IsKeyPressed(ImGuiKey_X);
+				if (copy || cut)
+				{
+					if (clipboard && (clipboard->width != selw || clipboard->height != selh))
+					{
+						life::destroyGrid(clipboard);
+						clipboard = nullptr;
 					}
+					if (!clipboard) life::createGrid(&clipboard, selw, selh);
+					life::copyRegion(grid, selx, sely, clipboard);
+				}
+				if (cut)
+				{
+					life::fillRegion(grid, selx, sely, selw, selh, false);
+					gridChanged = true;
+				}
+
+				ImGui::SameLine();
+				if (ImGui::Button("Fill"))
+				{
+					life::fillRegion(grid, selx, sely, selw, selh, true);
+					gridChanged = true;
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Clear##selection"))
+				{
+					life::fillRegion(grid, selx, sely, selw, selh, false);
+					gridChanged = true;
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("Invert"))
+				{
+					life::invertRegion(grid, selx, sely, selw, selh);
+					gridChanged = true;
+				}
+				ImGui::EndDisabled();
+
+				// the clipboard's first cell lands on the cursor
+				ImGui::BeginDisabled(!clipboard);
+				bool paste = ImGui::Button("Paste");
+				if (clipboard && (paste || ImGui::IsKeyPressed(ImGuiKey_P)))
+				{
+					life::pasteRegion(grid, clipboard, editx - 1, edity - 1, (LifeBlend)pasteBlend);
+					gridChanged = true;
+				}
+				ImGui::EndDisabled();
+				ImGui::SameLine();
+				ImGui::SetNextItemWidth(100.0f);
+				ImGui::Combo("Blend", &pasteBlend, "or\0and\0xor\0replace\0");
+
+				// rows run up the screen, so a transform turning clockwise in a pattern file turns anticlockwise here
+				LifeTransform transform = Life_Transform_Identity;
+				ImGui::BeginDisabled(!clipboard);
+				if (ImGui::Button("Rotate")) transform = Life_Transform_Rotate270;
+				ImGui::SameLine();
+				if (ImGui::Button("Flip X")) transform = Life_Transform_FlipX;
+				ImGui::SameLine();
+				if (ImGui::Button("Flip Y")) transform = Life_Transform_FlipY;
+				ImGui::SameLine();
+				if (ImGui::Button("Transpose")) transform = Life_Transform_Transpose;
+				ImGui::EndDisabled();
+				if (clipboard && transform != Life_Transform_Identity)
+				{
+					LifeGrid transformed;
+					life::transformGrid(clipboard, transform, &transformed);
+					*clipboard = std::move(transformed);
 				}
-				ImGui::SliderInt("Distribution", &distribution, 1, 100);
-				ImGui::SliderInt("Concentration", &concentration, 1, 100);
-				ImGui::SliderInt("Concentration Radius", &concRadius, 1, 50);
+				if (clipboard)
+					ImGui::Text("clipboard: %u x %u cells", clipboard->width, clipboard->height);
+
+				ImGui::NewLine();
+				if (ImGui::Button("Fill Randomly"))
+				{
+					LifeRandomInfo randomInfo{};
+					randomInfo.seed = seed;
+					randomInfo.density = density * 0.01f;
+					life::fillRandom(grid, &randomInfo);
+					gridChanged = true;
+				}
+				ImGui::SameLine();
+				if (ImGui::Button("New Seed"))
+				{
+					seed = life::randomWord(seed, std::chrono::high_resolution_clock::now().time_since_epoch().count());
+				}
+				ImGui::InputScalar("Seed", ImGuiDataType_U64, &seed);
+				ImGui::SliderInt("Density", &density, 1, 100);
 
 				ImGui::NewLine();
 
 				if (ImGui::Button("Print Pattern to terminal"))
 				{
 					printf("Pattern Coords:\n");
-					for (int i = 0; i < spaces.size(); i++)
+					for (int i = 0; i < CELL_SPACE_WIDTH; i++)
 					{
-						for (int j = 0; j < spaces[i].size(); j++)
+						for (int j = 0; j < CELL_SPACE_HEIGHT; j++)
 						{
-							if (aliveSpaces[i][j])
+							if (getSpaceCell(grid, i, j))
 							{
 								printf("[%d][%d]\n", i, j);
 							}
@@ -771,6 +1306,8 @@ int main(int argv, char** argc)
 				}
 				ImGui::NewLine();
 
+				if (selecting)
+					drawOutlineImmediate(&batch, {(selx + 1) * CELL_SPACE_SCALE - 1.5f, (sely + 1) * CELL_SPACE_SCALE - 1.5f}, {selw * CELL_SPACE_SCALE, selh * CELL_SPACE_SCALE}, {COLOR_RED});
 				drawRectImmediate(&batch, {editx * CELL_SPACE_SCALE + 3.0f, edity * CELL_SPACE_SCALE + 3.0f}, {4.0f, 4.0f}, {COLOR_RED});
 			}
 
@@ -779,139 +1316,28 @@ int main(int argv, char** argc)
 				ImGui::Text("Choose a pattern");
 				if (ImGui::Button("Beacon"))
 				{
-					for (int i = 0; i < spaces.size(); i++)
-					{
-						for (int j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = false;
-							aliveSpaces[i][j] = false;
-						}
-					}
-
-					spaces[x + 0][y + 0].alive = true; aliveSpaces[x + 0][y + 0] = true;
-					spaces[x + 1][y + 0].alive = true; aliveSpaces[x + 1][y + 0] = true;
-					spaces[x + 0][y - 1].alive = true; aliveSpaces[x + 0][y - 1] = true;
-					spaces[x + 3][y - 2].alive = true; aliveSpaces[x + 3][y - 2] = true;
-					spaces[x + 3][y - 3].alive = true; aliveSpaces[x + 3][y - 3] = true;
-					spaces[x + 2][y - 3].alive = true; aliveSpaces[x + 2][y - 3] = true;
+					loadPreset(grid, s_PresetBeacon, ARRAY_LEN(s_PresetBeacon), x, y);
+					gridChanged = true;
 				}
 				if (ImGui::Button("Glider"))
 				{
-					for (int i = 0; i < spaces.size(); i++)
-					{
-						for (int j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = false;
-							aliveSpaces[i][j] = false;
-						}
-					}
-
-					spaces[x + 0][y + 0].alive = true;
-					spaces[x + 1][y + 0].alive = true;
-					spaces[x + 2][y + 0].alive = true;
-					spaces[x + 1][y + 2].alive = true;
-					spaces[x + 2][y + 1].alive = true;
-
-					aliveSpaces[x + 0][y + 0] = true;
-					aliveSpaces[x + 1][y + 0] = true;
-					aliveSpaces[x + 2][y + 0] = true;
-					aliveSpaces[x + 1][y + 2] = true;
-					aliveSpaces[x + 2][y + 1] = true;
+					loadPreset(grid, s_PresetGlider, ARRAY_LEN(s_PresetGlider), x, y);
+					gridChanged = true;
 				}
 				if (ImGui::Button("Gosper glider gun"))
 				{
-					for (int i = 0; i < spaces.size(); i++)
-					{
-						for (int j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = false;
-							aliveSpaces[i][j] = false;
-						}
-					}
-
-					spaces[x - 1][y - 1].alive = true;  aliveSpaces[x - 1][y - 1] = true;
-					spaces[x - 2][y + 0].alive = true;  aliveSpaces[x - 2][y + 0] = true;
-					spaces[x - 2][y - 1].alive = true;  aliveSpaces[x - 2][y - 1] = true;
-					spaces[x - 2][y - 2].alive = true;  aliveSpaces[x - 2][y - 2] = true;
-					spaces[x - 3][y + 1].alive = true;  aliveSpaces[x - 3][y + 1] = true;
-					spaces[x - 3][y - 3].alive = true;  aliveSpaces[x - 3][y - 3] = true;
-					spaces[x - 4][y - 1].alive = true;  aliveSpaces[x - 4][y - 1] = true;
-					spaces[x - 5][y + 2].alive = true;  aliveSpaces[x - 5][y + 2] = true;
-					spaces[x - 5][y - 4].alive = true;  aliveSpaces[x - 5][y - 4] = true;
-					spaces[x - 6][y + 2].alive = true;  aliveSpaces[x - 6][y + 2] = true;
-					spaces[x - 6][y - 4].alive = true;  aliveSpaces[x - 6][y - 4] = true;
-					spaces[x - 7][y + 1].alive = true;  aliveSpaces[x - 7][y + 1] = true;
-					spaces[x - 7][y - 3].alive = true;  aliveSpaces[x - 7][y - 3] = true;
-					spaces[x - 8][y + 0].alive = true;  aliveSpaces[x - 8][y + 0] = true;
-					spaces[x - 8][y - 1].alive = true;  aliveSpaces[x - 8][y - 1] = true;
-					spaces[x - 8][y - 2].alive = true;  aliveSpaces[x - 8][y - 2] = true;
-					spaces[x - 17][y + 0].alive = true; aliveSpaces[x - 17][y + 0] = true;
-					spaces[x - 17][y - 1].alive = true; aliveSpaces[x - 17][y - 1] = true;
-					spaces[x - 18][y + 0].alive = true; aliveSpaces[x - 18][y + 0] = true;
-					spaces[x - 18][y - 1].alive = true; aliveSpaces[x - 18][y - 1] = true;
-					spaces[x + 2][y + 0].alive = true;  aliveSpaces[x + 2][y + 0] = true;
-					spaces[x + 2][y + 1].alive = true;  aliveSpaces[x + 2][y + 1] = true;
-					spaces[x + 2][y + 2].alive = true;  aliveSpaces[x + 2][y + 2] = true;
-					spaces[x + 3][y + 0].alive = true;  aliveSpaces[x + 3][y + 0] = true;
-					spaces[x + 3][y + 1].alive = true;  aliveSpaces[x + 3][y + 1] = true;
-					spaces[x + 3][y + 2].alive = true;  aliveSpaces[x + 3][y + 2] = true;
-					spaces[x + 4][y - 1].alive = true;  aliveSpaces[x + 4][y - 1] = true;
-					spaces[x + 4][y + 3].alive = true;  aliveSpaces[x + 4][y + 3] = true;
-					spaces[x + 6][y + 3].alive = true;  aliveSpaces[x + 6][y + 3] = true;
-					spaces[x + 6][y + 4].alive = true;  aliveSpaces[x + 6][y + 4] = true;
-					spaces[x + 6][y - 1].alive = true;  aliveSpaces[x + 6][y - 1] = true;
-					spaces[x + 6][y - 2].alive = true;  aliveSpaces[x + 6][y - 2] = true;
-					spaces[x + 16][y + 1].alive = true; aliveSpaces[x + 16][y + 1] = true;
-					spaces[x + 16][y + 2].alive = true; aliveSpaces[x + 16][y + 2] = true;
-					spaces[x + 17][y + 1].alive = true; aliveSpaces[x + 17][y + 1] = true;
-					spaces[x + 17][y + 2].alive = true; aliveSpaces[x + 17][y + 2] = true;
+					loadPreset(grid, s_PresetGosperGliderGun, ARRAY_LEN(s_PresetGosperGliderGun), x, y);
+					gridChanged = true;
 				}
 				if (ImGui::Button("R-pentomino"))
 				{
-					for (int i = 0; i < spaces.size(); i++)
-					{
-						for (int j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = false;
-							aliveSpaces[i][j] = false;
-						}
-					}
-
-					spaces[x + 0][y + 0].alive = true;
-					spaces[x + 0][y + 1].alive = true;
-					spaces[x - 1][y + 0].alive = true;
-					spaces[x + 0][y - 1].alive = true;
-					spaces[x + 1][y - 1].alive = true;
-
-					aliveSpaces[x + 0][y + 0] = true;
-					aliveSpaces[x + 0][y + 1] = true;
-					aliveSpaces[x - 1][y + 0] = true;
-					aliveSpaces[x + 0][y - 1] = true;
-					aliveSpaces[x + 1][y - 1] = true;
+					loadPreset(grid, s_PresetRPentomino, ARRAY_LEN(s_PresetRPentomino), x, y);
+					gridChanged = true;
 				}
 				if (ImGui::Button("Penta-decathlon"))
 				{
-					for (int i = 0; i < spaces.size(); i++)
-					{
-						for (int j = 0; j < spaces[i].size(); j++)
-						{
-							spaces[i][j].alive = false;
-							aliveSpaces[i][j] = false;
-						}
-					}
-
-					spaces[x + 0][y + 0].alive = true; aliveSpaces[x + 0][y + 0] = true;
-					spaces[x - 1][y + 0].alive = true; aliveSpaces[x - 1][y + 0] = true;
-					spaces[x - 2][y + 1].alive = true; aliveSpaces[x - 2][y + 1] = true;
-					spaces[x - 2][y - 1].alive = true; aliveSpaces[x - 2][y - 1] = true;
-					spaces[x - 3][y + 0].alive = true; aliveSpaces[x - 3][y + 0] = true;
-					spaces[x - 4][y + 0].alive = true; aliveSpaces[x - 4][y + 0] = true;
-					spaces[x + 1][y + 0].alive = true; aliveSpaces[x + 1][y + 0] = true;
-					spaces[x + 2][y + 0].alive = true; aliveSpaces[x + 2][y + 0] = true;
-					spaces[x + 3][y + 1].alive = true; aliveSpaces[x + 3][y + 1] = true;
-					spaces[x + 3][y - 1].alive = true; aliveSpaces[x + 3][y - 1] = true;
-					spaces[x + 4][y + 0].alive = true; aliveSpaces[x + 4][y + 0] = true;
-					spaces[x + 5][y + 0].alive = true; aliveSpaces[x + 5][y + 0] = true;
+					loadPreset(grid, s_PresetPentaDecathlon, ARRAY_LEN(s_PresetPentaDecathlon), x, y);
+					gridChanged = true;
 				}
 			}
 
@@ -924,45 +1350,112 @@ int main(int argv, char** argc)
 			ImGui::NewLine();
 			ImGui::Text("Time elapsed: %f", timer.elapsed());
 			ImGui::Text("Generation: %u", generation);
+			if (cycleFound)
+				ImGui::Text("Period %llu reached at generation %llu", (unsigned long long)cycle.period, (unsigned long long)cycle.generation);
+			else
+				ImGui::Text("Period: not detected");
+			ImGui::Checkbox("Pause when periodic", &pauseOnCycle);
+			if (cycleFound)
+			{
+				ImGui::InputScalar("Target generation", ImGuiDataType_U32, &skipTarget);
+				ImGui::SameLine();
+				if (ImGui::Button("Fast forward") && skipTarget > generation)
+				{
+					// only the remainder of the distance modulo the period needs stepping
+					uint64_t steps = life::cycleSteps(&cycle, generation, skipTarget);
+					for (uint64_t i = 0; i < steps; i++)
+						stepSpace(&grid, &nextGrid, &gridHash, &stepStats);
+					generation = skipTarget;
+					life::recordHistory(history, generation, grid);
+					if (planes) life::syncCellPlanes(planes, grid);
+				}
+			}
 			ImGui::SliderFloat("Time step", &timeInt, 0.01f, 1.0f);
 
-			ImGui::NewLine();
-			if (ImGui::Button("Reset"))
+			uint64_t historyFirst, historyLast;
+			if (life::historyRange(history, &historyFirst, &historyLast) && historyLast > historyFirst)
 			{
-				timer.reset();
-				generation = 0;
-				for (int i = 0; i < spaces.size(); i++)
+				uint64_t timeline = generation;
+				bool scrubbed = ImGui::SliderScalar("Timeline", ImGuiDataType_U64, &timeline, &historyFirst, &historyLast);
+				if (ImGui::Button("Rewind") && timeline > historyFirst)
+				{
+					timeline--;
+					scrubbed = true;
+				}
+				ImGui::SameLine();
+				ImGui::Text("generations %llu to %llu recorded, %.1f MB", (unsigned long long)historyFirst, (unsigned long long)historyLast, life::historyMemory(history) / (1024.0f * 1024.0f));
+
+				// moving the timeline pauses on the restored generation, stepping or editing from there drops the later ones,
+				// a generation skipped by fast forwarding lands on the last one recorded before it
+				if (scrubbed && life::recordedGeneration(history, timeline, &timeline) && life::restoreHistory(history, timeline, grid) == Life_Result_Success)
+				{
+					generation = (uint32_t)timeline;
+					timelineMoved = true;
+					if (!pause)
+					{
+						pause = true;
+						pauseName = "Play";
+						timer.pause();
+					}
+				}
+			}
+
+			if (ImGui::CollapsingHeader("Population"))
+				drawPopulation(&populationGraph, &stepStats);
+
+			if (ImGui::CollapsingHeader("Heatmap"))
+			{
+				ImGui::Text("color cells by how long they have lived or by recent births and deaths");
+				if (ImGui::Combo("Cells", &cellView, "state\0age\0activity\0"))
 				{
-					for (int j = 0; j < spaces[i].size(); j++)
+					if (cellView != Cell_View_State && !planes)
 					{
-						spaces[i][j].alive = false;
-						aliveSpaces[i][j] = false;
+						life::createCellPlanes(&planes, CELL_SPACE_WIDTH - 2, CELL_SPACE_HEIGHT - 2);
+						life::syncCellPlanes(planes, grid);
+					}
+					else if (cellView == Cell_View_State && planes)
+					{
+						life::destroyCellPlanes(planes);
+						planes = nullptr;
 					}
 				}
+			}
 
-				spaces[x + 0][y + 0].alive = true;
-				spaces[x + 0][y + 1].alive = true;
-				spaces[x - 1][y + 0].alive = true;
-				spaces[x + 0][y - 1].alive = true;
-				spaces[x + 1][y - 1].alive = true;
+			if (ImGui::CollapsingHeader("Profiler"))
+			{
+				drawProfiler(&profiler);
 
-				aliveSpaces[x + 0][y + 0] = true;
-				aliveSpaces[x + 0][y + 1] = true;
-				aliveSpaces[x - 1][y + 0] = true;
-				aliveSpaces[x + 0][y - 1] = true;
-				aliveSpaces[x + 1][y - 1] = true;
+				bool tracing = life::traceEnabled.load();
+				if (ImGui::Checkbox("Record trace", &tracing))
+					life::setTracing(tracing);
+				ImGui::SameLine();
+				if (ImGui::Button("Write trace"))
+					life::writeTrace(TRACE_FILE);
+			}
+
+			ImGui::NewLine();
+			if (ImGui::Button("Reset"))
+			{
+				timer.reset();
+				generation = 0;
+				populationGraph.reset();
+				loadPreset(grid, s_PresetRPentomino, ARRAY_LEN(s_PresetRPentomino), x, y);
+				gridChanged = true;
 			}
 
 			ImGui::End();
 		}
 
+		profiler.mark(Frame_Phase_ImGuiRender);
 		ImGui::Render();
 		ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 
 
 
+		profiler.mark(Frame_Phase_Swap);
 		glfwSwapBuffers(window);
         glfwPollEvents();
+		profiler.endFrame();
     }
 
 
@@ -970,6 +1463,16 @@ int main(int argv, char** argc)
 	ImGui_ImplGlfw_Shutdown();
 	ImGui::DestroyContext();
 
+	if (life::traceEnabled.load())
+		life::writeTrace(TRACE_FILE);
+
+
+	life::destroyHistory(history);
+	life::destroyCycleDetector(cycleDetector);
+	life::destroyGrid(grid);
+	life::destroyGrid(nextGrid);
+	if (clipboard) life::destroyGrid(clipboard);
+	if (planes) life::destroyCellPlanes(planes);
 
 	ogls::destroyShader(shader);
 	ogls::destroyVertexArray(vertexArray);
@@ -0,0 +1,383 @@
+#include "mapped.h"
+#include "pattern.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIFE_MMAP_SUPPORTED
+#endif
+
+#define MAPPED_MAGIC 0x70616D6C6F676363ull // "ccgolmap"
+#define MAPPED_VERSION 1                   // 0 for files written before the rule and topology were kept
+#define MAPPED_HEADER_BYTES 4096           // the rows start on a page boundary
+#define MAPPED_STRIPE_BYTES (64ull << 20)
+
+struct MappedHeader
+{
+	uint64_t magic;
+	uint32_t width, height, stride;
+	uint32_t version;
+	uint64_t generation;
+	LifeRule rule;
+	uint32_t topology;
+};
+
+struct LifeMappedGrid
+{
+	int fd;
+	uint8_t* base;
+	size_t size;
+	size_t pageSize;
+	uint32_t width, height, stride;
+	uint32_t stripeRows;
+	LifeStepInfo stepInfo;
+
+	// a stripe with a halo row above and below, everything else stays on disk
+	LifeGrid* stripe;
+	LifeGrid* next;
+	std::vector<uint64_t> above;    // the previous stripe's last row before it was stepped
+	std::vector<uint64_t> firstRow; // row 0 before it was stepped, the halo below the last row of a torus
+};
+
+namespace life
+{
+#ifdef LIFE_MMAP_SUPPORTED
+	static MappedHeader* mappedHeader(LifeMappedGrid* grid);
+	static uint64_t* mappedRow(LifeMappedGrid* grid, uint32_t y);
+	static void adviseRows(LifeMappedGrid* grid, uint32_t first, uint32_t count, bool drop);
+	static LifeResult mapGrid(LifeMappedGrid* grid, const char* path, const LifeMappedCreateInfo* createInfo, bool create);
+
+	static MappedHeader* mappedHeader(LifeMappedGrid* grid)
+	{
+		return (MappedHeader*)grid->base;
+	}
+
+	static uint64_t* mappedRow(LifeMappedGrid* grid, uint32_t y)
+	{
+		return (uint64_t*)(grid->base + MAPPED_HEADER_BYTES) + (size_t)y * grid->stride;
+	}
+
+	// asks for rows to be read ahead, or dropped from the page cache once written, advice
+	// covers whole pages rounded outwards from the rows
+	static void adviseRows(LifeMappedGrid* grid, uint32_t first, uint32_t count, bool drop)
+	{
+		if (count == 0 || first >= grid->height) return;
+		count = std::min(count, grid->height - first);
+
+		size_t begin = MAPPED_HEADER_BYTES + (size_t)first * grid->stride * sizeof(uint64_t);
+		size_t end = MAPPED_HEADER_BYTES + (size_t)(first + count) * grid->stride * sizeof(uint64_t);
+		begin = begin / grid->pageSize * grid->pageSize;
+		end = std::min((end + grid->pageSize - 1) / grid->pageSize * grid->pageSize, grid->size);
+#ifdef POSIX_FADV_WILLNEED
+		posix_fadvise(grid->fd, (off_t)begin, (off_t)(end - begin), drop ? POSIX_FADV_DONTNEED : POSIX_FADV_WILLNEED);
+#endif
+		madvise(grid->base + begin, end - begin, drop ? MADV_DONTNEED : MADV_WILLNEED);
+	}
+
+	static LifeResult mapGrid(LifeMappedGrid* grid, const char* path, const LifeMappedCreateInfo* createInfo, bool create)
+	{
+		grid->fd = open(path, create ? O_RDWR | O_CREAT | O_TRUNC : O_RDWR, 0644);
+		if (grid->fd < 0)
+		{
+			printf("mapped: failed to open %s\n", path);
+			return Life_Result_Failed;
+		}
+
+		MappedHeader header{};
+		if (create)
+		{
+			header.magic = MAPPED_MAGIC;
+			header.width = createInfo->width;
+			header.height = createInfo->height;
+			header.stride = (createInfo->width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+			header.version = MAPPED_VERSION;
+			header.rule = createInfo->rule;
+			header.topology = (uint32_t)createInfo->topology;
+			grid->size = MAPPED_HEADER_BYTES + (size_t)header.stride * header.height * sizeof(uint64_t);
+
+			// a sparse file, the blocks are only allocated as stripes are written
+			if (ftruncate(grid->fd, (off_t)grid->size) != 0)
+			{
+				printf("mapped: failed to size %s to %llu bytes\n", path, (unsigned long long)grid->size);
+				return Life_Result_Failed;
+			}
+		}
+		else
+		{
+			// the stripes are sized from the header, so a damaged one must not get as far as them
+			struct stat info;
+			if (read(grid->fd, &header, sizeof(header)) != (ssize_t)sizeof(header) || header.magic != MAPPED_MAGIC || fstat(grid->fd, &info) != 0 ||
+				header.width == 0 || header.height == 0 || header.stride != (header.width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS ||
+				header.version > MAPPED_VERSION || (header.version > 0 && header.topology > Life_Topology_Torus) ||
+				(uint64_t)info.st_size != MAPPED_HEADER_BYTES + (uint64_t)header.stride * header.height * sizeof(uint64_t))
+			{
+				printf("mapped: %s is not a cgol universe file\n", path);
+				return Life_Result_Failed;
+			}
+			grid->size = info.st_size;
+
+			// a file keeps stepping under the rule and topology it was created with
+			if (header.version == 0)
+			{
+				header.rule = createInfo->rule;
+				header.topology = (uint32_t)createInfo->topology;
+			}
+		}
+
+		void* base = mmap(nullptr, grid->size, PROT_READ | PROT_WRITE, MAP_SHARED, grid->fd, 0);
+		if (base == MAP_FAILED)
+		{
+			printf("mapped: failed to map %s\n", path);
+			return Life_Result_Failed;
+		}
+		grid->base = (uint8_t*)base;
+		if (create) *mappedHeader(grid) = header;
+
+		// every pass reads the file front to back exactly once
+		madvise(grid->base, grid->size, MADV_SEQUENTIAL);
+#ifdef POSIX_FADV_SEQUENTIAL
+		posix_fadvise(grid->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+		grid->width = header.width;
+		grid->height = header.height;
+		grid->stride = header.stride;
+		grid->pageSize = (size_t)sysconf(_SC_PAGESIZE);
+
+		uint64_t rowBytes = (uint64_t)grid->stride * sizeof(uint64_t);
+		grid->stripeRows = createInfo->stripeRows ? createInfo->stripeRows : (uint32_t)std::max<uint64_t>(MAPPED_STRIPE_BYTES / rowBytes, 1);
+		grid->stripeRows = std::min(grid->stripeRows, grid->height);
+
+		grid->stepInfo.rule = header.rule;
+		grid->stepInfo.topology = (LifeTopology)header.topology;
+		grid->stepInfo.threadCount = createInfo->threadCount;
+
+		if (createGrid(&grid->stripe, grid->width, grid->stripeRows + 2) == Life_Result_Failed ||
+			createGrid(&grid->next, grid->width, grid->stripeRows + 2) == Life_Result_Failed)
+		{
+			printf("mapped: failed to allocate stripes of %u rows\n", grid->stripeRows);
+			return Life_Result_Failed;
+		}
+		grid->above.assign(grid->stride, 0);
+		grid->firstRow.assign(grid->stride, 0);
+		return Life_Result_Success;
+	}
+
+	LifeResult createMappedGrid(LifeMappedGrid** grid, const char* path, const LifeMappedCreateInfo* createInfo)
+	{
+		if (createInfo->width == 0 || createInfo->height == 0)
+			return Life_Result_Failed;
+
+		LifeMappedGrid* result = new LifeMappedGrid();
+		result->fd = -1;
+		if (mapGrid(result, path, createInfo, true) == Life_Result_Failed)
+		{
+			destroyMappedGrid(result);
+			return Life_Result_Failed;
+		}
+
+		*grid = result;
+		return Life_Result_Success;
+	}
+
+	LifeResult openMappedGrid(LifeMappedGrid** grid, const char* path, const LifeMappedCreateInfo* createInfo)
+	{
+		LifeMappedGrid* result = new LifeMappedGrid();
+		result->fd = -1;
+		if (mapGrid(result, path, createInfo, false) == Life_Result_Failed)
+		{
+			destroyMappedGrid(result);
+			return Life_Result_Failed;
+		}
+
+		*grid = result;
+		return Life_Result_Success;
+	}
+
+	void destroyMappedGrid(LifeMappedGrid* grid)
+	{
+		if (grid->base)
+		{
+			msync(grid->base, grid->size, MS_SYNC);
+			munmap(grid->base, grid->size);
+		}
+		if (grid->fd >= 0) close(grid->fd);
+		if (grid->stripe) destroyGrid(grid->stripe);
+		if (grid->next) destroyGrid(grid->next);
+		delete grid;
+	}
+
+	void mappedGridSize(const LifeMappedGrid* grid, uint32_t* width, uint32_t* height)
+	{
+		*width = grid->width;
+		*height = grid->height;
+	}
+
+	void mappedGridRule(const LifeMappedGrid* grid, LifeRule* rule, LifeTopology* topology)
+	{
+		*rule = grid->stepInfo.rule;
+		*topology = grid->stepInfo.topology;
+	}
+
+	uint64_t mappedGeneration(const LifeMappedGrid* grid)
+	{
+		return ((const MappedHeader*)grid->base)->generation;
+	}
+
+	uint64_t mappedFileSize(const LifeMappedGrid* grid)
+	{
+		return grid->size;
+	}
+
+	void fillMappedRandom(LifeMappedGrid* grid, const LifeRandomInfo* randomInfo)
+	{
+		LifeRandomInfo stripeInfo = *randomInfo;
+		for (uint32_t first = 0; first < grid->height; first += grid->stripeRows)
+		{
+			uint32_t count = std::min(grid->stripeRows, grid->height - first);
+			LifeGrid* rows = grid->stripe;
+			rows->height = count;
+			rows->words.resize((size_t)count * grid->stride);
+
+			stripeInfo.firstRow = randomInfo->firstRow + first;
+			fillRandom(rows, &stripeInfo);
+			memcpy(mappedRow(grid, first), rows->words.data(), (size_t)count * grid->stride * sizeof(uint64_t));
+			adviseRows(grid, first, count, true);
+
+			rows->height = grid->stripeRows + 2;
+			rows->words.resize((size_t)rows->height * grid->stride);
+		}
+		mappedHeader(grid)->generation = 0;
+	}
+
+	void placeMappedPattern(LifeMappedGrid* grid, const LifeGrid* pattern, int32_t x, int32_t y)
+	{
+		// only the stripes the pattern overlaps are read and written
+		for (uint32_t first = 0; first < grid->height; first += grid->stripeRows)
+		{
+			uint32_t count = std::min(grid->stripeRows, grid->height - first);
+			if ((int64_t)y + pattern->height <= first || (int64_t)y >= (int64_t)first + count)
+				continue;
+
+			LifeGrid* rows = grid->stripe;
+			rows->height = count;
+			rows->words.resize((size_t)count * grid->stride);
+
+			memcpy(rows->words.data(), mappedRow(grid, first), (size_t)count * grid->stride * sizeof(uint64_t));
+			placePattern(rows, pattern, x, y - (int32_t)first);
+			memcpy(mappedRow(grid, first), rows->words.data(), (size_t)count * grid->stride * sizeof(uint64_t));
+
+			rows->height = grid->stripeRows + 2;
+			rows->words.resize((size_t)rows->height * grid->stride);
+		}
+	}
+
+	// the file is stepped in place: each stripe is copied in with its halo rows, stepped in
+	// memory and written back, the halo above comes from the copy kept before the previous
+	// stripe was overwritten and the halo below is still the old row in the file
+	void stepMappedGrid(LifeMappedGrid* grid, uint64_t* population, uint64_t* hash)
+	{
+		LIFE_TRACE_SCOPE("sim", "mapped step");
+		uint32_t stride = grid->stride;
+		size_t rowBytes = (size_t)stride * sizeof(uint64_t);
+		bool torus = grid->stepInfo.topology == Life_Topology_Torus;
+		uint64_t stepPopulation = 0, stepHash = 0;
+
+		std::fill(grid->above.begin(), grid->above.end(), 0);
+		if (torus)
+		{
+			memcpy(grid->above.data(), mappedRow(grid, grid->height - 1), rowBytes);
+			memcpy(grid->firstRow.data(), mappedRow(grid, 0), rowBytes);
+		}
+		adviseRows(grid, 0, grid->stripeRows + 1, false);
+
+		for (uint32_t first = 0; first < grid->height; first += grid->stripeRows)
+		{
+			uint32_t count = std::min(grid->stripeRows, grid->height - first);
+			uint32_t last = first + count;
+
+			// the kernel reads the next stripe in while this one is stepped
+			adviseRows(grid, last, grid->stripeRows + 1, false);
+
+			LifeGrid* stripe = grid->stripe;
+			LifeGrid* next = grid->next;
+			stripe->height = next->height = count + 2;
+			uint64_t* words = stripe->words.data();
+			memcpy(words, grid->above.data(), rowBytes);
+			{
+				LIFE_TRACE_SCOPE("io", "mapped read");
+				memcpy(words + stride, mappedRow(grid, first), (size_t)count * rowBytes);
+			}
+			if (last < grid->height)
+				memcpy(words + (size_t)(count + 1) * stride, mappedRow(grid, last), rowBytes);
+			else if (torus)
+				memcpy(words + (size_t)(count + 1) * stride, grid->firstRow.data(), rowBytes);
+			else
+				memset(words + (size_t)(count + 1) * stride, 0, rowBytes);
+
+			// the halo rows are stepped too but never written, only their columns wrap on a torus
+			step(stripe, next, &grid->stepInfo);
+			memcpy(grid->above.data(), words + (size_t)count * stride, rowBytes);
+
+			const uint64_t* stepped = next->words.data() + stride;
+			for (uint32_t y = 0; y < count; y++)
+			{
+				const uint64_t* row = stepped + (size_t)y * stride;
+				if (population)
+					for (uint32_t w = 0; w < stride; w++)
+						stepPopulation += popcount64(row[w]);
+				if (hash)
+					stepHash ^= hashRow(row, stride, first + y);
+			}
+
+			{
+				LIFE_TRACE_SCOPE("io", "mapped write");
+				memcpy(mappedRow(grid, first), stepped, (size_t)count * rowBytes);
+			}
+
+			// the pages written are queued for writeback and dropped, so a universe larger than
+			// memory streams through the page cache instead of pushing everything else out
+#ifdef __linux__
+			sync_file_range(grid->fd, (off_t)(MAPPED_HEADER_BYTES + (size_t)first * rowBytes), (off_t)((size_t)count * rowBytes), SYNC_FILE_RANGE_WRITE);
+#endif
+			if (first >= grid->stripeRows)
+				adviseRows(grid, first - grid->stripeRows, grid->stripeRows, true);
+		}
+
+		grid->stripe->height = grid->next->height = grid->stripeRows + 2;
+		mappedHeader(grid)->generation++;
+		if (population) *population = stepPopulation;
+		if (hash) *hash = stepHash;
+	}
+#else
+	LifeResult createMappedGrid(LifeMappedGrid** grid, const char* path, const LifeMappedCreateInfo* createInfo)
+	{
+		printf("mapped: out-of-core grids need a POSIX system\n");
+		return Life_Result_Failed;
+	}
+
+	LifeResult openMappedGrid(LifeMappedGrid** grid, const char* path, const LifeMappedCreateInfo* createInfo)
+	{
+		printf("mapped: out-of-core grids need a POSIX system\n");
+		return Life_Result_Failed;
+	}
+
+	void destroyMappedGrid(LifeMappedGrid* grid) {}
+	void mappedGridSize(const LifeMappedGrid* grid, uint32_t* width, uint32_t* height) { *width = *height = 0; }
+	void mappedGridRule(const LifeMappedGrid* grid, LifeRule* rule, LifeTopology* topology) {}
+	uint64_t mappedGeneration(const LifeMappedGrid* grid) { return 0; }
+	uint64_t mappedFileSize(const LifeMappedGrid* grid) { return 0; }
+	void fillMappedRandom(LifeMappedGrid* grid, const LifeRandomInfo* randomInfo) {}
+	void placeMappedPattern(LifeMappedGrid* grid, const LifeGrid* pattern, int32_t x, int32_t y) {}
+	void stepMappedGrid(LifeMappedGrid* grid, uint64_t* population, uint64_t* hash) {}
+#endif
+}
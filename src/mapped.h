@@ -0,0 +1,38 @@
+#pragma once
+
+#include "life.h"
+
+// a universe kept in a memory mapped file and stepped a stripe of rows at a time, so it can
+// be larger than physical memory, POSIX systems only
+struct LifeMappedGrid;
+
+struct LifeMappedCreateInfo
+{
+	uint32_t width, height; // size of a new file, an opened file keeps its own
+	uint32_t stripeRows;    // rows stepped at a time, 0 picks stripes of about 64 MB
+	uint32_t threadCount;   // 0 uses every hardware thread
+	LifeRule rule;          // rule and topology of a new file, an opened file keeps its own too
+	LifeTopology topology;
+};
+
+namespace life
+{
+	// createMappedGrid replaces path with an empty universe, openMappedGrid continues one
+	LifeResult createMappedGrid(LifeMappedGrid** grid, const char* path, const LifeMappedCreateInfo* createInfo);
+	LifeResult openMappedGrid(LifeMappedGrid** grid, const char* path, const LifeMappedCreateInfo* createInfo);
+	// writes every dirty page back before unmapping
+	void       destroyMappedGrid(LifeMappedGrid* grid);
+
+	void       mappedGridSize(const LifeMappedGrid* grid, uint32_t* width, uint32_t* height);
+	void       mappedGridRule(const LifeMappedGrid* grid, LifeRule* rule, LifeTopology* topology);
+	uint64_t   mappedGeneration(const LifeMappedGrid* grid);
+	uint64_t   mappedFileSize(const LifeMappedGrid* grid);
+
+	// both fill a stripe at a time, the random fill matches fillRandom of the whole universe
+	void       fillMappedRandom(LifeMappedGrid* grid, const LifeRandomInfo* randomInfo);
+	void       placeMappedPattern(LifeMappedGrid* grid, const LifeGrid* pattern, int32_t x, int32_t y);
+
+	// one streaming pass over the file, population and hash (both optional) describe the new
+	// generation, the hash equals hashGrid of the whole universe
+	void       stepMappedGrid(LifeMappedGrid* grid, uint64_t* population, uint64_t* hash);
+}
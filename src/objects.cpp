@@ -0,0 +1,479 @@
+#include "objects.h"
+
+#include <algorithm>
+#include <unordered_map>
+
+#define OBJECTS_CACHE_LIMIT (1 << 16)
+
+struct LifeObjectClass
+{
+	LifeObjectType type;
+	uint32_t period;
+	int32_t dx, dy;
+	uint64_t hash;
+	std::string code;
+};
+
+struct LifeObjectCache
+{
+	std::unordered_map<std::string, LifeObjectClass> entries;
+};
+
+namespace life
+{
+	static const char* s_CodeChars = "0123456789abcdefghijklmnopqrstuvwxyz";
+
+	static void resizeGrid(LifeGrid* grid, uint32_t width, uint32_t height);
+	static uint64_t readBits(const uint64_t* row, uint32_t stride, uint32_t bit);
+	static bool cropGrid(const LifeGrid* grid, LifeGrid* out, int32_t* x, int32_t* y);
+	static bool firstCell(const LifeGrid* grid, int32_t* x, int32_t* y);
+	static std::string wechslerCode(const LifeGrid* cells);
+	static std::string canonicalCode(const std::vector<LifeGrid>& phases);
+	static std::string cacheKey(const LifeGrid* cells);
+	static uint64_t hashString(const std::string& str);
+
+	static void resizeGrid(LifeGrid* grid, uint32_t width, uint32_t height)
+	{
+		grid->width = width;
+		grid->height = height;
+		grid->stride = (width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+		grid->words.assign((size_t)grid->stride * height, 0);
+	}
+
+	// 64 cells of a row starting at an arbitrary bit, cells past the row read as dead
+	static uint64_t readBits(const uint64_t* row, uint32_t stride, uint32_t bit)
+	{
+		uint32_t w = bit / LIFE_WORD_BITS, shift = bit % LIFE_WORD_BITS;
+		uint64_t low = w < stride ? row[w] >> shift : 0;
+		uint64_t high = (shift != 0 && w + 1 < stride) ? row[w + 1] << (LIFE_WORD_BITS - shift) : 0;
+		return low | high;
+	}
+
+	static bool cropGrid(const LifeGrid* grid, LifeGrid* out, int32_t* x, int32_t* y)
+	{
+		uint32_t minX = UINT32_MAX, maxX = 0, minY = UINT32_MAX, maxY = 0;
+		for (uint32_t row = 0; row < grid->height; row++)
+		{
+			const uint64_t* words = grid->words.data() + (size_t)row * grid->stride;
+			for (uint32_t w = 0; w < grid->stride; w++)
+			{
+				if (!words[w]) continue;
+
+				minX = std::min(minX, w * LIFE_WORD_BITS + lowestBit64(words[w]));
+				maxX = std::max(maxX, w * LIFE_WORD_BITS + highestBit64(words[w]));
+				minY = std::min(minY, row);
+				maxY = row;
+			}
+		}
+
+		if (minY == UINT32_MAX)
+		{
+			resizeGrid(out, 0, 0);
+			return false;
+		}
+
+		resizeGrid(out, maxX - minX + 1, maxY - minY + 1);
+		uint64_t lastMask = rowMask(out);
+		for (uint32_t row = 0; row < out->height; row++)
+		{
+			const uint64_t* src = grid->words.data() + (size_t)(row + minY) * grid->stride;
+			uint64_t* dst = out->words.data() + (size_t)row * out->stride;
+			for (uint32_t w = 0; w < out->stride; w++)
+				dst[w] = readBits(src, grid->stride, minX + w * LIFE_WORD_BITS);
+			dst[out->stride - 1] &= lastMask;
+		}
+
+		*x = minX;
+		*y = minY;
+		return true;
+	}
+
+	static bool firstCell(const LifeGrid* grid, int32_t* x, int32_t* y)
+	{
+		for (size_t i = 0; i < grid->words.size(); i++)
+		{
+			if (!grid->words[i]) continue;
+
+			*x = (int32_t)((i % grid->stride) * LIFE_WORD_BITS + lowestBit64(grid->words[i]));
+			*y = (int32_t)(i / grid->stride);
+			return true;
+		}
+		return false;
+	}
+
+	// extended Wechsler format: strips of five rows, one character per column,
+	// runs of empty columns shortened to w (2), x (3) and y? (4 and more)
+	static std::string wechslerCode(const LifeGrid* cells)
+	{
+		std::vector<uint32_t> columns;
+		std::string code;
+
+		for (uint32_t strip = 0; strip * 5 < cells->height; strip++)
+		{
+			columns.assign(cells->width, 0);
+			for (uint32_t k = 0; k < 5 && strip * 5 + k < cells->height; k++)
+			{
+				const uint64_t* row = cells->words.data() + (size_t)(strip * 5 + k) * cells->stride;
+				for (uint32_t w = 0; w < cells->stride; w++)
+				{
+					uint64_t word = row[w];
+					while (word)
+					{
+						columns[w * LIFE_WORD_BITS + lowestBit64(word)] |= 1 << k;
+						word &= word - 1;
+					}
+				}
+			}
+
+			while (!columns.empty() && columns.back() == 0)
+				columns.pop_back();
+
+			if (strip > 0) code += 'z';
+
+			for (size_t i = 0; i < columns.size();)
+			{
+				if (columns[i] != 0)
+				{
+					code += s_CodeChars[columns[i++]];
+					continue;
+				}
+
+				size_t run = 0;
+				while (i + run < columns.size() && columns[i + run] == 0 && run < 39)
+					run++;
+				i += run;
+
+				if (run == 1) code += '0';
+				else if (run == 2) code += 'w';
+				else if (run == 3) code += 'x';
+				else { code += 'y'; code += s_CodeChars[run - 4]; }
+			}
+		}
+
+		return code;
+	}
+
+	// shortest, then lexicographically least code over every phase and orientation
+	static std::string canonicalCode(const std::vector<LifeGrid>& phases)
+	{
+		std::string best;
+		LifeGrid oriented;
+
+		for (const LifeGrid& phase : phases)
+		{
+			for (uint32_t transform = 0; transform < 8; transform++)
+			{
+				transformGrid(&phase, (LifeTransform)transform, &oriented);
+
+				std::string code = wechslerCode(&oriented);
+				if (best.empty() || code.size() < best.size() || (code.size() == best.size() && code < best))
+					best = code;
+			}
+		}
+
+		return best;
+	}
+
+	static std::string cacheKey(const LifeGrid* cells)
+	{
+		std::string key((const char*)&cells->width, sizeof(cells->width));
+		key.append((const char*)&cells->height, sizeof(cells->height));
+		key.append((const char*)cells->words.data(), cells->words.size() * sizeof(uint64_t));
+		return key;
+	}
+
+	static uint64_t hashString(const std::string& str)
+	{
+		uint64_t hash = 0xCBF29CE484222325ull;
+		for (char c : str)
+			hash = (hash ^ (uint8_t)c) * 0x100000001B3ull;
+		return hash;
+	}
+
+	LifeResult createObjectCache(LifeObjectCache** cache)
+	{
+		*cache = new LifeObjectCache();
+		return Life_Result_Success;
+	}
+
+	void destroyObjectCache(LifeObjectCache* cache)
+	{
+		delete cache;
+	}
+
+	// word level flood fill: the component is grown by dilating it with the neighbourhood
+	// and masking with the remaining live cells, inside a window that follows its bounding box
+	void findObjects(const LifeGrid* grid, uint32_t distance, std::vector<LifeObject>* objects)
+	{
+		objects->clear();
+		if (distance == 0) distance = 1;
+		if (distance > 63) distance = 63;
+
+		uint32_t stride = grid->stride, height = grid->height;
+		std::vector<uint64_t> remaining = grid->words;
+		std::vector<uint64_t> component, dilated, grown;
+		LifeGrid window;
+
+		for (size_t scan = 0; scan < remaining.size(); scan++)
+		{
+			while (remaining[scan])
+			{
+				// window rows [y0, y1) and words [w0, w1) around the component
+				uint32_t y0 = (uint32_t)(scan / stride), y1 = y0 + 1;
+				uint32_t w0 = (uint32_t)(scan % stride), w1 = w0 + 1;
+				component.assign(1, remaining[scan] & (~remaining[scan] + 1));
+				uint64_t population = 1;
+
+				for (;;)
+				{
+					uint32_t ny0 = y0 > distance ? y0 - distance : 0, ny1 = std::min(height, y1 + distance);
+					uint32_t nw0 = w0 > 0 ? w0 - 1 : 0, nw1 = std::min(stride, w1 + 1);
+					uint32_t oldWords = w1 - w0, newWords = nw1 - nw0;
+
+					// horizontal dilation of the component rows over the new word range
+					dilated.assign((size_t)(y1 - y0) * newWords, 0);
+					for (uint32_t y = y0; y < y1; y++)
+					{
+						const uint64_t* src = component.data() + (size_t)(y - y0) * oldWords;
+						uint64_t* dst = dilated.data() + (size_t)(y - y0) * newWords;
+						for (uint32_t w = nw0; w < nw1; w++)
+						{
+							uint64_t c = (w >= w0 && w < w1) ? src[w - w0] : 0;
+							uint64_t p = (w > w0 && w - 1 < w1) ? src[w - 1 - w0] : 0;
+							uint64_t n = (w + 1 >= w0 && w + 1 < w1) ? src[w + 1 - w0] : 0;
+
+							uint64_t value = c;
+							for (uint32_t k = 1; k <= distance; k++)
+								value |= (c << k) | (p >> (LIFE_WORD_BITS - k)) | (c >> k) | (n << (LIFE_WORD_BITS - k));
+							dst[w - nw0] = value;
+						}
+					}
+
+					// vertical dilation, masked by the remaining live cells
+					grown.assign((size_t)(ny1 - ny0) * newWords, 0);
+					uint64_t grownPopulation = 0;
+					for (uint32_t y = ny0; y < ny1; y++)
+					{
+						uint32_t from = std::max(y0, y > distance ? y - distance : 0), to = std::min(y1, y + distance + 1);
+						uint64_t* dst = grown.data() + (size_t)(y - ny0) * newWords;
+						for (uint32_t yy = from; yy < to; yy++)
+						{
+							const uint64_t* src = dilated.data() + (size_t)(yy - y0) * newWords;
+							for (uint32_t w = 0; w < newWords; w++)
+								dst[w] |= src[w];
+						}
+
+						const uint64_t* live = remaining.data() + (size_t)y * stride + nw0;
+						for (uint32_t w = 0; w < newWords; w++)
+						{
+							dst[w] &= live[w];
+							grownPopulation += popcount64(dst[w]);
+						}
+					}
+
+					// shrink the window to the rows and words that hold cells
+					uint32_t ty0 = ny1, ty1 = ny0, tw0 = nw1, tw1 = nw0;
+					for (uint32_t y = ny0; y < ny1; y++)
+					{
+						for (uint32_t w = nw0; w < nw1; w++)
+						{
+							if (!grown[(size_t)(y - ny0) * newWords + (w - nw0)]) continue;
+							ty0 = std::min(ty0, y); ty1 = std::max(ty1, y + 1);
+							tw0 = std::min(tw0, w); tw1 = std::max(tw1, w + 1);
+						}
+					}
+
+					component.assign((size_t)(ty1 - ty0) * (tw1 - tw0), 0);
+					for (uint32_t y = ty0; y < ty1; y++)
+					{
+						for (uint32_t w = tw0; w < tw1; w++)
+							component[(size_t)(y - ty0) * (tw1 - tw0) + (w - tw0)] = grown[(size_t)(y - ny0) * newWords + (w - nw0)];
+					}
+					y0 = ty0; y1 = ty1; w0 = tw0; w1 = tw1;
+
+					if (grownPopulation == population) break;
+					population = grownPopulation;
+				}
+
+				window.width = (w1 - w0) * LIFE_WORD_BITS;
+				window.height = y1 - y0;
+				window.stride = w1 - w0;
+				window.words = component;
+
+				for (uint32_t y = y0; y < y1; y++)
+				{
+					for (uint32_t w = w0; w < w1; w++)
+						remaining[(size_t)y * stride + w] &= ~component[(size_t)(y - y0) * (w1 - w0) + (w - w0)];
+				}
+
+				LifeObject object{};
+				cropGrid(&window, &object.cells, &object.x, &object.y);
+				object.x += w0 * LIFE_WORD_BITS;
+				object.y += y0;
+				object.population = (uint32_t)population;
+				object.type = Life_Object_Unknown;
+				object.code = "zz_UNKNOWN";
+				objects->push_back(std::move(object));
+			}
+		}
+	}
+
+	// runs the object on its own until it repeats, then names it xs<population>, xp<period> or xq<period>
+	void classifyObject(LifeObject* object, const LifeSeparateInfo* separateInfo)
+	{
+		std::string key;
+		if (separateInfo->cache)
+		{
+			key = cacheKey(&object->cells);
+			auto entry = separateInfo->cache->entries.find(key);
+			if (entry != separateInfo->cache->entries.end())
+			{
+				object->type = entry->second.type;
+				object->period = entry->second.period;
+				object->dx = entry->second.dx;
+				object->dy = entry->second.dy;
+				object->hash = entry->second.hash;
+				object->code = entry->second.code;
+				return;
+			}
+		}
+
+		uint32_t maxPeriod = separateInfo->maxPeriod == 0 ? 1 : separateInfo->maxPeriod;
+		uint32_t pad = maxPeriod + 2;
+		uint32_t width = object->cells.width + pad * 2, height = object->cells.height + pad * 2;
+
+		LifeGrid* grids[2];
+		createGrid(&grids[0], width, height);
+		createGrid(&grids[1], width, height);
+		pasteRegion(grids[0], &object->cells, (int32_t)pad, (int32_t)pad, Life_Blend_Replace);
+
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = separateInfo->rule;
+		stepInfo.topology = Life_Topology_Plane;
+		stepInfo.threadCount = 1;
+
+		LifeObjectClass result{};
+		result.type = Life_Object_Unknown;
+		result.code = "zz_UNKNOWN";
+
+		std::vector<LifeGrid> phases = { object->cells };
+		LifeGrid cells;
+
+		for (uint32_t period = 1; period <= maxPeriod; period++)
+		{
+			step(grids[0], grids[1], &stepInfo);
+			std::swap(grids[0], grids[1]);
+
+			int32_t x, y;
+			if (!cropGrid(grids[0], &cells, &x, &y)) break;
+			if (x == 0 || y == 0 || x + cells.width >= width || y + cells.height >= height) break;
+
+			if (cells.width == object->cells.width && cells.height == object->cells.height && cells.words == object->cells.words)
+			{
+				result.period = period;
+				result.dx = x - (int32_t)pad;
+				result.dy = y - (int32_t)pad;
+
+				if (result.dx == 0 && result.dy == 0)
+				{
+					result.type = period == 1 ? Life_Object_Still : Life_Object_Oscillator;
+					result.code = period == 1 ? "xs" + std::to_string(object->population) : "xp" + std::to_string(period);
+				}
+				else
+				{
+					result.type = Life_Object_Spaceship;
+					result.code = "xq" + std::to_string(period);
+				}
+
+				result.code += "_" + canonicalCode(phases);
+				break;
+			}
+
+			phases.push_back(cells);
+		}
+
+		destroyGrid(grids[0]);
+		destroyGrid(grids[1]);
+
+		result.hash = hashString(result.code);
+
+		if (separateInfo->cache)
+		{
+			if (separateInfo->cache->entries.size() >= OBJECTS_CACHE_LIMIT)
+				separateInfo->cache->entries.clear();
+			separateInfo->cache->entries[key] = result;
+		}
+
+		object->type = result.type;
+		object->period = result.period;
+		object->dx = result.dx;
+		object->dy = result.dy;
+		object->hash = result.hash;
+		object->code = result.code;
+	}
+
+	void separateObjects(const LifeGrid* grid, const LifeSeparateInfo* separateInfo, std::vector<LifeObject>* objects)
+	{
+		findObjects(grid, separateInfo->distance, objects);
+
+		bool failed = false;
+		for (LifeObject& object : *objects)
+		{
+			classifyObject(&object, separateInfo);
+			failed |= object.type == Life_Object_Unknown;
+		}
+
+		if (!failed) return;
+
+		// objects close enough to interact are only periodic together
+		std::vector<LifeObject> wide;
+		findObjects(grid, (separateInfo->distance == 0 ? 1 : separateInfo->distance) + 1, &wide);
+
+		auto contains = [](const LifeObject& outer, const LifeObject& inner)
+		{
+			int32_t x, y;
+			if (!firstCell(&inner.cells, &x, &y)) return false;
+			x += inner.x - outer.x;
+			y += inner.y - outer.y;
+			return x >= 0 && y >= 0 && x < (int32_t)outer.cells.width && y < (int32_t)outer.cells.height && getCell(&outer.cells, x, y);
+		};
+
+		// narrow objects by the row of their first cell, which is the top row of their bounding box
+		std::vector<std::vector<uint32_t>> rows(grid->height);
+		for (size_t i = 0; i < objects->size(); i++)
+			rows[(*objects)[i].y].push_back((uint32_t)i);
+
+		std::vector<LifeObject> merged;
+		std::vector<bool> replaced(objects->size(), false);
+		std::vector<uint32_t> inside;
+		for (LifeObject& candidate : wide)
+		{
+			bool needed = false;
+			inside.clear();
+			for (uint32_t y = candidate.y; y < candidate.y + candidate.cells.height; y++)
+			{
+				for (uint32_t i : rows[y])
+				{
+					if (!contains(candidate, (*objects)[i])) continue;
+					inside.push_back(i);
+					needed |= (*objects)[i].type == Life_Object_Unknown;
+				}
+			}
+			if (!needed) continue;
+
+			for (uint32_t i : inside)
+				replaced[i] = true;
+
+			classifyObject(&candidate, separateInfo);
+			merged.push_back(std::move(candidate));
+		}
+
+		for (size_t i = 0; i < objects->size(); i++)
+		{
+			if (!replaced[i])
+				merged.push_back(std::move((*objects)[i]));
+		}
+
+		*objects = std::move(merged);
+	}
+}
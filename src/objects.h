@@ -0,0 +1,50 @@
+#pragma once
+
+#include "life.h"
+
+#include <string>
+#include <vector>
+
+enum LifeObjectType
+{
+	Life_Object_Unknown,
+	Life_Object_Still,
+	Life_Object_Oscillator,
+	Life_Object_Spaceship,
+};
+
+struct LifeObject
+{
+	int32_t x, y;         // top left corner of the bounding box in the separated grid
+	LifeGrid cells;       // the object's live cells, cropped to its bounding box
+	uint32_t population;
+	LifeObjectType type;
+	uint32_t period;
+	int32_t dx, dy;       // displacement per period, non zero for spaceships only
+	uint64_t hash;        // identical for every phase, rotation and reflection of an object
+	std::string code;     // apgcode such as xs4_33 (block), xp2_7 (blinker) or xq4_153 (glider)
+};
+
+struct LifeObjectCache;
+
+struct LifeSeparateInfo
+{
+	LifeRule rule;
+	uint32_t distance;       // live cells within this chebyshev distance belong to the same object, 1 is 8-connected
+	uint32_t maxPeriod;      // longest period the classifier looks for
+	LifeObjectCache* cache;  // optional, remembers classified shapes between calls
+};
+
+namespace life
+{
+	LifeResult createObjectCache(LifeObjectCache** cache);
+	void       destroyObjectCache(LifeObjectCache* cache);
+
+	// splits the live cells of a plane into connected objects without classifying them
+	void       findObjects(const LifeGrid* grid, uint32_t distance, std::vector<LifeObject>* objects);
+	void       classifyObject(LifeObject* object, const LifeSeparateInfo* separateInfo);
+
+	// finds and classifies every object, objects that do not classify on their own are
+	// merged with their neighbours at distance + 1 and classified again
+	void       separateObjects(const LifeGrid* grid, const LifeSeparateInfo* separateInfo, std::vector<LifeObject>* objects);
+}
@@ -0,0 +1,314 @@
+#include "pattern.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+namespace life
+{
+	typedef std::vector<std::pair<uint32_t, uint32_t>> CellList;
+
+	static const char* nextLine(const char* text);
+	static bool headerValue(const char* line, const char* end, const char* name, std::string* value);
+	static LifeResult parseRle(const char* text, const char* header, CellList* cells, uint32_t* width, uint32_t* height, LifeRule* rule, bool* hasRule);
+	static void parsePlaintext(const char* text, CellList* cells, uint32_t* width, uint32_t* height);
+	static void appendRun(std::string* text, size_t* lineStart, uint32_t count, char tag);
+
+	static const char* nextLine(const char* text)
+	{
+		while (*text && *text != '\n') text++;
+		return *text ? text + 1 : text;
+	}
+
+	// finds "name = value" in an RLE header line, the value runs until the next comma
+	static bool headerValue(const char* line, const char* end, const char* name, std::string* value)
+	{
+		size_t length = strlen(name);
+		for (const char* c = line; c + length <= end; c++)
+		{
+			if (strncmp(c, name, length) != 0 || (c > line && isalnum((unsigned char)c[-1]))) continue;
+
+			const char* v = c + length;
+			while (v < end && isspace((unsigned char)*v)) v++;
+			if (v == end || *v != '=') continue;
+			v++;
+			while (v < end && isspace((unsigned char)*v)) v++;
+
+			const char* valueEnd = v;
+			while (valueEnd < end && *valueEnd != ',' && *valueEnd != '\r' && *valueEnd != '\n') valueEnd++;
+			while (valueEnd > v && isspace((unsigned char)valueEnd[-1])) valueEnd--;
+
+			value->assign(v, valueEnd);
+			return true;
+		}
+		return false;
+	}
+
+	static LifeResult parseRle(const char* text, const char* header, CellList* cells, uint32_t* width, uint32_t* height, LifeRule* rule, bool* hasRule)
+	{
+		const char* headerEnd = header;
+		while (*headerEnd && *headerEnd != '\n') headerEnd++;
+
+		std::string value;
+		if (headerValue(header, headerEnd, "x", &value)) *width = strtoul(value.c_str(), nullptr, 10);
+		if (headerValue(header, headerEnd, "y", &value)) *height = strtoul(value.c_str(), nullptr, 10);
+		if (headerValue(header, headerEnd, "rule", &value))
+		{
+			LifeRule parsed;
+			if (parseRule(value.c_str(), &parsed) == Life_Result_Failed)
+			{
+				printf("pattern: unsupported rule %s\n", value.c_str());
+				return Life_Result_Failed;
+			}
+			if (rule) *rule = parsed;
+			if (hasRule) *hasRule = true;
+		}
+
+		uint32_t x = 0, y = 0, count = 0;
+		for (const char* c = nextLine(header); *c && *c != '!'; c++)
+		{
+			if (*c == '#' && (c == text || c[-1] == '\n'))
+			{
+				c = nextLine(c) - 1;
+				continue;
+			}
+
+			if (isdigit((unsigned char)*c))
+			{
+				count = count * 10 + (*c - '0');
+				continue;
+			}
+
+			uint32_t run = count == 0 ? 1 : count;
+			count = 0;
+
+			if (*c == '$')
+			{
+				y += run;
+				x = 0;
+			}
+			else if (*c == 'b' || *c == '.')
+			{
+				x += run;
+			}
+			else if (isalpha((unsigned char)*c))
+			{
+				// multistate letters count as alive
+				for (uint32_t i = 0; i < run; i++)
+					cells->emplace_back(x++, y);
+			}
+		}
+
+		return Life_Result_Success;
+	}
+
+	static void parsePlaintext(const char* text, CellList* cells, uint32_t* width, uint32_t* height)
+	{
+		uint32_t y = 0;
+		for (const char* line = text; *line; line = nextLine(line))
+		{
+			if (*line == '!') continue;
+
+			uint32_t x = 0;
+			for (const char* c = line; *c && *c != '\n' && *c != '\r'; c++, x++)
+			{
+				if (*c == 'O' || *c == 'o' || *c == '*')
+					cells->emplace_back(x, y);
+			}
+
+			*width = std::max(*width, x);
+			y++;
+		}
+
+		// trailing blank lines are not part of the pattern
+		*height = 0;
+		for (const std::pair<uint32_t, uint32_t>& cell : *cells)
+			*height = std::max(*height, cell.second + 1);
+	}
+
+	// RLE lines are kept below 70 characters
+	static void appendRun(std::string* text, size_t* lineStart, uint32_t count, char tag)
+	{
+		char run[16];
+		int length = count > 1 ? snprintf(run, sizeof(run), "%u%c", count, tag) : snprintf(run, sizeof(run), "%c", tag);
+		if (text->size() - *lineStart + length > 70)
+		{
+			text->push_back('\n');
+			*lineStart = text->size();
+		}
+		text->append(run, length);
+	}
+
+	LifeResult parsePattern(const char* text, LifeGrid** grid, LifeRule* rule, bool* hasRule)
+	{
+		if (hasRule) *hasRule = false;
+
+		// RLE files start with an "x = m, y = n" header after their # comments
+		const char* header = nullptr;
+		for (const char* line = text; *line; line = nextLine(line))
+		{
+			const char* c = line;
+			while (*c == ' ' || *c == '\t') c++;
+			if (*c == '#' || *c == '\n' || *c == '\r') continue;
+
+			if (*c == 'x' && strchr(c, '=') && strchr(c, '=') < nextLine(c))
+				header = c;
+			break;
+		}
+
+		CellList cells;
+		uint32_t width = 0, height = 0;
+		if (header)
+		{
+			if (parseRle(text, header, &cells, &width, &height, rule, hasRule) == Life_Result_Failed)
+				return Life_Result_Failed;
+		}
+		else
+		{
+			parsePlaintext(text, &cells, &width, &height);
+		}
+
+		// the header size is a hint, cells outside of it still belong to the pattern
+		for (const std::pair<uint32_t, uint32_t>& cell : cells)
+		{
+			width = std::max(width, cell.first + 1);
+			height = std::max(height, cell.second + 1);
+		}
+
+		if (createGrid(grid, width, height) == Life_Result_Failed)
+		{
+			printf("pattern: pattern is empty\n");
+			return Life_Result_Failed;
+		}
+
+		for (const std::pair<uint32_t, uint32_t>& cell : cells)
+			setCell(*grid, cell.first, cell.second, true);
+
+		return Life_Result_Success;
+	}
+
+	LifeResult loadPattern(const char* path, LifeGrid** grid, LifeRule* rule, bool* hasRule)
+	{
+		LIFE_TRACE_SCOPE("io", "load pattern");
+		FILE* file = fopen(path, "rb");
+		if (!file)
+		{
+			printf("pattern: failed to open %s\n", path);
+			return Life_Result_Failed;
+		}
+
+		std::string text;
+		char buffer[4096];
+		size_t read;
+		while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+			text.append(buffer, read);
+		fclose(file);
+
+		return parsePattern(text.c_str(), grid, rule, hasRule);
+	}
+
+	LifeResult savePattern(const char* path, const LifeGrid* grid, const LifeRule* rule)
+	{
+		LIFE_TRACE_SCOPE("io", "save pattern");
+		char ruleName[64];
+		ruleString(rule, ruleName, sizeof(ruleName));
+
+		std::string text = "x = " + std::to_string(grid->width) + ", y = " + std::to_string(grid->height) + ", rule = " + ruleName + "\n";
+		size_t lineStart = text.size();
+
+		// dead cells at the end of a row are implied and empty rows fold into the count before $
+		uint32_t pendingRows = 0;
+		for (uint32_t y = 0; y < grid->height; y++)
+		{
+			const uint64_t* row = grid->words.data() + (size_t)y * grid->stride;
+			uint32_t x = 0, written = 0;
+			bool empty = true;
+			while (x < grid->width)
+			{
+				uint32_t w = x / LIFE_WORD_BITS;
+				uint64_t bits = row[w] >> (x % LIFE_WORD_BITS);
+				if (!bits)
+				{
+					// the rest of this word is dead, skip to the next live cell
+					uint32_t next = (w + 1) * LIFE_WORD_BITS;
+					while (next < grid->width && !row[next / LIFE_WORD_BITS]) next += LIFE_WORD_BITS;
+					if (next >= grid->width) break;
+					x = next;
+					continue;
+				}
+
+				uint32_t start = x + lowestBit64(bits);
+				uint32_t end = start;
+				while (end < grid->width && getCell(grid, end, y)) end++;
+
+				if (empty && pendingRows > 0)
+					appendRun(&text, &lineStart, pendingRows, '$');
+				pendingRows = 0;
+				empty = false;
+
+				if (start > written)
+					appendRun(&text, &lineStart, start - written, 'b');
+				appendRun(&text, &lineStart, end - start, 'o');
+				x = written = end;
+			}
+			pendingRows++;
+		}
+		appendRun(&text, &lineStart, 1, '!');
+		text.push_back('\n');
+
+		FILE* file = fopen(path, "wb");
+		if (!file)
+		{
+			printf("pattern: failed to write %s\n", path);
+			return Life_Result_Failed;
+		}
+
+		bool written = fwrite(text.data(), 1, text.size(), file) == text.size();
+		fclose(file);
+		return written ? Life_Result_Success : Life_Result_Failed;
+	}
+
+	void placePattern(LifeGrid* grid, const LifeGrid* pattern, int32_t x, int32_t y)
+	{
+		uint64_t lastMask = rowMask(grid);
+
+		for (uint32_t row = 0; row < pattern->height; row++)
+		{
+			int64_t gridY = (int64_t)y + row;
+			if (gridY < 0) continue;
+			if (gridY >= grid->height) break;
+
+			const uint64_t* src = pattern->words.data() + (size_t)row * pattern->stride;
+			uint64_t* dst = grid->words.data() + (size_t)gridY * grid->stride;
+
+			for (uint32_t w = 0; w < pattern->stride; w++)
+			{
+				int64_t position = (int64_t)x + (int64_t)w * LIFE_WORD_BITS;
+				uint64_t word = src[w];
+
+				// words starting left of the grid keep the bits that land inside it
+				if (position < 0)
+				{
+					if (position <= -LIFE_WORD_BITS) continue;
+					word >>= -position;
+					position = 0;
+				}
+
+				uint64_t first = (uint64_t)position / LIFE_WORD_BITS;
+				uint32_t shift = (uint32_t)(position % LIFE_WORD_BITS);
+				if (first >= grid->stride) break;
+
+				dst[first] |= word << shift;
+				if (shift != 0 && first + 1 < grid->stride)
+					dst[first + 1] |= word >> (LIFE_WORD_BITS - shift);
+			}
+
+			dst[grid->stride - 1] &= lastMask;
+		}
+	}
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "life.h"
+
+#include <string>
+
+namespace life
+{
+	// reads RLE (.rle) or plaintext (.cells) patterns, the grid is cropped to the pattern and
+	// rule is only written when the file names one, hasRule tells whether it did (both optional)
+	LifeResult parsePattern(const char* text, LifeGrid** grid, LifeRule* rule, bool* hasRule);
+	LifeResult loadPattern(const char* path, LifeGrid** grid, LifeRule* rule, bool* hasRule);
+	// writes the whole grid as RLE, the header keeps its size so loading it restores every cell's position
+	LifeResult savePattern(const char* path, const LifeGrid* grid, const LifeRule* rule);
+
+	// ors the live cells of pattern into grid with its top left corner at (x, y), cells
+	// falling outside grid are dropped
+	void       placePattern(LifeGrid* grid, const LifeGrid* pattern, int32_t x, int32_t y);
+}
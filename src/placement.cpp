@@ -0,0 +1,137 @@
+#include "placement.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define LIFE_PLACEMENT_SUPPORTED
+#endif
+
+#define PLACEMENT_HUGE_PAGE (2u << 20)
+#define PLACEMENT_CHUNK_BYTES (2u << 20) // copied out, dropped and touched again at a time
+#define PLACEMENT_SAMPLES 4096
+
+namespace life
+{
+#ifdef LIFE_PLACEMENT_SUPPORTED
+	static uint32_t nodeCount();
+	static uint64_t hugePageBytes(uintptr_t begin, uintptr_t end);
+
+	static uint32_t nodeCount()
+	{
+		uint32_t count = 0;
+		for (;; count++)
+		{
+			char path[64];
+			snprintf(path, sizeof(path), "/sys/devices/system/node/node%u", count);
+			if (access(path, F_OK) != 0) break;
+		}
+		return std::max<uint32_t>(count, 1);
+	}
+
+	// the huge pages of every mapping overlapping [begin, end), at most the size of the range
+	static uint64_t hugePageBytes(uintptr_t begin, uintptr_t end)
+	{
+		FILE* file = fopen("/proc/self/smaps", "r");
+		if (!file) return 0;
+
+		char line[256];
+		uint64_t bytes = 0;
+		bool overlaps = false;
+		while (fgets(line, sizeof(line), file))
+		{
+			unsigned long first, last, kilobytes;
+			if (sscanf(line, "%lx-%lx ", &first, &last) == 2)
+				overlaps = first < end && last > begin;
+			else if (overlaps && sscanf(line, "AnonHugePages: %lu kB", &kilobytes) == 1)
+				bytes += (uint64_t)kilobytes * 1024;
+		}
+		fclose(file);
+		return std::min<uint64_t>(bytes, end - begin);
+	}
+
+	LifeResult placeGrid(LifeGrid* grid, uint32_t threadCount, bool hugePages)
+	{
+		LIFE_TRACE_SCOPE("sim", "place grid");
+		uintptr_t begin = (uintptr_t)grid->words.data();
+		uintptr_t end = begin + grid->words.size() * sizeof(uint64_t);
+		size_t rowBytes = (size_t)grid->stride * sizeof(uint64_t);
+
+		// huge pages are only ever whole 2 MB aligned pages inside the words
+		size_t granule = (size_t)sysconf(_SC_PAGESIZE);
+		if (hugePages)
+		{
+			uintptr_t first = (begin + PLACEMENT_HUGE_PAGE - 1) / PLACEMENT_HUGE_PAGE * PLACEMENT_HUGE_PAGE;
+			uintptr_t last = end / PLACEMENT_HUGE_PAGE * PLACEMENT_HUGE_PAGE;
+			if (last > first && madvise((void*)first, last - first, MADV_HUGEPAGE) != 0)
+				printf("placement: transparent huge pages are not available, using normal pages\n");
+			else
+				granule = PLACEMENT_HUGE_PAGE;
+		}
+
+		// a worker drops only the pages wholly inside its rows, which are faulted in again on its
+		// node as it writes the cells back, a page shared with the next range stays where it is
+		parallelFor(grid->height, threadCount, [&](uint32_t firstRow, uint32_t lastRow)
+		{
+			uintptr_t first = (begin + firstRow * rowBytes + granule - 1) / granule * granule;
+			uintptr_t last = (begin + lastRow * rowBytes) / granule * granule;
+
+			static thread_local std::vector<uint8_t> saved;
+			saved.resize(PLACEMENT_CHUNK_BYTES);
+			for (uintptr_t chunk = first; chunk < last; chunk += PLACEMENT_CHUNK_BYTES)
+			{
+				size_t size = std::min<size_t>(PLACEMENT_CHUNK_BYTES, last - chunk);
+				memcpy(saved.data(), (void*)chunk, size);
+				madvise((void*)chunk, size, MADV_DONTNEED);
+				memcpy((void*)chunk, saved.data(), size);
+			}
+		});
+		return Life_Result_Success;
+	}
+
+	void gridPlacement(const LifeGrid* grid, LifePlacementReport* report)
+	{
+		*report = LifePlacementReport{};
+		report->nodeCount = nodeCount();
+
+		uintptr_t begin = (uintptr_t)grid->words.data();
+		uintptr_t end = begin + grid->words.size() * sizeof(uint64_t);
+		report->hugePageBytes = hugePageBytes(begin, end);
+
+		// move_pages without target nodes only reports where each page is
+		size_t pageSize = (size_t)sysconf(_SC_PAGESIZE);
+		uint64_t pageCount = (end - begin + pageSize - 1) / pageSize;
+		uint64_t samples = std::min<uint64_t>(pageCount, PLACEMENT_SAMPLES);
+		std::vector<void*> pages(samples);
+		std::vector<int> status(samples, -1);
+		for (uint64_t i = 0; i < samples; i++)
+			pages[i] = (void*)((begin + i * pageCount / samples * pageSize) / pageSize * pageSize);
+
+		report->sampledPages = samples;
+		if (samples == 0 || syscall(SYS_move_pages, 0, (unsigned long)samples, pages.data(), nullptr, status.data(), 0) != 0)
+			return;
+		for (int node : status)
+		{
+			if (node >= 0 && node < LIFE_MAX_NODES)
+				report->nodePages[node]++;
+		}
+	}
+#else
+	LifeResult placeGrid(LifeGrid* grid, uint32_t threadCount, bool hugePages)
+	{
+		return Life_Result_Success;
+	}
+
+	void gridPlacement(const LifeGrid* grid, LifePlacementReport* report)
+	{
+		*report = LifePlacementReport{};
+		report->nodeCount = 1;
+	}
+#endif
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "life.h"
+
+#define LIFE_MAX_NODES 8
+
+// where the pages of a grid's words live, sampled rather than walked page by page
+struct LifePlacementReport
+{
+	uint32_t nodeCount;                 // NUMA nodes, 1 on machines without them or platforms that cannot tell
+	uint64_t sampledPages;              // pages asked about, those never touched count towards no node
+	uint64_t nodePages[LIFE_MAX_NODES]; // sampled pages resident on each node
+	uint64_t hugePageBytes;             // of the words backed by transparent huge pages
+};
+
+namespace life
+{
+	// asks for the words to be backed by 2 MB transparent huge pages and hands every range of
+	// rows a threadCount step gives to one worker to that worker to touch first, so with
+	// setThreadPinning each band lives on the node of the CPU that steps it, the cells are kept,
+	// Linux only, elsewhere the grid is left as it is
+	LifeResult placeGrid(LifeGrid* grid, uint32_t threadCount, bool hugePages);
+	void       gridPlacement(const LifeGrid* grid, LifePlacementReport* report);
+}
@@ -0,0 +1,137 @@
+#include "planes.h"
+#include "trace.h"
+
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LIFE_PLANES_SSE2
+#endif
+
+#define PLANES_ACTIVITY_BUMP  64 // activity a birth or death adds
+#define PLANES_ACTIVITY_DECAY 3  // activity loses activity >> PLANES_ACTIVITY_DECAY each generation
+
+// rows are padded to whole words of cells so the update never needs a tail case
+struct LifeCellPlanes
+{
+	uint32_t width, height;
+	uint32_t rowBytes;
+	std::vector<uint8_t> ages;
+	std::vector<uint8_t> activity;
+};
+
+namespace life
+{
+	static void updateWord(uint8_t* ages, uint8_t* activity, uint64_t alive, uint64_t changed);
+
+#ifdef LIFE_PLANES_SSE2
+	static __m128i expandBits(uint32_t bits);
+
+	// byte i of the result is 0xFF when bit i of the 16 bits is set
+	static __m128i expandBits(uint32_t bits)
+	{
+		const __m128i select = _mm_set1_epi64x((long long)0x8040201008040201ull);
+		__m128i spread = _mm_set_epi64x((long long)((bits >> 8 & 0xFF) * 0x0101010101010101ull), (long long)((bits & 0xFF) * 0x0101010101010101ull));
+		return _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+	}
+
+	// sixteen cells at a time, saturating adds keep both planes from wrapping
+	static void updateWord(uint8_t* ages, uint8_t* activity, uint64_t alive, uint64_t changed)
+	{
+		const __m128i one = _mm_set1_epi8(1);
+		const __m128i bump = _mm_set1_epi8(PLANES_ACTIVITY_BUMP);
+		const __m128i low = _mm_set1_epi8((char)(0xFF >> PLANES_ACTIVITY_DECAY));
+
+		for (uint32_t i = 0; i < LIFE_WORD_BITS; i += 16)
+		{
+			__m128i age = _mm_loadu_si128((const __m128i*)(ages + i));
+			age = _mm_and_si128(_mm_adds_epu8(age, one), expandBits((uint32_t)(alive >> i)));
+			_mm_storeu_si128((__m128i*)(ages + i), age);
+
+			// there is no byte shift, shifting 16 bit lanes and masking off what crossed over is the same
+			__m128i heat = _mm_loadu_si128((const __m128i*)(activity + i));
+			heat = _mm_subs_epu8(heat, _mm_and_si128(_mm_srli_epi16(heat, PLANES_ACTIVITY_DECAY), low));
+			heat = _mm_adds_epu8(heat, _mm_and_si128(bump, expandBits((uint32_t)(changed >> i))));
+			_mm_storeu_si128((__m128i*)(activity + i), heat);
+		}
+	}
+#else
+	static void updateWord(uint8_t* ages, uint8_t* activity, uint64_t alive, uint64_t changed)
+	{
+		for (uint32_t i = 0; i < LIFE_WORD_BITS; i++)
+		{
+			ages[i] = (alive >> i & 1) ? (ages[i] == 255 ? 255 : ages[i] + 1) : 0;
+
+			uint32_t heat = activity[i] - (activity[i] >> PLANES_ACTIVITY_DECAY);
+			if (changed >> i & 1) heat += PLANES_ACTIVITY_BUMP;
+			activity[i] = heat > 255 ? 255 : (uint8_t)heat;
+		}
+	}
+#endif
+
+	LifeResult createCellPlanes(LifeCellPlanes** planes, uint32_t width, uint32_t height)
+	{
+		if (width == 0 || height == 0)
+			return Life_Result_Failed;
+
+		LifeCellPlanes* result = new LifeCellPlanes();
+		result->width = width;
+		result->height = height;
+		result->rowBytes = (width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS * LIFE_WORD_BITS;
+		result->ages.assign((size_t)result->rowBytes * height, 0);
+		result->activity.assign((size_t)result->rowBytes * height, 0);
+
+		*planes = result;
+		return Life_Result_Success;
+	}
+
+	void destroyCellPlanes(LifeCellPlanes* planes)
+	{
+		delete planes;
+	}
+
+	void syncCellPlanes(LifeCellPlanes* planes, const LifeGrid* grid)
+	{
+		if (grid->width != planes->width || grid->height != planes->height)
+			return;
+
+		for (uint32_t y = 0; y < grid->height; y++)
+		{
+			const uint64_t* row = grid->words.data() + (size_t)y * grid->stride;
+			uint8_t* ages = planes->ages.data() + (size_t)y * planes->rowBytes;
+			for (uint32_t x = 0; x < grid->width; x++)
+			{
+				bool alive = row[x / LIFE_WORD_BITS] >> (x % LIFE_WORD_BITS) & 1;
+				ages[x] = alive ? (ages[x] == 0 ? 1 : ages[x]) : 0;
+			}
+		}
+	}
+
+	void updateCellPlanes(LifeCellPlanes* planes, const LifeGrid* before, const LifeGrid* after, uint32_t threadCount)
+	{
+		if (after->width != planes->width || after->height != planes->height || before->words.size() != after->words.size())
+			return;
+		LIFE_TRACE_SCOPE("sim", "planes");
+
+		// the birth and death masks are the xor of the two generations, a word at a time
+		parallelFor(after->height, threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			for (uint32_t y = begin; y < end; y++)
+			{
+				const uint64_t* old = before->words.data() + (size_t)y * after->stride;
+				const uint64_t* now = after->words.data() + (size_t)y * after->stride;
+				uint8_t* ages = planes->ages.data() + (size_t)y * planes->rowBytes;
+				uint8_t* activity = planes->activity.data() + (size_t)y * planes->rowBytes;
+				for (uint32_t w = 0; w < after->stride; w++)
+					updateWord(ages + w * LIFE_WORD_BITS, activity + w * LIFE_WORD_BITS, now[w], now[w] ^ old[w]);
+			}
+		});
+	}
+
+	void cellPlanes(const LifeCellPlanes* planes, const uint8_t** ages, const uint8_t** activity, uint32_t* rowBytes)
+	{
+		*ages = planes->ages.data();
+		*activity = planes->activity.data();
+		*rowBytes = planes->rowBytes;
+	}
+}
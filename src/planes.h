@@ -0,0 +1,22 @@
+#pragma once
+
+#include "life.h"
+
+// per-cell byte planes kept beside a grid, the step kernel never touches them
+struct LifeCellPlanes;
+
+namespace life
+{
+	LifeResult createCellPlanes(LifeCellPlanes** planes, uint32_t width, uint32_t height);
+	void       destroyCellPlanes(LifeCellPlanes* planes);
+
+	// brings the ages in line with an edited or restored grid, live cells age at least 1 and
+	// dead cells 0, the activity is kept
+	void       syncCellPlanes(LifeCellPlanes* planes, const LifeGrid* grid);
+	// before and after are consecutive generations, live cells age by one and every cell that
+	// was born or died adds to its activity, which decays by an eighth each generation
+	void       updateCellPlanes(LifeCellPlanes* planes, const LifeGrid* before, const LifeGrid* after, uint32_t threadCount);
+
+	// rows of rowBytes bytes, one byte per cell, both saturate at 255
+	void       cellPlanes(const LifeCellPlanes* planes, const uint8_t** ages, const uint8_t** activity, uint32_t* rowBytes);
+}
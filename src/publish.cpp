@@ -0,0 +1,350 @@
+#include "publish.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <new>
+#include <thread>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIFE_SHM_SUPPORTED
+#endif
+
+#define PUBLISH_MAGIC 0x6367676F6C707562ull // "cgolpub"
+#define PUBLISH_ALIGN 64
+#define PUBLISH_RETRIES 4096                // torn reads before a viewer gives up on a frame
+
+// the header is followed by height rows of stride words, the sequence is odd while the
+// producer is copying and a reader keeps its copy only if the sequence did not move
+struct PublishHeader
+{
+	uint64_t magic;
+	uint64_t size;
+	uint32_t width, height, stride;
+	std::atomic<uint32_t> closed;
+	int64_t producer; // pid of the publishing process
+	alignas(PUBLISH_ALIGN) std::atomic<uint64_t> sequence;
+	std::atomic<uint64_t> generation;
+};
+
+struct LifePublisher
+{
+	char name[256];
+	uint8_t* base;
+	size_t size;
+	std::chrono::milliseconds interval;
+	std::chrono::steady_clock::time_point lastPublish;
+	bool published;
+};
+
+struct LifeViewer
+{
+	char name[256];
+	uint8_t* base;
+	size_t size;
+	std::vector<uint64_t> rows; // words of the viewport read under one sequence
+};
+
+namespace life
+{
+#ifdef LIFE_SHM_SUPPORTED
+	static size_t headerSize();
+	static PublishHeader* publishHeader(uint8_t* base);
+	static bool abandonedSegment(const char* name);
+	static uint64_t wordAt(const uint64_t* words, int64_t first, int64_t count, int64_t index);
+	static uint64_t bitsAt(const uint64_t* words, int64_t first, int64_t count, int64_t start);
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory counters need lock free atomics");
+
+	static size_t headerSize()
+	{
+		return (sizeof(PublishHeader) + PUBLISH_ALIGN - 1) / PUBLISH_ALIGN * PUBLISH_ALIGN;
+	}
+
+	static PublishHeader* publishHeader(uint8_t* base)
+	{
+		return (PublishHeader*)base;
+	}
+
+	// a segment whose publisher closed it or died, viewers still holding it keep its last frame
+	static bool abandonedSegment(const char* name)
+	{
+		int fd = shm_open(name, O_RDONLY, 0);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < headerSize())
+		{
+			if (fd >= 0) close(fd);
+			return false;
+		}
+
+		void* base = mmap(nullptr, headerSize(), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+			return false;
+
+		const PublishHeader* header = publishHeader((uint8_t*)base);
+		bool abandoned = header->magic == PUBLISH_MAGIC &&
+			(header->closed.load(std::memory_order_acquire) != 0 || (kill((pid_t)header->producer, 0) != 0 && errno == ESRCH));
+		munmap(base, headerSize());
+		return abandoned;
+	}
+
+	// words [first, first + count) of a row are held in words, everything else reads as dead
+	static uint64_t wordAt(const uint64_t* words, int64_t first, int64_t count, int64_t index)
+	{
+		index -= first;
+		return index >= 0 && index < count ? words[index] : 0;
+	}
+
+	// the 64 cells starting at column start, which may lie left of the universe
+	static uint64_t bitsAt(const uint64_t* words, int64_t first, int64_t count, int64_t start)
+	{
+		int64_t index = start >= 0 ? start / LIFE_WORD_BITS : -((-start + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS);
+		uint32_t shift = (uint32_t)(start - index * LIFE_WORD_BITS);
+
+		uint64_t low = wordAt(words, first, count, index);
+		if (shift == 0) return low;
+		return (low >> shift) | (wordAt(words, first, count, index + 1) << (LIFE_WORD_BITS - shift));
+	}
+
+	LifeResult createPublisher(LifePublisher** publisher, const char* name, const LifePublishInfo* publishInfo)
+	{
+		if (publishInfo->width == 0 || publishInfo->height == 0 || strlen(name) + 2 > sizeof(LifePublisher::name))
+			return Life_Result_Failed;
+
+		LifePublisher* result = new LifePublisher();
+		snprintf(result->name, sizeof(result->name), "%s%s", name[0] == '/' ? "" : "/", name);
+		result->interval = std::chrono::milliseconds(publishInfo->interval);
+		result->published = false;
+
+		uint32_t stride = (publishInfo->width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS;
+		result->size = headerSize() + (size_t)stride * publishInfo->height * sizeof(uint64_t);
+
+		int fd = shm_open(result->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+		if (fd < 0 && errno == EEXIST && abandonedSegment(result->name))
+		{
+			shm_unlink(result->name);
+			fd = shm_open(result->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+		}
+		if (fd < 0 && errno == EEXIST)
+		{
+			printf("publish: shared memory %s belongs to another run\n", result->name);
+			delete result;
+			return Life_Result_Failed;
+		}
+		if (fd < 0 || ftruncate(fd, result->size) != 0)
+		{
+			printf("publish: failed to create shared memory %s\n", result->name);
+			if (fd >= 0) { close(fd); shm_unlink(result->name); }
+			delete result;
+			return Life_Result_Failed;
+		}
+
+		void* base = mmap(nullptr, result->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+		{
+			printf("publish: failed to map shared memory %s\n", result->name);
+			shm_unlink(result->name);
+			delete result;
+			return Life_Result_Failed;
+		}
+		result->base = (uint8_t*)base;
+
+		PublishHeader* header = new (result->base) PublishHeader();
+		header->size = result->size;
+		header->width = publishInfo->width;
+		header->height = publishInfo->height;
+		header->stride = stride;
+		header->closed.store(0);
+		header->producer = getpid();
+		header->sequence.store(0);
+		header->generation.store(0);
+
+		// viewers check the magic last so they never see a half built segment
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic = PUBLISH_MAGIC;
+
+		*publisher = result;
+		return Life_Result_Success;
+	}
+
+	void destroyPublisher(LifePublisher* publisher)
+	{
+		publishHeader(publisher->base)->closed.store(1, std::memory_order_release);
+		munmap(publisher->base, publisher->size);
+		shm_unlink(publisher->name);
+		delete publisher;
+	}
+
+	void publishGrid(LifePublisher* publisher, const LifeGrid* grid, uint64_t generation, bool force)
+	{
+		PublishHeader* header = publishHeader(publisher->base);
+		if (grid->width != header->width || grid->height != header->height)
+			return;
+
+		auto now = std::chrono::steady_clock::now();
+		if (!force && publisher->published && now - publisher->lastPublish < publisher->interval)
+			return;
+		publisher->lastPublish = now;
+		publisher->published = true;
+		LIFE_TRACE_SCOPE("io", "publish");
+
+		// the producer never waits, a reader that overlaps the copy sees the sequence move and retries
+		uint64_t sequence = header->sequence.load(std::memory_order_relaxed);
+		header->sequence.store(sequence + 1, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_release);
+
+		std::copy(grid->words.begin(), grid->words.end(), (uint64_t*)(publisher->base + headerSize()));
+		header->generation.store(generation, std::memory_order_relaxed);
+
+		header->sequence.store(sequence + 2, std::memory_order_release);
+	}
+
+	LifeResult attachViewer(LifeViewer** viewer, const char* name)
+	{
+		if (strlen(name) + 2 > sizeof(LifeViewer::name))
+			return Life_Result_Failed;
+
+		LifeViewer* result = new LifeViewer();
+		snprintf(result->name, sizeof(result->name), "%s%s", name[0] == '/' ? "" : "/", name);
+
+		// mapped read only, a viewer has no way to disturb the simulation it watches
+		int fd = shm_open(result->name, O_RDONLY, 0);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < headerSize())
+		{
+			printf("publish: no simulation is publishing %s\n", result->name);
+			if (fd >= 0) close(fd);
+			delete result;
+			return Life_Result_Failed;
+		}
+
+		result->size = info.st_size;
+		void* base = mmap(nullptr, result->size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+		{
+			printf("publish: failed to map shared memory %s\n", result->name);
+			delete result;
+			return Life_Result_Failed;
+		}
+		result->base = (uint8_t*)base;
+
+		PublishHeader* header = publishHeader(result->base);
+		if (header->magic != PUBLISH_MAGIC || header->size != result->size)
+		{
+			printf("publish: %s is not a published cgol universe\n", result->name);
+			munmap(result->base, result->size);
+			delete result;
+			return Life_Result_Failed;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		*viewer = result;
+		return Life_Result_Success;
+	}
+
+	void detachViewer(LifeViewer* viewer)
+	{
+		munmap(viewer->base, viewer->size);
+		delete viewer;
+	}
+
+	void viewerSize(const LifeViewer* viewer, uint32_t* width, uint32_t* height)
+	{
+		const PublishHeader* header = publishHeader(viewer->base);
+		*width = header->width;
+		*height = header->height;
+	}
+
+	bool viewerLive(const LifeViewer* viewer)
+	{
+		return publishHeader(viewer->base)->closed.load(std::memory_order_acquire) == 0;
+	}
+
+	LifeResult readViewport(LifeViewer* viewer, int32_t x, int32_t y, LifeGrid* grid, uint64_t* generation)
+	{
+		const PublishHeader* header = publishHeader(viewer->base);
+		const uint64_t* words = (const uint64_t*)(viewer->base + headerSize());
+
+		// rows and words of the universe the viewport overlaps
+		int64_t firstRow = std::max<int64_t>(y, 0);
+		int64_t lastRow = std::min<int64_t>((int64_t)y + grid->height, header->height);
+		int64_t firstWord = std::max<int64_t>(x, 0) / LIFE_WORD_BITS;
+		int64_t lastWord = std::min<int64_t>(((int64_t)x + grid->width + LIFE_WORD_BITS - 1) / LIFE_WORD_BITS, header->stride);
+		int64_t rowCount = std::max<int64_t>(lastRow - firstRow, 0);
+		int64_t wordCount = std::max<int64_t>(lastWord - firstWord, 0);
+
+		viewer->rows.resize((size_t)(rowCount * wordCount));
+
+		uint64_t published = 0;
+		bool consistent = false;
+		for (uint32_t attempt = 0; attempt < PUBLISH_RETRIES && !consistent; attempt++)
+		{
+			uint64_t before = header->sequence.load(std::memory_order_acquire);
+			if (before & 1)
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			for (int64_t row = 0; row < rowCount; row++)
+			{
+				const uint64_t* source = words + (size_t)(firstRow + row) * header->stride + firstWord;
+				std::copy(source, source + wordCount, viewer->rows.begin() + row * wordCount);
+			}
+			published = header->generation.load(std::memory_order_relaxed);
+
+			std::atomic_thread_fence(std::memory_order_acquire);
+			consistent = header->sequence.load(std::memory_order_relaxed) == before;
+		}
+
+		if (!consistent)
+			return Life_Result_Failed;
+
+		clearGrid(grid);
+		for (int64_t row = 0; row < rowCount; row++)
+		{
+			const uint64_t* source = viewer->rows.data() + row * wordCount;
+			uint64_t* target = grid->words.data() + (size_t)(firstRow + row - y) * grid->stride;
+			for (uint32_t w = 0; w < grid->stride; w++)
+				target[w] = bitsAt(source, firstWord, wordCount, (int64_t)x + (int64_t)w * LIFE_WORD_BITS);
+			target[grid->stride - 1] &= rowMask(grid);
+		}
+
+		*generation = published;
+		return Life_Result_Success;
+	}
+#else
+	LifeResult createPublisher(LifePublisher** publisher, const char* name, const LifePublishInfo* publishInfo)
+	{
+		printf("publish: shared memory needs a POSIX system\n");
+		return Life_Result_Failed;
+	}
+
+	void destroyPublisher(LifePublisher* publisher) {}
+	void publishGrid(LifePublisher* publisher, const LifeGrid* grid, uint64_t generation, bool force) {}
+
+	LifeResult attachViewer(LifeViewer** viewer, const char* name)
+	{
+		printf("publish: shared memory needs a POSIX system\n");
+		return Life_Result_Failed;
+	}
+
+	void detachViewer(LifeViewer* viewer) {}
+	void viewerSize(const LifeViewer* viewer, uint32_t* width, uint32_t* height) { *width = *height = 0; }
+	bool viewerLive(const LifeViewer* viewer) { return false; }
+	LifeResult readViewport(LifeViewer* viewer, int32_t x, int32_t y, LifeGrid* grid, uint64_t* generation) { return Life_Result_Failed; }
+#endif
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "life.h"
+
+// a running simulation copies its state into a named shared memory segment guarded by a
+// seqlock, viewers map it read only so attaching or detaching never touches the producer
+struct LifePublisher;
+struct LifeViewer;
+
+struct LifePublishInfo
+{
+	uint32_t width, height;
+	uint32_t interval; // milliseconds between copies, publishing more often is skipped
+};
+
+namespace life
+{
+	// POSIX systems only
+	LifeResult createPublisher(LifePublisher** publisher, const char* name, const LifePublishInfo* publishInfo);
+	void       destroyPublisher(LifePublisher* publisher);
+	// copies grid unless the last copy is younger than the interval, force always copies
+	void       publishGrid(LifePublisher* publisher, const LifeGrid* grid, uint64_t generation, bool force);
+
+	LifeResult attachViewer(LifeViewer** viewer, const char* name);
+	void       detachViewer(LifeViewer* viewer);
+	void       viewerSize(const LifeViewer* viewer, uint32_t* width, uint32_t* height);
+	// false once the producer has exited, the last published state stays readable
+	bool       viewerLive(const LifeViewer* viewer);
+	// copies the cells of the published state starting at (x, y) into grid, only the words
+	// covering that window are read and cells outside the universe read as dead
+	LifeResult readViewport(LifeViewer* viewer, int32_t x, int32_t y, LifeGrid* grid, uint64_t* generation);
+}
@@ -0,0 +1,112 @@
+#include "settle.h"
+
+#include <utility>
+
+namespace life
+{
+	static bool touchesEdge(const LifeGrid* grid);
+
+	static bool touchesEdge(const LifeGrid* grid)
+	{
+		const uint64_t* words = grid->words.data();
+		const uint64_t* lastRow = words + (size_t)(grid->height - 1) * grid->stride;
+		for (uint32_t w = 0; w < grid->stride; w++)
+		{
+			if (words[w] | lastRow[w])
+				return true;
+		}
+
+		uint32_t lastWord = grid->stride - 1, lastBit = (grid->width - 1) % LIFE_WORD_BITS;
+		for (uint32_t y = 0; y < grid->height; y++)
+		{
+			const uint64_t* row = words + (size_t)y * grid->stride;
+			if ((row[0] & 1) | ((row[lastWord] >> lastBit) & 1))
+				return true;
+		}
+
+		return false;
+	}
+
+	LifeResult runUntilStable(LifeGrid* grid, const LifeSettleInfo* settleInfo, LifeSettleResult* result)
+	{
+		LifeGrid *current, *next;
+		if (createGrid(&current, grid->width, grid->height) == Life_Result_Failed ||
+			createGrid(&next, grid->width, grid->height) == Life_Result_Failed)
+			return Life_Result_Failed;
+
+		LifeCycleDetector* detector;
+		if (createCycleDetector(&detector, settleInfo->history) == Life_Result_Failed)
+		{
+			destroyGrid(current);
+			destroyGrid(next);
+			return Life_Result_Failed;
+		}
+
+		// an empty grid always hashes the same, comparing against it spots extinction without a population count
+		uint64_t emptyHash = hashGrid(current);
+		current->words = grid->words;
+
+		uint64_t hash = hashGrid(current);
+		LifeStepInfo stepInfo{};
+		stepInfo.rule = settleInfo->rule;
+		stepInfo.topology = settleInfo->topology;
+		stepInfo.threadCount = settleInfo->threadCount;
+		stepInfo.hash = &hash;
+
+		*result = LifeSettleResult{};
+		result->state = Life_Settle_Unsettled;
+		result->generation = settleInfo->maxGenerations;
+
+		LifeCycle cycle;
+		for (uint64_t gen = 0;; gen++)
+		{
+			if (settleInfo->topology == Life_Topology_Plane && !result->reachedEdge && touchesEdge(current))
+			{
+				result->reachedEdge = true;
+				result->edgeGeneration = gen;
+			}
+
+			if (hash == emptyHash && population(current) == 0)
+			{
+				result->state = Life_Settle_Dies;
+				result->generation = gen;
+				result->period = 1;
+				break;
+			}
+
+			if (recordCycle(detector, gen, hash, &cycle))
+			{
+				result->state = cycle.period == 1 ? Life_Settle_Still : Life_Settle_Periodic;
+				result->generation = cycle.generation;
+				result->period = cycle.period;
+				break;
+			}
+
+			if (gen == settleInfo->maxGenerations) break;
+
+			step(current, next, &stepInfo);
+			std::swap(current, next);
+		}
+
+		result->population = population(current);
+		std::swap(grid->words, current->words);
+
+		destroyCycleDetector(detector);
+		destroyGrid(current);
+		destroyGrid(next);
+
+		return Life_Result_Success;
+	}
+
+	const char* settleStateName(LifeSettleState state)
+	{
+		switch (state)
+		{
+		case Life_Settle_Dies:      return "dies";
+		case Life_Settle_Still:     return "still";
+		case Life_Settle_Periodic:  return "periodic";
+		case Life_Settle_Unsettled: return "unsettled";
+		}
+		return "unknown";
+	}
+}
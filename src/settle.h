@@ -0,0 +1,37 @@
+#pragma once
+
+#include "life.h"
+
+enum LifeSettleState
+{
+	Life_Settle_Dies,
+	Life_Settle_Still,
+	Life_Settle_Periodic,
+	Life_Settle_Unsettled, // still changing when the generation cap was reached
+};
+
+struct LifeSettleInfo
+{
+	LifeRule rule;
+	LifeTopology topology;
+	uint64_t maxGenerations;
+	uint32_t history;     // generations of state hashes kept, longer periods are not detected
+	uint32_t threadCount; // 0 uses every hardware thread
+};
+
+struct LifeSettleResult
+{
+	LifeSettleState state;
+	uint64_t generation; // first generation of the final still, periodic or empty state
+	uint64_t period;     // 1 for still lifes and empty grids
+	uint64_t population;
+	bool reachedEdge;        // live cells touched the border of a plane, the result may differ from an unbounded universe
+	uint64_t edgeGeneration; // first generation with a live cell on the border
+};
+
+namespace life
+{
+	// steps grid until it dies, becomes still or periodic, grid is left at the last generation stepped
+	LifeResult  runUntilStable(LifeGrid* grid, const LifeSettleInfo* settleInfo, LifeSettleResult* result);
+	const char* settleStateName(LifeSettleState state);
+}
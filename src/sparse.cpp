@@ -0,0 +1,424 @@
+#include "sparse.h"
+#include "trace.h"
+
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+
+#define SPARSE_TILE_SIZE LIFE_WORD_BITS // a tile is one word wide and as many rows high
+#define SPARSE_MIN_TABLE 64
+
+// the free list of the arena overlays the first word, which is rewritten on allocation
+struct SparseTile
+{
+	int32_t x, y;   // the tile holds cells x * 64 .. x * 64 + 63 and likewise rows
+	uint8_t needs;  // neighbours, by SparseDirection bit, its live edge cells reach after the last step
+	uint64_t rows[2][SPARSE_TILE_SIZE]; // the current generation is rows[generation & 1]
+};
+
+struct SparseSlot
+{
+	uint64_t key;
+	SparseTile* tile; // null for an empty slot
+};
+
+// open addressed table of tile coordinates to tiles, linear probing, grown by doubling
+struct LifeSparseGrid
+{
+	LifeTileArena* arena;
+	std::vector<SparseSlot> table;
+	uint32_t mask, count;
+	std::vector<SparseTile*> tiles; // every tile in the table, in no particular order
+	std::vector<SparseTile*> freed; // tiles reclaimed by the last step, reused between steps
+	std::vector<uint8_t> empty;
+	uint64_t generation;
+	uint64_t population;
+};
+
+namespace life
+{
+	enum SparseDirection
+	{
+		Sparse_North, Sparse_NorthEast, Sparse_East, Sparse_SouthEast,
+		Sparse_South, Sparse_SouthWest, Sparse_West, Sparse_NorthWest,
+	};
+
+	static const int32_t s_DirectionX[8] = { 0, 1, 1, 1, 0, -1, -1, -1 };
+	static const int32_t s_DirectionY[8] = { -1, -1, 0, 1, 1, 1, 0, -1 };
+
+	static uint64_t tileKey(int32_t x, int32_t y);
+	static int32_t tileCoordinate(int64_t cell);
+	static uint32_t findSlot(const LifeSparseGrid* grid, uint64_t key);
+	static SparseTile* findTile(const LifeSparseGrid* grid, int32_t x, int32_t y);
+	static void growTable(LifeSparseGrid* grid);
+	static SparseTile* addTile(LifeSparseGrid* grid, LifeTileCache* cache, int32_t x, int32_t y);
+	static void eraseTile(LifeSparseGrid* grid, int32_t x, int32_t y);
+	static bool emptySparseSlot(const SparseSlot& slot);
+	static uint8_t tileNeeds(const uint64_t* rows);
+	static void compactTiles(LifeSparseGrid* grid);
+	static void stepTile(const LifeSparseGrid* grid, SparseTile* tile, const LifeRule* rule, bool conway, uint64_t* population);
+
+	static uint64_t tileKey(int32_t x, int32_t y)
+	{
+		return ((uint64_t)(uint32_t)x << 32) | (uint32_t)y;
+	}
+
+	// the tile holding a cell, rounding towards negative infinity
+	static int32_t tileCoordinate(int64_t cell)
+	{
+		return (int32_t)(cell >= 0 ? cell / SPARSE_TILE_SIZE : -((-cell + SPARSE_TILE_SIZE - 1) / SPARSE_TILE_SIZE));
+	}
+
+	static bool emptySparseSlot(const SparseSlot& slot)
+	{
+		return !slot.tile;
+	}
+
+	static uint32_t findSlot(const LifeSparseGrid* grid, uint64_t key)
+	{
+		return probeSlot(grid->table.data(), grid->mask, key, emptySparseSlot);
+	}
+
+	static SparseTile* findTile(const LifeSparseGrid* grid, int32_t x, int32_t y)
+	{
+		return grid->table[findSlot(grid, tileKey(x, y))].tile;
+	}
+
+	// kept at most half full, so a probe run stays short
+	static void growTable(LifeSparseGrid* grid)
+	{
+		std::vector<SparseSlot> old;
+		old.swap(grid->table);
+		grid->table.assign(old.size() * 2, SparseSlot{});
+		grid->mask = (uint32_t)grid->table.size() - 1;
+
+		for (const SparseSlot& entry : old)
+		{
+			if (!entry.tile) continue;
+			grid->table[findSlot(grid, entry.key)] = entry;
+		}
+	}
+
+	static SparseTile* addTile(LifeSparseGrid* grid, LifeTileCache* cache, int32_t x, int32_t y)
+	{
+		if ((grid->count + 1) * 2 > grid->table.size())
+			growTable(grid);
+
+		SparseTile* tile = (SparseTile*)cacheAllocate(cache);
+		tile->x = x;
+		tile->y = y;
+		tile->needs = 0;
+		memset(tile->rows, 0, sizeof(tile->rows));
+
+		uint64_t key = tileKey(x, y);
+		grid->table[findSlot(grid, key)] = SparseSlot{ key, tile };
+		grid->count++;
+		grid->tiles.push_back(tile);
+		return tile;
+	}
+
+	static void eraseTile(LifeSparseGrid* grid, int32_t x, int32_t y)
+	{
+		eraseSlot(grid->table.data(), grid->mask, findSlot(grid, tileKey(x, y)), emptySparseSlot);
+		grid->count--;
+	}
+
+	// bit 0 of a row is the west edge, bit 63 the east edge
+	static uint8_t tileNeeds(const uint64_t* rows)
+	{
+		uint64_t any = 0;
+		for (uint32_t r = 0; r < SPARSE_TILE_SIZE; r++)
+			any |= rows[r];
+
+		uint64_t top = rows[0], bottom = rows[SPARSE_TILE_SIZE - 1];
+		uint8_t needs = 0;
+		if (top) needs |= 1 << Sparse_North;
+		if (bottom) needs |= 1 << Sparse_South;
+		if (any & 1) needs |= 1 << Sparse_West;
+		if (any >> 63) needs |= 1 << Sparse_East;
+		if (top & 1) needs |= 1 << Sparse_NorthWest;
+		if (top >> 63) needs |= 1 << Sparse_NorthEast;
+		if (bottom & 1) needs |= 1 << Sparse_SouthWest;
+		if (bottom >> 63) needs |= 1 << Sparse_SouthEast;
+		return needs;
+	}
+
+	// tiles left in draining slabs are copied into fuller ones, the old copies go back through
+	// their own cache so none of them is handed out again before the drained slabs are released
+	static void compactTiles(LifeSparseGrid* grid)
+	{
+		LIFE_TRACE_SCOPE("sim", "sparse compact");
+		LifeTileCache fresh, drained;
+		beginTileCache(grid->arena, &fresh);
+		beginTileCache(grid->arena, &drained);
+		for (SparseTile*& tile : grid->tiles)
+		{
+			if (!tileDraining(grid->arena, tile)) continue;
+
+			SparseTile* copy = (SparseTile*)cacheAllocate(&fresh);
+			memcpy(copy, tile, sizeof(SparseTile));
+			grid->table[findSlot(grid, tileKey(tile->x, tile->y))].tile = copy;
+			cacheFree(&drained, tile);
+			tile = copy;
+		}
+		flushTileCache(&fresh);
+		flushTileCache(&drained);
+	}
+
+	// the tile's rows with the row above and below it, and the same rows of the tiles to either
+	// side, missing tiles read as dead
+	static void stepTile(const LifeSparseGrid* grid, SparseTile* tile, const LifeRule* rule, bool conway, uint64_t* population)
+	{
+		uint32_t current = grid->generation & 1;
+		const SparseTile* around[8];
+		for (uint32_t d = 0; d < 8; d++)
+			around[d] = findTile(grid, tile->x + s_DirectionX[d], tile->y + s_DirectionY[d]);
+
+		uint64_t center[SPARSE_TILE_SIZE + 2], west[SPARSE_TILE_SIZE + 2], east[SPARSE_TILE_SIZE + 2];
+		auto edgeRow = [&](SparseDirection direction, uint32_t row) { return around[direction] ? around[direction]->rows[current][row] : 0; };
+		center[0] = edgeRow(Sparse_North, SPARSE_TILE_SIZE - 1);
+		west[0] = edgeRow(Sparse_NorthWest, SPARSE_TILE_SIZE - 1);
+		east[0] = edgeRow(Sparse_NorthEast, SPARSE_TILE_SIZE - 1);
+		for (uint32_t r = 0; r < SPARSE_TILE_SIZE; r++)
+		{
+			center[r + 1] = tile->rows[current][r];
+			west[r + 1] = edgeRow(Sparse_West, r);
+			east[r + 1] = edgeRow(Sparse_East, r);
+		}
+		center[SPARSE_TILE_SIZE + 1] = edgeRow(Sparse_South, 0);
+		west[SPARSE_TILE_SIZE + 1] = edgeRow(Sparse_SouthWest, 0);
+		east[SPARSE_TILE_SIZE + 1] = edgeRow(Sparse_SouthEast, 0);
+
+		uint64_t* out = tile->rows[current ^ 1];
+		uint64_t count = 0;
+		for (uint32_t r = 0; r < SPARSE_TILE_SIZE; r++)
+		{
+			uint64_t left[3], right[3];
+			for (uint32_t k = 0; k < 3; k++)
+			{
+				left[k] = (center[r + k] << 1) | (west[r + k] >> 63);  // neighbour at x - 1
+				right[k] = (center[r + k] >> 1) | (east[r + k] << 63); // neighbour at x + 1
+			}
+			out[r] = nextWord(left, center + r, right, rule, conway);
+			count += popcount64(out[r]);
+		}
+
+		tile->needs = tileNeeds(out);
+		*population = count;
+	}
+
+	LifeResult createSparseGrid(LifeSparseGrid** grid)
+	{
+		LifeArenaCreateInfo arenaInfo{};
+		arenaInfo.tileBytes = sizeof(SparseTile);
+
+		LifeTileArena* arena;
+		if (createTileArena(&arena, &arenaInfo) == Life_Result_Failed)
+			return Life_Result_Failed;
+
+		LifeSparseGrid* result = new LifeSparseGrid();
+		result->arena = arena;
+		result->table.assign(SPARSE_MIN_TABLE, SparseSlot{});
+		result->mask = SPARSE_MIN_TABLE - 1;
+		*grid = result;
+		return Life_Result_Success;
+	}
+
+	void destroySparseGrid(LifeSparseGrid* grid)
+	{
+		destroyTileArena(grid->arena);
+		delete grid;
+	}
+
+	bool getSparseCell(const LifeSparseGrid* grid, int64_t x, int64_t y)
+	{
+		int32_t tileX = tileCoordinate(x), tileY = tileCoordinate(y);
+		const SparseTile* tile = findTile(grid, tileX, tileY);
+		if (!tile) return false;
+		return (tile->rows[grid->generation & 1][y - (int64_t)tileY * SPARSE_TILE_SIZE] >> (x - (int64_t)tileX * SPARSE_TILE_SIZE)) & 1;
+	}
+
+	void setSparseCell(LifeSparseGrid* grid, int64_t x, int64_t y, bool alive)
+	{
+		int32_t tileX = tileCoordinate(x), tileY = tileCoordinate(y);
+		SparseTile* tile = findTile(grid, tileX, tileY);
+		if (!tile && !alive) return;
+		if (!tile)
+		{
+			LifeTileCache cache;
+			beginTileCache(grid->arena, &cache);
+			tile = addTile(grid, &cache, tileX, tileY);
+			flushTileCache(&cache);
+		}
+
+		uint64_t& word = tile->rows[grid->generation & 1][y - (int64_t)tileY * SPARSE_TILE_SIZE];
+		uint64_t bit = 1ull << (x - (int64_t)tileX * SPARSE_TILE_SIZE);
+		grid->population += (alive && !(word & bit)) ? 1 : 0;
+		grid->population -= (!alive && (word & bit)) ? 1 : 0;
+		word = alive ? (word | bit) : (word & ~bit);
+	}
+
+	void placeSparsePattern(LifeSparseGrid* grid, const LifeGrid* pattern, int64_t x, int64_t y)
+	{
+		LifeTileCache cache;
+		beginTileCache(grid->arena, &cache);
+		uint32_t current = grid->generation & 1;
+
+		// a pattern word lands in at most two tiles side by side
+		for (uint32_t row = 0; row < pattern->height; row++)
+		{
+			int64_t cellY = y + row;
+			int32_t tileY = tileCoordinate(cellY);
+			uint32_t tileRow = (uint32_t)(cellY - (int64_t)tileY * SPARSE_TILE_SIZE);
+			for (uint32_t w = 0; w < pattern->stride; w++)
+			{
+				uint64_t bits = pattern->words[(size_t)row * pattern->stride + w];
+				if (!bits) continue;
+
+				int64_t cellX = x + (int64_t)w * LIFE_WORD_BITS;
+				int32_t tileX = tileCoordinate(cellX);
+				uint32_t shift = (uint32_t)(cellX - (int64_t)tileX * SPARSE_TILE_SIZE);
+				uint64_t parts[2] = { bits << shift, shift ? bits >> (LIFE_WORD_BITS - shift) : 0 };
+				for (uint32_t i = 0; i < 2; i++)
+				{
+					if (!parts[i]) continue;
+					SparseTile* tile = findTile(grid, tileX + i, tileY);
+					if (!tile) tile = addTile(grid, &cache, tileX + i, tileY);
+					uint64_t& word = tile->rows[current][tileRow];
+					grid->population += popcount64(parts[i] & ~word);
+					word |= parts[i];
+				}
+			}
+		}
+		flushTileCache(&cache);
+	}
+
+	void copySparseRegion(const LifeSparseGrid* grid, int64_t x, int64_t y, LifeGrid* region)
+	{
+		uint32_t current = grid->generation & 1;
+		auto tileWord = [&](int32_t tileX, int32_t tileY, uint32_t row)
+		{
+			const SparseTile* tile = findTile(grid, tileX, tileY);
+			return tile ? tile->rows[current][row] : 0;
+		};
+
+		for (uint32_t row = 0; row < region->height; row++)
+		{
+			int64_t cellY = y + row;
+			int32_t tileY = tileCoordinate(cellY);
+			uint32_t tileRow = (uint32_t)(cellY - (int64_t)tileY * SPARSE_TILE_SIZE);
+			uint64_t* target = region->words.data() + (size_t)row * region->stride;
+			for (uint32_t w = 0; w < region->stride; w++)
+			{
+				int64_t cellX = x + (int64_t)w * LIFE_WORD_BITS;
+				int32_t tileX = tileCoordinate(cellX);
+				uint32_t shift = (uint32_t)(cellX - (int64_t)tileX * SPARSE_TILE_SIZE);
+				target[w] = tileWord(tileX, tileY, tileRow) >> shift;
+				if (shift) target[w] |= tileWord(tileX + 1, tileY, tileRow) << (LIFE_WORD_BITS - shift);
+			}
+			target[region->stride - 1] &= rowMask(region);
+		}
+	}
+
+	void stepSparse(LifeSparseGrid* grid, const LifeStepInfo* stepInfo)
+	{
+		LIFE_TRACE_SCOPE("sim", "sparse step");
+		uint32_t current = grid->generation & 1;
+		bool conway = stepInfo->rule.birth == LIFE_RULE_CONWAY.birth && stepInfo->rule.survive == LIFE_RULE_CONWAY.survive;
+
+		// births can only happen next to live cells, so empty tiles are added where live
+		// cells reach an edge, tiles appended here are empty and need nothing themselves
+		{
+			LIFE_TRACE_SCOPE("sim", "sparse expand");
+			LifeTileCache cache;
+			beginTileCache(grid->arena, &cache);
+			size_t count = grid->tiles.size();
+			for (size_t i = 0; i < count; i++)
+			{
+				SparseTile* tile = grid->tiles[i];
+				uint8_t needs = tileNeeds(tile->rows[current]);
+				for (uint32_t d = 0; d < 8; d++)
+				{
+					int32_t x = tile->x + s_DirectionX[d], y = tile->y + s_DirectionY[d];
+					if ((needs >> d) & 1 && !findTile(grid, x, y))
+						addTile(grid, &cache, x, y);
+				}
+			}
+			flushTileCache(&cache);
+		}
+
+		std::atomic<uint64_t> population{ 0 };
+		grid->empty.resize(grid->tiles.size());
+		parallelFor((uint32_t)grid->tiles.size(), stepInfo->threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			LIFE_TRACE_SCOPE("sim", "tiles");
+			uint64_t rangePopulation = 0;
+			for (uint32_t i = begin; i < end; i++)
+			{
+				uint64_t count;
+				stepTile(grid, grid->tiles[i], &stepInfo->rule, conway, &count);
+				grid->empty[i] = count == 0;
+				rangePopulation += count;
+			}
+			population.fetch_add(rangePopulation, std::memory_order_relaxed);
+		});
+		grid->generation++;
+		grid->population = population.load();
+
+		// an empty tile stays while a neighbour's live edge faces it, the next step would only
+		// add it again, every other empty tile leaves the table now and goes back in bulk
+		LIFE_TRACE_SCOPE("sim", "sparse reclaim");
+		grid->freed.clear();
+		for (size_t i = 0; i < grid->tiles.size(); i++)
+		{
+			SparseTile* tile = grid->tiles[i];
+			if (!grid->empty[i]) continue;
+
+			bool faced = false;
+			for (uint32_t d = 0; d < 8 && !faced; d++)
+			{
+				const SparseTile* neighbour = findTile(grid, tile->x + s_DirectionX[d], tile->y + s_DirectionY[d]);
+				faced = neighbour && ((neighbour->needs >> ((d + 4) % 8)) & 1);
+			}
+			if (!faced) grid->freed.push_back(tile);
+		}
+
+		// erasing in a second pass keeps the neighbour lookups above seeing every tile
+		for (SparseTile* tile : grid->freed)
+			eraseTile(grid, tile->x, tile->y);
+		grid->tiles.erase(std::remove_if(grid->tiles.begin(), grid->tiles.end(), [&](SparseTile* tile) { return findTile(grid, tile->x, tile->y) != tile; }), grid->tiles.end());
+
+		parallelFor((uint32_t)grid->freed.size(), stepInfo->threadCount, [&](uint32_t begin, uint32_t end)
+		{
+			LifeTileCache cache;
+			beginTileCache(grid->arena, &cache);
+			for (uint32_t i = begin; i < end; i++)
+				cacheFree(&cache, grid->freed[i]);
+			flushTileCache(&cache);
+		});
+
+		// survivors scattered over mostly empty slabs would otherwise keep them all resident
+		if (drainSlabs(grid->arena) > 0)
+			compactTiles(grid);
+	}
+
+	uint64_t sparseGeneration(const LifeSparseGrid* grid)
+	{
+		return grid->generation;
+	}
+
+	uint64_t sparsePopulation(const LifeSparseGrid* grid)
+	{
+		return grid->population;
+	}
+
+	uint32_t sparseTileCount(const LifeSparseGrid* grid)
+	{
+		return (uint32_t)grid->tiles.size();
+	}
+
+	void sparseArenaStats(const LifeSparseGrid* grid, LifeArenaStats* stats)
+	{
+		arenaStats(grid->arena, stats);
+	}
+}
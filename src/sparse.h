@@ -0,0 +1,32 @@
+#pragma once
+
+#include "life.h"
+#include "arena.h"
+
+// an unbounded plane kept as 64 x 64 cell tiles, only tiles with live cells or next to them
+// exist, tiles come from a pooled arena so gliders moving through empty space never reach
+// the general purpose heap
+struct LifeSparseGrid;
+
+namespace life
+{
+	LifeResult createSparseGrid(LifeSparseGrid** grid);
+	void       destroySparseGrid(LifeSparseGrid* grid);
+
+	bool       getSparseCell(const LifeSparseGrid* grid, int64_t x, int64_t y);
+	void       setSparseCell(LifeSparseGrid* grid, int64_t x, int64_t y, bool alive);
+	// ors the live cells of pattern into the plane with its first cell at (x, y)
+	void       placeSparsePattern(LifeSparseGrid* grid, const LifeGrid* pattern, int64_t x, int64_t y);
+	// fills region with the cells starting at (x, y)
+	void       copySparseRegion(const LifeSparseGrid* grid, int64_t x, int64_t y, LifeGrid* region);
+
+	// one generation, tiles are created where live cells reach an edge and every tile left
+	// empty with no live neighbour edge is handed back to the arena in one batch per thread,
+	// only the rule and thread count of stepInfo are used, rules with B0 are not supported
+	void       stepSparse(LifeSparseGrid* grid, const LifeStepInfo* stepInfo);
+
+	uint64_t   sparseGeneration(const LifeSparseGrid* grid);
+	uint64_t   sparsePopulation(const LifeSparseGrid* grid);
+	uint32_t   sparseTileCount(const LifeSparseGrid* grid);
+	void       sparseArenaStats(const LifeSparseGrid* grid, LifeArenaStats* stats);
+}
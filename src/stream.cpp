@@ -0,0 +1,244 @@
+#include "stream.h"
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#define STREAM_MAGIC    0x52464743u // "CGFR"
+#define STREAM_KEYFRAME 1u
+#define STREAM_DELTA    2u
+#define STREAM_TILE     64          // rows per tile, a tile is one word wide
+
+// frames are written in the byte order of the machine, every field is little endian in practice
+struct StreamFrameHeader
+{
+	uint32_t magic;
+	uint32_t type;
+	uint64_t generation;
+	uint32_t width, height;
+	uint32_t tileCount;
+	uint32_t payloadSize;
+};
+
+struct LifeStreamEncoder
+{
+	LifeStreamInfo info;
+	LifeGrid* previous;
+	uint64_t frameCount;
+	bool keyframeRequested;
+	std::vector<uint64_t> masks; // changed rows of each tile in the current band
+};
+
+struct LifeStreamDecoder
+{
+	LifeGrid* grid;
+};
+
+namespace life
+{
+	static void appendBytes(std::vector<uint8_t>* data, const void* bytes, size_t size);
+
+	static void appendBytes(std::vector<uint8_t>* data, const void* bytes, size_t size)
+	{
+		const uint8_t* begin = (const uint8_t*)bytes;
+		data->insert(data->end(), begin, begin + size);
+	}
+
+	LifeResult createStreamEncoder(LifeStreamEncoder** encoder, const LifeStreamInfo* streamInfo)
+	{
+		LifeStreamEncoder* result = new LifeStreamEncoder();
+		if (createGrid(&result->previous, streamInfo->width, streamInfo->height) == Life_Result_Failed)
+		{
+			delete result;
+			return Life_Result_Failed;
+		}
+
+		result->info = *streamInfo;
+		result->frameCount = 0;
+		result->keyframeRequested = true;
+		result->masks.resize(result->previous->stride);
+
+		*encoder = result;
+		return Life_Result_Success;
+	}
+
+	void destroyStreamEncoder(LifeStreamEncoder* encoder)
+	{
+		destroyGrid(encoder->previous);
+		delete encoder;
+	}
+
+	void requestKeyframe(LifeStreamEncoder* encoder)
+	{
+		encoder->keyframeRequested = true;
+	}
+
+	void encodeFrame(LifeStreamEncoder* encoder, const LifeGrid* grid, uint64_t generation, std::vector<uint8_t>* data, LifeStreamFrame* frame)
+	{
+		LIFE_TRACE_SCOPE("io", "encode frame");
+		bool keyframe = encoder->keyframeRequested ||
+			(encoder->info.keyframeInterval > 0 && encoder->frameCount % encoder->info.keyframeInterval == 0);
+		encoder->keyframeRequested = false;
+		encoder->frameCount++;
+
+		// a keyframe is a delta against an empty universe
+		if (keyframe)
+			clearGrid(encoder->previous);
+
+		size_t headerOffset = data->size();
+		StreamFrameHeader header{};
+		header.magic = STREAM_MAGIC;
+		header.type = keyframe ? STREAM_KEYFRAME : STREAM_DELTA;
+		header.generation = generation;
+		header.width = grid->width;
+		header.height = grid->height;
+		appendBytes(data, &header, sizeof(header));
+
+		uint32_t stride = grid->stride;
+		uint64_t* previous = encoder->previous->words.data();
+		const uint64_t* current = grid->words.data();
+
+		// rows are compared a band of tiles at a time so both grids are read in order
+		for (uint32_t band = 0; band < grid->height; band += STREAM_TILE)
+		{
+			uint32_t rows = std::min<uint32_t>(STREAM_TILE, grid->height - band);
+			std::fill(encoder->masks.begin(), encoder->masks.end(), 0);
+
+			bool changed = false;
+			for (uint32_t row = 0; row < rows; row++)
+			{
+				size_t offset = (size_t)(band + row) * stride;
+				for (uint32_t w = 0; w < stride; w++)
+				{
+					if (current[offset + w] == previous[offset + w]) continue;
+					encoder->masks[w] |= 1ull << row;
+					changed = true;
+				}
+			}
+
+			if (!changed) continue;
+
+			for (uint32_t w = 0; w < stride; w++)
+			{
+				uint64_t mask = encoder->masks[w];
+				if (!mask) continue;
+
+				uint32_t index = (band / STREAM_TILE) * stride + w;
+				appendBytes(data, &index, sizeof(index));
+				appendBytes(data, &mask, sizeof(mask));
+				for (uint64_t bits = mask; bits; bits &= bits - 1)
+				{
+					size_t offset = (size_t)(band + lowestBit64(bits)) * stride + w;
+					uint64_t delta = current[offset] ^ previous[offset];
+					appendBytes(data, &delta, sizeof(delta));
+					previous[offset] = current[offset];
+				}
+				header.tileCount++;
+			}
+		}
+
+		header.payloadSize = (uint32_t)(data->size() - headerOffset - sizeof(header));
+		memcpy(data->data() + headerOffset, &header, sizeof(header));
+
+		if (frame)
+		{
+			frame->generation = generation;
+			frame->keyframe = keyframe;
+			frame->applied = true;
+			frame->tileCount = header.tileCount;
+			frame->size = data->size() - headerOffset;
+		}
+	}
+
+	LifeResult createStreamDecoder(LifeStreamDecoder** decoder)
+	{
+		LifeStreamDecoder* result = new LifeStreamDecoder();
+		result->grid = nullptr;
+		*decoder = result;
+		return Life_Result_Success;
+	}
+
+	void destroyStreamDecoder(LifeStreamDecoder* decoder)
+	{
+		if (decoder->grid) destroyGrid(decoder->grid);
+		delete decoder;
+	}
+
+	const LifeGrid* decodedGrid(const LifeStreamDecoder* decoder)
+	{
+		return decoder->grid;
+	}
+
+	size_t decodeFrame(LifeStreamDecoder* decoder, const uint8_t* data, size_t size, LifeStreamFrame* frame)
+	{
+		*frame = LifeStreamFrame{};
+
+		// skip to the next frame marker
+		size_t start = 0;
+		uint32_t magic = STREAM_MAGIC;
+		while (start + sizeof(magic) <= size && memcmp(data + start, &magic, sizeof(magic)) != 0)
+			start++;
+
+		StreamFrameHeader header;
+		if (start + sizeof(header) > size)
+			return start;
+		memcpy(&header, data + start, sizeof(header));
+
+		size_t end = start + sizeof(header) + header.payloadSize;
+		bool valid = (header.type == STREAM_KEYFRAME || header.type == STREAM_DELTA) && header.width > 0 && header.height > 0;
+		if (!valid)
+			return start + 1;
+		if (end > size)
+			return start;
+
+		frame->generation = header.generation;
+		frame->keyframe = header.type == STREAM_KEYFRAME;
+		frame->tileCount = header.tileCount;
+		frame->size = end - start;
+
+		// deltas only apply on top of the keyframe they follow
+		if (frame->keyframe)
+		{
+			if (decoder->grid && (decoder->grid->width != header.width || decoder->grid->height != header.height))
+			{
+				destroyGrid(decoder->grid);
+				decoder->grid = nullptr;
+			}
+			if (!decoder->grid)
+				createGrid(&decoder->grid, header.width, header.height);
+			clearGrid(decoder->grid);
+		}
+		else if (!decoder->grid || decoder->grid->width != header.width || decoder->grid->height != header.height)
+			return end;
+
+		LifeGrid* grid = decoder->grid;
+		uint32_t tilesHigh = (grid->height + STREAM_TILE - 1) / STREAM_TILE;
+		const uint8_t* tile = data + start + sizeof(header);
+		for (uint32_t i = 0; i < header.tileCount; i++)
+		{
+			uint32_t index;
+			uint64_t mask;
+			if (tile + sizeof(index) + sizeof(mask) > data + end) break;
+			memcpy(&index, tile, sizeof(index));
+			memcpy(&mask, tile + sizeof(index), sizeof(mask));
+			tile += sizeof(index) + sizeof(mask);
+
+			uint32_t band = index / grid->stride, w = index % grid->stride;
+			if (band >= tilesHigh || tile + popcount64(mask) * sizeof(uint64_t) > data + end) break;
+
+			for (uint64_t bits = mask; bits; bits &= bits - 1)
+			{
+				uint32_t row = band * STREAM_TILE + lowestBit64(bits);
+				uint64_t delta;
+				memcpy(&delta, tile, sizeof(delta));
+				tile += sizeof(delta);
+				if (row < grid->height)
+					grid->words[(size_t)row * grid->stride + w] ^= delta;
+			}
+		}
+
+		frame->applied = true;
+		return end;
+	}
+}
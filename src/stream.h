@@ -0,0 +1,44 @@
+#pragma once
+
+#include "life.h"
+
+#include <vector>
+
+// frames carry only the 64 x 64 cell tiles that changed since the previous frame, each tile is a
+// bitmask of its changed rows followed by those rows xor the previous frame, keyframes are the
+// same against an empty universe so a reader joining late syncs at the next one
+struct LifeStreamEncoder;
+struct LifeStreamDecoder;
+
+struct LifeStreamInfo
+{
+	uint32_t width, height;
+	uint32_t keyframeInterval; // frames between keyframes, 0 only writes the first one
+};
+
+struct LifeStreamFrame
+{
+	uint64_t generation;
+	bool keyframe;
+	bool applied;       // false for frames a decoder skipped while waiting for a keyframe
+	uint32_t tileCount;
+	size_t size;        // encoded bytes including the frame header
+};
+
+namespace life
+{
+	LifeResult createStreamEncoder(LifeStreamEncoder** encoder, const LifeStreamInfo* streamInfo);
+	void       destroyStreamEncoder(LifeStreamEncoder* encoder);
+	// appends the frame for grid to data, frame is optional
+	void       encodeFrame(LifeStreamEncoder* encoder, const LifeGrid* grid, uint64_t generation, std::vector<uint8_t>* data, LifeStreamFrame* frame);
+	// the next frame is a keyframe, for when a new reader connects
+	void       requestKeyframe(LifeStreamEncoder* encoder);
+
+	LifeResult createStreamDecoder(LifeStreamDecoder** decoder);
+	void       destroyStreamDecoder(LifeStreamDecoder* decoder);
+	// consumes the next frame in data and returns the bytes used, frame->size stays 0 while data does
+	// not hold a whole frame, bytes before a frame marker are skipped so a reader may start mid stream
+	size_t     decodeFrame(LifeStreamDecoder* decoder, const uint8_t* data, size_t size, LifeStreamFrame* frame);
+	// the decoded universe, nullptr until the first keyframe
+	const LifeGrid* decodedGrid(const LifeStreamDecoder* decoder);
+}
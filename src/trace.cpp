@@ -0,0 +1,166 @@
+#include "trace.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <unistd.h>
+#define TRACE_PID ((int)getpid())
+#else
+#define TRACE_PID 1
+#endif
+
+#define TRACE_CAPACITY 65536 // events a thread keeps between writes, older ones are overwritten
+
+struct TraceEvent
+{
+	const char* category;
+	const char* name;
+	uint64_t start, end;
+};
+
+// only the owning thread records into a buffer, writeTrace reads up to the published count
+// without locking, a buffer whose thread exited is handed to the next new thread
+struct TraceBuffer
+{
+	std::vector<TraceEvent> events;
+	std::atomic<uint64_t> written;
+	uint64_t flushed;
+	std::atomic<bool> owned;
+	uint32_t lane;
+	char name[64];
+};
+
+struct TraceOwner
+{
+	TraceBuffer* buffer = nullptr;
+	~TraceOwner() { if (buffer) buffer->owned.store(false, std::memory_order_release); }
+};
+
+namespace life
+{
+	static std::mutex s_TraceMutex;
+	static std::vector<TraceBuffer*> s_TraceBuffers;
+	static const std::chrono::steady_clock::time_point s_TraceEpoch = std::chrono::steady_clock::now();
+	static thread_local TraceOwner t_TraceOwner;
+
+	static TraceBuffer* threadBuffer();
+	static void writeName(FILE* file, const char* name);
+
+	static TraceBuffer* threadBuffer()
+	{
+		if (t_TraceOwner.buffer)
+			return t_TraceOwner.buffer;
+
+		std::lock_guard<std::mutex> lock(s_TraceMutex);
+		for (TraceBuffer* buffer : s_TraceBuffers)
+		{
+			bool owned = false;
+			if (buffer->owned.compare_exchange_strong(owned, true))
+			{
+				t_TraceOwner.buffer = buffer;
+				return buffer;
+			}
+		}
+
+		TraceBuffer* buffer = new TraceBuffer();
+		buffer->events.resize(TRACE_CAPACITY);
+		buffer->written = 0;
+		buffer->flushed = 0;
+		buffer->owned = true;
+		buffer->lane = (uint32_t)s_TraceBuffers.size();
+		snprintf(buffer->name, sizeof(buffer->name), "thread %u", buffer->lane);
+		s_TraceBuffers.push_back(buffer);
+
+		t_TraceOwner.buffer = buffer;
+		return buffer;
+	}
+
+	static void writeName(FILE* file, const char* name)
+	{
+		fputc('"', file);
+		for (const char* c = name; *c; c++)
+		{
+			if (*c == '"' || *c == '\\') fputc('\\', file);
+			if ((unsigned char)*c >= 0x20) fputc(*c, file);
+		}
+		fputc('"', file);
+	}
+
+	void setTracing(bool enabled)
+	{
+		traceEnabled.store(enabled, std::memory_order_relaxed);
+	}
+
+	uint64_t traceClock()
+	{
+		return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - s_TraceEpoch).count() + 1;
+	}
+
+	void recordTrace(const char* category, const char* name, uint64_t start, uint64_t end)
+	{
+		TraceBuffer* buffer = threadBuffer();
+		uint64_t index = buffer->written.load(std::memory_order_relaxed);
+		buffer->events[index % TRACE_CAPACITY] = { category, name, start, end };
+		buffer->written.store(index + 1, std::memory_order_release);
+	}
+
+	void nameTraceThread(const char* name)
+	{
+		TraceBuffer* buffer = threadBuffer();
+		snprintf(buffer->name, sizeof(buffer->name), "%s", name);
+	}
+
+	LifeResult writeTrace(const char* path)
+	{
+		FILE* file = fopen(path, "w");
+		if (!file)
+		{
+			printf("trace: failed to open %s\n", path);
+			return Life_Result_Failed;
+		}
+
+		std::lock_guard<std::mutex> lock(s_TraceMutex);
+		fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+		bool first = true;
+		uint64_t lost = 0;
+		for (TraceBuffer* buffer : s_TraceBuffers)
+		{
+			fprintf(file, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%d,\"tid\":%u,\"args\":{\"name\":", first ? "" : ",\n", TRACE_PID, buffer->lane);
+			writeName(file, buffer->name);
+			fprintf(file, "}}");
+			first = false;
+
+			uint64_t written = buffer->written.load(std::memory_order_acquire);
+			if (written - buffer->flushed > TRACE_CAPACITY)
+			{
+				lost += written - buffer->flushed - TRACE_CAPACITY;
+				buffer->flushed = written - TRACE_CAPACITY;
+			}
+
+			for (uint64_t i = buffer->flushed; i < written; i++)
+			{
+				const TraceEvent& event = buffer->events[i % TRACE_CAPACITY];
+				fprintf(file, ",\n{\"ph\":\"X\",\"cat\":");
+				writeName(file, event.category);
+				fprintf(file, ",\"name\":");
+				writeName(file, event.name);
+				fprintf(file, ",\"pid\":%d,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", TRACE_PID, buffer->lane,
+					event.start * 0.001, (event.end - event.start) * 0.001);
+			}
+			buffer->flushed = written;
+		}
+
+		fprintf(file, "\n]}\n");
+		bool failed = ferror(file) != 0;
+		fclose(file);
+
+		if (lost > 0)
+			printf("trace: %llu events were overwritten before they could be written\n", (unsigned long long)lost);
+		return failed ? Life_Result_Failed : Life_Result_Success;
+	}
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include "life.h"
+
+#include <atomic>
+
+// begin/end pairs recorded into a buffer per thread and written as Chrome trace event JSON,
+// open the file in chrome://tracing or ui.perfetto.dev, a disabled scope costs one relaxed load
+namespace life
+{
+	inline std::atomic<bool> traceEnabled{ false };
+
+	void       setTracing(bool enabled);
+	uint64_t   traceClock(); // nanoseconds since the program started, never 0
+	// name and category must outlive the trace, string literals in practice
+	void       recordTrace(const char* category, const char* name, uint64_t start, uint64_t end);
+	// labels the calling thread's lane in the trace
+	void       nameTraceThread(const char* name);
+	// writes every event recorded since the last write and drops them from the buffers
+	LifeResult writeTrace(const char* path);
+}
+
+struct LifeTraceScope
+{
+	const char* category;
+	const char* name;
+	uint64_t start;
+
+	LifeTraceScope(const char* category, const char* name) : category(category), name(name),
+		start(life::traceEnabled.load(std::memory_order_relaxed) ? life::traceClock() : 0) {}
+	~LifeTraceScope()
+	{
+		if (start) life::recordTrace(category, name, start, life::traceClock());
+	}
+};
+
+#define LIFE_TRACE_CONCAT2(a, b) a##b
+#define LIFE_TRACE_CONCAT(a, b) LIFE_TRACE_CONCAT2(a, b)
+#define LIFE_TRACE_SCOPE(category, name) LifeTraceScope LIFE_TRACE_CONCAT(traceScope, __LINE__)(category, name)
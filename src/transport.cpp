@@ -0,0 +1,396 @@
+#include "transport.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <new>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define LIFE_SHM_SUPPORTED
+#endif
+
+#define SHM_MAGIC 0x6367676F6C73686Dull // "cgolshm"
+#define SHM_ALIGN 64
+#define SHM_SPINS 256                    // busy polls before a waiting process yields
+
+// the segment holds the header, one report slot per worker and two rings per worker,
+// each ring carries rows from one worker to one neighbour with a single writer and reader
+struct ShmHeader
+{
+	uint64_t magic;
+	uint64_t size;
+	uint32_t workerCount, stride, slots, topology;
+	int64_t coordinator; // pid of the process that created the segment
+	std::atomic<uint64_t> released; // generation + 1 of the last barrier the coordinator released
+	std::atomic<uint32_t> aborted;
+};
+
+struct alignas(SHM_ALIGN) ShmReport
+{
+	std::atomic<uint64_t> reported; // generation + 1 of the last barrier the worker reached
+	uint64_t population;
+	uint64_t hash;
+};
+
+struct alignas(SHM_ALIGN) ShmRing
+{
+	std::atomic<uint64_t> written;
+	alignas(SHM_ALIGN) std::atomic<uint64_t> read;
+	// followed by slots entries of a generation tag and stride row words
+};
+
+struct ShmTransport
+{
+	char name[256];
+	uint8_t* base;
+	size_t size;
+	bool owner;
+	uint32_t worker;
+};
+
+namespace life
+{
+#ifdef LIFE_SHM_SUPPORTED
+	static size_t alignShm(size_t size);
+	static size_t ringSize(uint32_t stride, uint32_t slots);
+	static ShmHeader* shmHeader(const ShmTransport* shm);
+	static ShmReport* shmReport(const ShmTransport* shm, uint32_t worker);
+	static ShmRing* shmRing(const ShmTransport* shm, uint32_t worker, LifeHaloDirection direction);
+	static bool neighbour(const ShmHeader* header, uint32_t worker, LifeHaloDirection direction, uint32_t* result);
+	static bool abandonedSegment(const char* name);
+	static bool waitFor(const ShmHeader* header, const std::atomic<uint64_t>* value, uint64_t target);
+	static LifeResult shmSendRow(void* data, LifeHaloDirection direction, uint64_t generation, const uint64_t* row);
+	static LifeResult shmReceiveRow(void* data, LifeHaloDirection direction, uint64_t generation, uint64_t* row);
+	static LifeResult shmBarrier(void* data, uint64_t generation, const LifeReduction* reduction);
+	static LifeResult shmGather(void* data, uint64_t generation, LifeReduction* reduction);
+	static void shmRelease(void* data, uint64_t generation);
+	static void shmAbort(void* data);
+	static void shmDestroy(void* data);
+
+	static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared memory counters need lock free atomics");
+
+	static size_t alignShm(size_t size)
+	{
+		return (size + SHM_ALIGN - 1) / SHM_ALIGN * SHM_ALIGN;
+	}
+
+	static size_t ringSize(uint32_t stride, uint32_t slots)
+	{
+		return alignShm(sizeof(ShmRing) + (size_t)slots * (stride + 1) * sizeof(uint64_t));
+	}
+
+	static ShmHeader* shmHeader(const ShmTransport* shm)
+	{
+		return (ShmHeader*)shm->base;
+	}
+
+	static ShmReport* shmReport(const ShmTransport* shm, uint32_t worker)
+	{
+		return (ShmReport*)(shm->base + alignShm(sizeof(ShmHeader))) + worker;
+	}
+
+	// the ring worker writes into when sending in direction
+	static ShmRing* shmRing(const ShmTransport* shm, uint32_t worker, LifeHaloDirection direction)
+	{
+		const ShmHeader* header = shmHeader(shm);
+		size_t offset = alignShm(sizeof(ShmHeader)) + header->workerCount * sizeof(ShmReport);
+		offset += ((size_t)worker * 2 + direction) * ringSize(header->stride, header->slots);
+		return (ShmRing*)(shm->base + offset);
+	}
+
+	static bool neighbour(const ShmHeader* header, uint32_t worker, LifeHaloDirection direction, uint32_t* result)
+	{
+		bool torus = header->topology == Life_Topology_Torus;
+		if (direction == Life_Halo_Up)
+		{
+			if (worker == 0 && !torus) return false;
+			*result = worker == 0 ? header->workerCount - 1 : worker - 1;
+		}
+		else
+		{
+			if (worker == header->workerCount - 1 && !torus) return false;
+			*result = worker == header->workerCount - 1 ? 0 : worker + 1;
+		}
+		return true;
+	}
+
+	// false when the coordinator aborted while waiting
+	static bool waitFor(const ShmHeader* header, const std::atomic<uint64_t>* value, uint64_t target)
+	{
+		for (uint32_t spins = 0; value->load(std::memory_order_acquire) < target; spins++)
+		{
+			if (header->aborted.load(std::memory_order_relaxed)) return false;
+			if (spins >= SHM_SPINS) sched_yield();
+		}
+		return true;
+	}
+
+	// a segment whose coordinator process is gone, a half built or foreign segment is never taken over
+	static bool abandonedSegment(const char* name)
+	{
+		int fd = shm_open(name, O_RDONLY, 0);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ShmHeader))
+		{
+			if (fd >= 0) close(fd);
+			return false;
+		}
+
+		void* base = mmap(nullptr, sizeof(ShmHeader), PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+			return false;
+
+		const ShmHeader* header = (const ShmHeader*)base;
+		bool abandoned = header->magic == SHM_MAGIC && kill((pid_t)header->coordinator, 0) != 0 && errno == ESRCH;
+		munmap(base, sizeof(ShmHeader));
+		return abandoned;
+	}
+
+	static LifeResult shmSendRow(void* data, LifeHaloDirection direction, uint64_t generation, const uint64_t* row)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		ShmHeader* header = shmHeader(shm);
+
+		uint32_t target;
+		if (!neighbour(header, shm->worker, direction, &target)) return Life_Result_Success;
+
+		// wait for a free slot, the reader may lag at most slots rows behind
+		ShmRing* ring = shmRing(shm, shm->worker, direction);
+		uint64_t written = ring->written.load(std::memory_order_relaxed);
+		if (written >= header->slots && !waitFor(header, &ring->read, written - header->slots + 1))
+			return Life_Result_Failed;
+
+		uint64_t* slot = (uint64_t*)(ring + 1) + (written % header->slots) * (header->stride + 1);
+		slot[0] = generation;
+		memcpy(slot + 1, row, header->stride * sizeof(uint64_t));
+		ring->written.store(written + 1, std::memory_order_release);
+
+		return Life_Result_Success;
+	}
+
+	static LifeResult shmReceiveRow(void* data, LifeHaloDirection direction, uint64_t generation, uint64_t* row)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		ShmHeader* header = shmHeader(shm);
+
+		uint32_t source;
+		if (!neighbour(header, shm->worker, direction, &source))
+		{
+			memset(row, 0, header->stride * sizeof(uint64_t));
+			return Life_Result_Success;
+		}
+
+		// the stripe above sends its last row down to us and the stripe below its first row up
+		ShmRing* ring = shmRing(shm, source, direction == Life_Halo_Up ? Life_Halo_Down : Life_Halo_Up);
+		uint64_t read = ring->read.load(std::memory_order_relaxed);
+		if (!waitFor(header, &ring->written, read + 1))
+			return Life_Result_Failed;
+
+		const uint64_t* slot = (const uint64_t*)(ring + 1) + (read % header->slots) * (header->stride + 1);
+		if (slot[0] != generation)
+		{
+			printf("transport: worker %u expected a row of generation %llu and received %llu\n", shm->worker,
+				(unsigned long long)generation, (unsigned long long)slot[0]);
+			return Life_Result_Failed;
+		}
+
+		memcpy(row, slot + 1, header->stride * sizeof(uint64_t));
+		ring->read.store(read + 1, std::memory_order_release);
+
+		return Life_Result_Success;
+	}
+
+	static LifeResult shmBarrier(void* data, uint64_t generation, const LifeReduction* reduction)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		ShmHeader* header = shmHeader(shm);
+		ShmReport* report = shmReport(shm, shm->worker);
+
+		report->population = reduction->population;
+		report->hash = reduction->hash;
+		report->reported.store(generation + 1, std::memory_order_release);
+
+		return waitFor(header, &header->released, generation + 1) ? Life_Result_Success : Life_Result_Failed;
+	}
+
+	static LifeResult shmGather(void* data, uint64_t generation, LifeReduction* reduction)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		ShmHeader* header = shmHeader(shm);
+
+		*reduction = LifeReduction{};
+		for (uint32_t worker = 0; worker < header->workerCount; worker++)
+		{
+			ShmReport* report = shmReport(shm, worker);
+			if (!waitFor(header, &report->reported, generation + 1))
+				return Life_Result_Failed;
+
+			reduction->population += report->population;
+			reduction->hash ^= report->hash;
+		}
+
+		return Life_Result_Success;
+	}
+
+	static void shmRelease(void* data, uint64_t generation)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		shmHeader(shm)->released.store(generation + 1, std::memory_order_release);
+	}
+
+	static void shmAbort(void* data)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		shmHeader(shm)->aborted.store(1, std::memory_order_relaxed);
+	}
+
+	static void shmDestroy(void* data)
+	{
+		ShmTransport* shm = (ShmTransport*)data;
+		munmap(shm->base, shm->size);
+		if (shm->owner)
+			shm_unlink(shm->name);
+		delete shm;
+	}
+
+	LifeResult createShmCoordinator(LifeCoordinatorTransport* transport, const char* name, const LifeTransportInfo* transportInfo)
+	{
+		if (transportInfo->workerCount == 0 || transportInfo->stride == 0 || transportInfo->slots == 0 || strlen(name) + 2 > sizeof(ShmTransport::name))
+			return Life_Result_Failed;
+
+		ShmTransport* shm = new ShmTransport();
+		snprintf(shm->name, sizeof(shm->name), "%s%s", name[0] == '/' ? "" : "/", name);
+		shm->owner = true;
+		shm->worker = 0;
+		shm->size = alignShm(sizeof(ShmHeader)) + transportInfo->workerCount * sizeof(ShmReport) +
+			(size_t)transportInfo->workerCount * 2 * ringSize(transportInfo->stride, transportInfo->slots);
+
+		int fd = shm_open(shm->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		if (fd < 0 && errno == EEXIST && abandonedSegment(shm->name))
+		{
+			shm_unlink(shm->name);
+			fd = shm_open(shm->name, O_CREAT | O_EXCL | O_RDWR, 0600);
+		}
+		if (fd < 0 && errno == EEXIST)
+		{
+			printf("transport: shared memory %s belongs to another run\n", shm->name);
+			delete shm;
+			return Life_Result_Failed;
+		}
+		if (fd < 0 || ftruncate(fd, shm->size) != 0)
+		{
+			printf("transport: failed to create shared memory %s\n", shm->name);
+			if (fd >= 0) { close(fd); shm_unlink(shm->name); }
+			delete shm;
+			return Life_Result_Failed;
+		}
+
+		void* base = mmap(nullptr, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+		{
+			printf("transport: failed to map shared memory %s\n", shm->name);
+			shm_unlink(shm->name);
+			delete shm;
+			return Life_Result_Failed;
+		}
+		shm->base = (uint8_t*)base;
+
+		ShmHeader* header = new (shm->base) ShmHeader();
+		header->size = shm->size;
+		header->workerCount = transportInfo->workerCount;
+		header->stride = transportInfo->stride;
+		header->slots = transportInfo->slots;
+		header->topology = transportInfo->topology;
+		header->coordinator = getpid();
+		header->released.store(0);
+		header->aborted.store(0);
+
+		for (uint32_t worker = 0; worker < header->workerCount; worker++)
+		{
+			new (shmReport(shm, worker)) ShmReport();
+			new (shmRing(shm, worker, Life_Halo_Up)) ShmRing();
+			new (shmRing(shm, worker, Life_Halo_Down)) ShmRing();
+		}
+
+		// workers check the magic last so they never see a half built segment
+		std::atomic_thread_fence(std::memory_order_release);
+		header->magic = SHM_MAGIC;
+
+		transport->data = shm;
+		transport->gather = shmGather;
+		transport->release = shmRelease;
+		transport->abort = shmAbort;
+		transport->destroy = shmDestroy;
+
+		return Life_Result_Success;
+	}
+
+	LifeResult createShmWorker(LifeWorkerTransport* transport, const char* name, uint32_t worker)
+	{
+		ShmTransport* shm = new ShmTransport();
+		snprintf(shm->name, sizeof(shm->name), "%s%s", name[0] == '/' ? "" : "/", name);
+		shm->owner = false;
+		shm->worker = worker;
+
+		int fd = shm_open(shm->name, O_RDWR, 0600);
+		struct stat info;
+		if (fd < 0 || fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(ShmHeader))
+		{
+			printf("transport: failed to open shared memory %s\n", shm->name);
+			if (fd >= 0) close(fd);
+			delete shm;
+			return Life_Result_Failed;
+		}
+
+		shm->size = info.st_size;
+		void* base = mmap(nullptr, shm->size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		close(fd);
+		if (base == MAP_FAILED)
+		{
+			printf("transport: failed to map shared memory %s\n", shm->name);
+			delete shm;
+			return Life_Result_Failed;
+		}
+		shm->base = (uint8_t*)base;
+
+		ShmHeader* header = shmHeader(shm);
+		if (header->magic != SHM_MAGIC || header->size != shm->size || worker >= header->workerCount)
+		{
+			printf("transport: %s is not a cgol segment for worker %u\n", shm->name, worker);
+			munmap(shm->base, shm->size);
+			delete shm;
+			return Life_Result_Failed;
+		}
+		std::atomic_thread_fence(std::memory_order_acquire);
+
+		transport->data = shm;
+		transport->sendRow = shmSendRow;
+		transport->receiveRow = shmReceiveRow;
+		transport->barrier = shmBarrier;
+		transport->destroy = shmDestroy;
+
+		return Life_Result_Success;
+	}
+#else
+	LifeResult createShmCoordinator(LifeCoordinatorTransport* transport, const char* name, const LifeTransportInfo* transportInfo)
+	{
+		printf("transport: shared memory transport needs a POSIX system\n");
+		return Life_Result_Failed;
+	}
+
+	LifeResult createShmWorker(LifeWorkerTransport* transport, const char* name, uint32_t worker)
+	{
+		printf("transport: shared memory transport needs a POSIX system\n");
+		return Life_Result_Failed;
+	}
+#endif
+}
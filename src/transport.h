@@ -0,0 +1,59 @@
+#pragma once
+
+#include "life.h"
+
+enum LifeHaloDirection
+{
+	Life_Halo_Up,   // towards the stripe above, which receives the sender's first row
+	Life_Halo_Down, // towards the stripe below, which receives the sender's last row
+};
+
+// totals reduced over every worker at a barrier
+struct LifeReduction
+{
+	uint64_t population;
+	uint64_t hash; // xor of the workers' row hashes, equal to hashGrid of the whole universe
+};
+
+// a worker's connection to its neighbours and the coordinator, implementations fill in the
+// function pointers and pass their state as data so shared memory can be swapped for sockets
+struct LifeWorkerTransport
+{
+	void* data;
+
+	// sendRow(Up) passes the first owned row to the stripe above, receiveRow(Up) returns the last
+	// row of the stripe above, rows are sent once per generation and receive blocks until one arrives
+	LifeResult (*sendRow)(void* data, LifeHaloDirection direction, uint64_t generation, const uint64_t* row);
+	LifeResult (*receiveRow)(void* data, LifeHaloDirection direction, uint64_t generation, uint64_t* row);
+	// reports the worker's totals for generation and blocks until the coordinator releases it
+	LifeResult (*barrier)(void* data, uint64_t generation, const LifeReduction* reduction);
+	void       (*destroy)(void* data);
+};
+
+struct LifeCoordinatorTransport
+{
+	void* data;
+
+	// blocks until every worker reported generation and sums their totals
+	LifeResult (*gather)(void* data, uint64_t generation, LifeReduction* reduction);
+	void       (*release)(void* data, uint64_t generation);
+	// wakes every worker with an error, used when a worker process died
+	void       (*abort)(void* data);
+	void       (*destroy)(void* data);
+};
+
+// describes the decomposition every transport shares
+struct LifeTransportInfo
+{
+	uint32_t workerCount;
+	uint32_t stride;       // words per row of the universe
+	uint32_t slots;        // halo rows a worker can send ahead of its neighbour
+	LifeTopology topology; // on a torus the first and last stripe exchange rows
+};
+
+namespace life
+{
+	// the coordinator creates the segment, workers attach to it by name, POSIX systems only
+	LifeResult createShmCoordinator(LifeCoordinatorTransport* transport, const char* name, const LifeTransportInfo* transportInfo);
+	LifeResult createShmWorker(LifeWorkerTransport* transport, const char* name, uint32_t worker);
+}